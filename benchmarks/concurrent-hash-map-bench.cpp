@@ -0,0 +1,144 @@
+/****************************************************************************
+
+    MIT License
+
+    Copyright (c) 2023 Aria Janke
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+
+*****************************************************************************/
+
+
+// Compares lookup/insert throughput of a ConcurrentHashMap, against a
+// HashMap guarded by one mutex, as more threads are added.
+//
+// usage: concurrent-hash-map-bench [operations per thread]
+
+#include <ariajanke/cul/ConcurrentHashMap.hpp>
+
+#include <chrono>
+#include <iostream>
+#include <mutex>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+using namespace cul;
+
+constexpr const std::size_t k_empty_key = 0;
+constexpr const std::size_t k_key_range = 1 << 20;
+// out of every ten operations, how many are lookups
+constexpr const int k_finds_per_ten = 8;
+
+using Clock = std::chrono::steady_clock;
+
+// results are written here, so that lookups are not optimized away
+volatile std::size_t s_sink = 0;
+
+class MutexHashMap final {
+public:
+    MutexHashMap(): m_map(k_empty_key) {}
+
+    bool find(std::size_t key) const {
+        std::lock_guard lock{m_mutex};
+        return m_map.find(key) != m_map.end();
+    }
+
+    void insert_or_assign(std::size_t key, std::size_t el) {
+        std::lock_guard lock{m_mutex};
+        auto itr = m_map.find(key);
+        if (itr == m_map.end()) m_map.insert(key, el);
+        else itr->second = el;
+    }
+
+    void reserve(std::size_t n) { m_map.reserve(n); }
+
+private:
+    mutable std::mutex m_mutex;
+    HashMap<std::size_t, std::size_t> m_map;
+};
+
+class ShardedHashMap final {
+public:
+    ShardedHashMap(): m_map(k_empty_key) {}
+
+    bool find(std::size_t key) const
+        { return m_map.find(key).has_value(); }
+
+    void insert_or_assign(std::size_t key, std::size_t el)
+        { m_map.insert_or_assign(key, el); }
+
+    void reserve(std::size_t n) { m_map.reserve(n); }
+
+private:
+    ConcurrentHashMap<std::size_t, std::size_t> m_map;
+};
+
+/** @returns millions of operations per second, over all threads */
+template <typename MapType>
+double run(std::size_t thread_count, std::size_t operations_per_thread) {
+    MapType map;
+    map.reserve(k_key_range);
+    for (std::size_t i = 1; i < k_key_range; i += 2)
+        { map.insert_or_assign(i, i); }
+
+    std::vector<std::thread> threads;
+    std::size_t found_total = 0;
+    std::mutex found_mutex;
+    auto start = Clock::now();
+    for (std::size_t t = 0; t != thread_count; ++t) {
+        threads.emplace_back([&, t] {
+            std::mt19937_64 rng{t + 1};
+            std::uniform_int_distribution<std::size_t> keys{1, k_key_range - 1};
+            std::uniform_int_distribution<int> kinds{0, 9};
+            std::size_t found = 0;
+            for (std::size_t n = 0; n != operations_per_thread; ++n) {
+                auto key = keys(rng);
+                if (kinds(rng) < k_finds_per_ten)
+                    { found += map.find(key) ? 1 : 0; }
+                else
+                    { map.insert_or_assign(key, n); }
+            }
+            std::lock_guard lock{found_mutex};
+            found_total += found;
+        });
+    }
+    for (auto & thread : threads)
+        { thread.join(); }
+    std::chrono::duration<double> elapsed = Clock::now() - start;
+    s_sink = found_total;
+    return double(thread_count*operations_per_thread) / elapsed.count() / 1e6;
+}
+
+} // end of <anonymous> namespace
+
+int main(int argc, char ** argv) {
+    std::size_t operations_per_thread = argc > 1 ? std::stoul(argv[1]) : 1000000;
+    auto max_threads = std::max(1u, std::thread::hardware_concurrency());
+    std::cout << "threads | mutex + HashMap (Mops/s) | ConcurrentHashMap (Mops/s)\n";
+    for (std::size_t threads = 1; threads <= max_threads; threads *= 2) {
+        auto mutexed = run<MutexHashMap>(threads, operations_per_thread);
+        auto sharded = run<ShardedHashMap>(threads, operations_per_thread);
+        std::cout << threads << " | " << mutexed << " | " << sharded << std::endl;
+    }
+    return 0;
+}
@@ -0,0 +1,473 @@
+/****************************************************************************
+
+    MIT License
+
+    Copyright (c) 2023 Aria Janke
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+
+*****************************************************************************/
+
+
+// Compares HashMap (with a few policies) against std::unordered_map, over
+// several key types, key distributions and sizes.
+//
+// For each combination this reports nanoseconds per operation for:
+// insertion, finding present keys, finding missing keys, erase/insert churn
+// (size held steady), and iteration (per element). Bytes per entry are what
+// each map holds from its allocator. Probe length histograms are shown for
+// HashMaps with uniformly distributed keys.
+//
+// Distributions:
+// - sequential: keys are 1, 2, 3... and are visited in that order
+// - uniform:    keys are scattered, and visited uniformly at random
+// - zipfian:    keys are scattered, and a few are visited far more often
+//               than the rest (skew of 0.99)
+//
+// usage: hash-map-bench [largest number of entries, default 262144]
+//        sizes run from 1024 (fits in L1) up to 100000000
+
+#include <ariajanke/cul/HashMap.hpp>
+
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace {
+
+using namespace cul;
+
+using Clock = std::chrono::steady_clock;
+using Element = std::uint64_t;
+
+constexpr const std::size_t k_operation_count = 1 << 20;
+// measurements stop early past this, so that pathological cases (like long
+// clusters of sequential keys) don't hold up the whole run
+constexpr const std::chrono::milliseconds k_time_budget{250};
+constexpr const std::size_t k_sizes[] = {
+    1 << 10, 1 << 14, 1 << 18, 1 << 22, 100000000
+};
+// probe lengths past this are counted together
+constexpr const std::size_t k_histogram_width = 8;
+
+// results are written here, so that lookups are not optimized away
+volatile Element s_sink = 0;
+
+std::size_t s_bytes_in_use = 0;
+
+// counts what every map holds, so that bytes per entry can be reported
+template <typename T>
+class CountingAllocator final {
+public:
+    using value_type = T;
+
+    CountingAllocator() {}
+
+    template <typename U>
+    CountingAllocator(const CountingAllocator<U> &) {}
+
+    T * allocate(std::size_t n) {
+        s_bytes_in_use += n*sizeof(T);
+        return std::allocator<T>{}.allocate(n);
+    }
+
+    void deallocate(T * ptr, std::size_t n) {
+        s_bytes_in_use -= n*sizeof(T);
+        std::allocator<T>{}.deallocate(ptr, n);
+    }
+
+    template <typename U>
+    bool operator == (const CountingAllocator<U> &) const { return true; }
+
+    template <typename U>
+    bool operator != (const CountingAllocator<U> &) const { return false; }
+};
+
+enum class Distribution { sequential, uniform, zipfian };
+
+const char * name_of(Distribution distribution) {
+    switch (distribution) {
+    case Distribution::sequential: return "sequential";
+    case Distribution::uniform   : return "uniform";
+    case Distribution::zipfian   : return "zipfian";
+    }
+    return "?";
+}
+
+// murmur3's finalizers, both are bijections (so distinct inputs give
+// distinct keys), and only zero maps to zero
+std::uint32_t scatter(std::uint32_t n) {
+    n ^= n >> 16; n *= 0x85EBCA6Bu;
+    n ^= n >> 13; n *= 0xC2B2AE35u;
+    return n ^ (n >> 16);
+}
+
+std::uint64_t scatter(std::uint64_t n) {
+    n ^= n >> 33; n *= 0xFF51AFD7ED558CCDull;
+    n ^= n >> 33; n *= 0xC4CEB9FE1A85EC53ull;
+    return n ^ (n >> 33);
+}
+
+// keys are made from numbers greater than zero, zero is the empty key
+template <typename KeyType>
+struct KeyMaker;
+
+template <>
+struct KeyMaker<int> final {
+    static constexpr const char * k_name = "int";
+    static int empty_key() { return 0; }
+    static int make(std::uint64_t n, Distribution distribution) {
+        auto n32 = std::uint32_t(n);
+        return int(distribution == Distribution::sequential ? n32 : scatter(n32));
+    }
+};
+
+template <>
+struct KeyMaker<std::uint64_t> final {
+    static constexpr const char * k_name = "uint64";
+    static std::uint64_t empty_key() { return 0; }
+    static std::uint64_t make(std::uint64_t n, Distribution distribution)
+        { return distribution == Distribution::sequential ? n : scatter(n); }
+};
+
+template <>
+struct KeyMaker<std::string> final {
+    static constexpr const char * k_name = "string";
+    static std::string empty_key() { return std::string{}; }
+    static std::string make(std::uint64_t n, Distribution distribution) {
+        return "key/" + std::to_string
+            (distribution == Distribution::sequential ? n : scatter(n));
+    }
+};
+
+/** Zipfian ranks in [0, n), zero being the most popular. From Gray et
+ *  al., "Quickly Generating Billion-Record Synthetic Databases", which
+ *  takes constant memory however large n is.
+ */
+class ZipfianDistribution final {
+public:
+    static constexpr const double k_skew = 0.99;
+
+    explicit ZipfianDistribution(std::size_t n):
+        m_n(n),
+        m_zeta_n(zeta(n)),
+        m_half_pow(std::pow(0.5, k_skew)),
+        m_alpha(1. / (1. - k_skew)),
+        m_eta(  (1. - std::pow(2. / double(n), 1. - k_skew))
+              / (1. - zeta(2) / m_zeta_n)) {}
+
+    template <typename Rng>
+    std::size_t operator () (Rng & rng) {
+        double u = std::uniform_real_distribution<double>{}(rng);
+        double uz = u*m_zeta_n;
+        if (uz < 1.) return 0;
+        if (uz < 1. + m_half_pow) return std::min<std::size_t>(1, m_n - 1);
+        auto rank = std::size_t(double(m_n)*std::pow(m_eta*u - m_eta + 1., m_alpha));
+        return std::min(rank, m_n - 1);
+    }
+
+private:
+    static double zeta(std::size_t n) {
+        double sum = 0.;
+        for (std::size_t i = 1; i <= n; ++i)
+            { sum += 1. / std::pow(double(i), k_skew); }
+        return sum;
+    }
+
+    std::size_t m_n;
+    double m_zeta_n;
+    double m_half_pow;
+    double m_alpha;
+    double m_eta;
+};
+
+/** @returns which of n keys each operation visits */
+std::vector<std::size_t> make_visit_order
+    (std::size_t n, Distribution distribution)
+{
+    std::vector<std::size_t> rv;
+    rv.reserve(k_operation_count);
+    std::mt19937_64 rng{0x5EED};
+    if (distribution == Distribution::sequential) {
+        for (std::size_t i = 0; i != k_operation_count; ++i)
+            { rv.push_back(i % n); }
+    } else if (distribution == Distribution::uniform) {
+        std::uniform_int_distribution<std::size_t> indices{0, n - 1};
+        for (std::size_t i = 0; i != k_operation_count; ++i)
+            { rv.push_back(indices(rng)); }
+    } else {
+        ZipfianDistribution indices{n};
+        for (std::size_t i = 0; i != k_operation_count; ++i)
+            { rv.push_back(indices(rng)); }
+    }
+    return rv;
+}
+
+template <typename KeyType>
+struct Workload final {
+    Workload(std::size_t n, Distribution distribution) {
+        using Maker = KeyMaker<KeyType>;
+        present.reserve(n);
+        for (std::size_t i = 1; i != n + 1; ++i)
+            { present.push_back(Maker::make(i, distribution)); }
+        auto order = make_visit_order(n, distribution);
+        hits.reserve(order.size());
+        misses.reserve(order.size());
+        fresh.reserve(order.size());
+        for (std::size_t i = 0; i != order.size(); ++i) {
+            hits.push_back(present[order[i]]);
+            // numbers past n are never present
+            misses.push_back(Maker::make(n + 1 + order[i], distribution));
+            fresh.push_back(Maker::make(2*n + 1 + i, distribution));
+        }
+        churn_order = std::move(order);
+    }
+
+    std::vector<KeyType> present;
+    std::vector<KeyType> hits;
+    std::vector<KeyType> misses;
+    std::vector<KeyType> fresh;
+    std::vector<std::size_t> churn_order;
+};
+
+template <typename KeyType>
+using UnorderedMap = std::unordered_map<
+    KeyType, Element, std::hash<KeyType>, std::equal_to<KeyType>,
+    CountingAllocator<std::pair<const KeyType, Element>>>;
+
+template <typename KeyType, typename PolicyT>
+using CulHashMap = HashMap<
+    KeyType, Element, std::hash<KeyType>, std::equal_to<void>,
+    CountingAllocator<std::byte>, PolicyT>;
+
+// ----------------------------- map adapters ---------------------------------
+
+template <typename KeyType>
+UnorderedMap<KeyType> make_map(const UnorderedMap<KeyType> *)
+    { return UnorderedMap<KeyType>{}; }
+
+template <typename KeyType, typename PolicyT>
+CulHashMap<KeyType, PolicyT> make_map(const CulHashMap<KeyType, PolicyT> *)
+    { return CulHashMap<KeyType, PolicyT>{KeyMaker<KeyType>::empty_key()}; }
+
+template <typename KeyType>
+void insert(UnorderedMap<KeyType> & map, const KeyType & key, Element el)
+    { map.emplace(key, el); }
+
+template <typename KeyType, typename PolicyT>
+void insert(CulHashMap<KeyType, PolicyT> & map, const KeyType & key, Element el)
+    { map.insert(key, el); }
+
+template <typename KeyType>
+void erase(UnorderedMap<KeyType> & map, const KeyType & key)
+    { map.erase(key); }
+
+template <typename KeyType, typename PolicyT>
+void erase(CulHashMap<KeyType, PolicyT> & map, const KeyType & key)
+    { map.erase(map.find(key)); }
+
+template <typename KeyType>
+std::vector<std::size_t> probe_length_histogram(const UnorderedMap<KeyType> &)
+    { return std::vector<std::size_t>{}; }
+
+template <typename KeyType, typename PolicyT>
+std::vector<std::size_t> probe_length_histogram
+    (const CulHashMap<KeyType, PolicyT> & map)
+{ return map.probe_length_histogram(); }
+
+// ----------------------------------------------------------------------------
+
+struct Results final {
+    double insert = 0.;
+    double find_hit = 0.;
+    double find_miss = 0.;
+    double churn = 0.;
+    double iterate = 0.;
+    double bytes_per_entry = 0.;
+    std::vector<std::size_t> histogram;
+};
+
+/** Calls f for [0, count), a chunk at a time, until all are done or the
+ *  time budget is spent.
+ *  @returns nanoseconds per operation
+ */
+template <typename Func>
+double nanoseconds_per(std::size_t count, Func && f) {
+    static constexpr const std::size_t k_chunk_size = 1024;
+    auto start = Clock::now();
+    std::size_t done = 0;
+    while (done < count) {
+        auto end = std::min(done + k_chunk_size, count);
+        f(done, end);
+        done = end;
+        if (Clock::now() - start > k_time_budget) break;
+    }
+    std::chrono::duration<double, std::nano> elapsed = Clock::now() - start;
+    return elapsed.count() / double(done);
+}
+
+template <typename MapType, typename KeyType>
+Results run(const Workload<KeyType> & workload) {
+    Results results;
+    const auto bytes_before = s_bytes_in_use;
+    auto map = make_map(static_cast<const MapType *>(nullptr));
+    const auto n = workload.present.size();
+    // every key is inserted, however long it takes
+    auto start = Clock::now();
+    for (std::size_t i = 0; i != n; ++i)
+        { insert(map, workload.present[i], Element(i + 1)); }
+    std::chrono::duration<double, std::nano> elapsed = Clock::now() - start;
+    results.insert = elapsed.count() / double(n);
+    results.bytes_per_entry = double(s_bytes_in_use - bytes_before) / double(n);
+    results.histogram = probe_length_histogram(map);
+
+    Element sum = 0;
+    results.find_hit = nanoseconds_per(workload.hits.size(),
+        [&] (std::size_t begin, std::size_t end)
+    {
+        for (auto i = begin; i != end; ++i)
+            { sum += map.find(workload.hits[i])->second; }
+    });
+    results.find_miss = nanoseconds_per(workload.misses.size(),
+        [&] (std::size_t begin, std::size_t end)
+    {
+        for (auto i = begin; i != end; ++i)
+            { sum += (map.find(workload.misses[i]) != map.end()) ? 1 : 0; }
+    });
+    // iterations are counted per pass over the whole map
+    const auto passes = std::max<std::size_t>(1, k_operation_count / n);
+    results.iterate = nanoseconds_per(passes,
+        [&] (std::size_t begin, std::size_t end)
+    {
+        for (auto i = begin; i != end; ++i) {
+            for (auto && pair : map)
+                { sum += pair.second; }
+        }
+    }) / double(n);
+
+    auto live = workload.present;
+    results.churn = nanoseconds_per(workload.fresh.size(),
+        [&] (std::size_t begin, std::size_t end)
+    {
+        for (auto i = begin; i != end; ++i) {
+            auto & slot = live[workload.churn_order[i]];
+            erase(map, slot);
+            slot = workload.fresh[i];
+            insert(map, slot, Element(i));
+        }
+    });
+    s_sink = sum;
+    return results;
+}
+
+void print_histogram(const char * map_name, const std::vector<std::size_t> & histogram) {
+    std::size_t total = 0;
+    for (auto count : histogram)
+        { total += count; }
+    std::cout << "    " << std::setw(16) << std::left << map_name << std::right;
+    for (std::size_t i = 0; i != k_histogram_width + 1; ++i) {
+        std::size_t count = 0;
+        if (i < k_histogram_width) {
+            count = i < histogram.size() ? histogram[i] : 0;
+        } else {
+            for (std::size_t j = i; j < histogram.size(); ++j)
+                { count += histogram[j]; }
+        }
+        std::cout << std::setw(7) << std::fixed << std::setprecision(2)
+                  << 100.*double(count) / double(std::max<std::size_t>(total, 1));
+    }
+    std::cout << "   (max " << (histogram.empty() ? 0 : histogram.size() - 1)
+              << ")\n";
+}
+
+template <typename KeyType>
+void run_key_type(std::size_t max_entries) {
+    using HashMapDefault      = CulHashMap<KeyType, HashMapDefaultPolicy>;
+    using HashMapControlBytes = CulHashMap<KeyType, HashMapControlBytesPolicy>;
+    using HashMapRobinHood    = CulHashMap<KeyType, HashMapRobinHoodPolicy>;
+    static constexpr const char * k_map_names[] = {
+        "unordered_map", "HashMap", "control bytes", "robin hood"
+    };
+    static constexpr const char * k_operation_names[] = {
+        "insert", "find hit", "find miss", "churn", "iterate", "bytes/entry"
+    };
+
+    for (auto size : k_sizes) {
+        if (size > max_entries) break;
+        for (auto distribution : { Distribution::sequential,
+                                   Distribution::uniform,
+                                   Distribution::zipfian })
+        {
+            Workload<KeyType> workload{size, distribution};
+            Results results[] = {
+                run<UnorderedMap<KeyType>>(workload),
+                run<HashMapDefault>(workload),
+                run<HashMapControlBytes>(workload),
+                run<HashMapRobinHood>(workload)
+            };
+            std::cout << KeyMaker<KeyType>::k_name << " keys, " << size
+                      << " entries, " << name_of(distribution) << '\n'
+                      << "    " << std::setw(12) << std::left << "ns/op"
+                      << std::right;
+            for (auto name : k_map_names)
+                { std::cout << std::setw(15) << name; }
+            std::cout << '\n';
+            for (std::size_t op = 0; op != std::size(k_operation_names); ++op) {
+                std::cout << "    " << std::setw(12) << std::left
+                          << k_operation_names[op] << std::right;
+                for (const auto & result : results) {
+                    const double values[] = {
+                        result.insert, result.find_hit, result.find_miss,
+                        result.churn, result.iterate, result.bytes_per_entry
+                    };
+                    std::cout << std::setw(15) << std::fixed
+                              << std::setprecision(1) << values[op];
+                }
+                std::cout << '\n';
+            }
+            if (distribution == Distribution::uniform) {
+                std::cout << "    " << std::setw(16) << std::left
+                          << "probe length %" << std::right;
+                for (std::size_t i = 0; i != k_histogram_width; ++i)
+                    { std::cout << std::setw(7) << i; }
+                std::cout << std::setw(7) << (std::to_string(k_histogram_width) + "+")
+                          << '\n';
+                for (std::size_t i = 1; i != std::size(results); ++i)
+                    { print_histogram(k_map_names[i], results[i].histogram); }
+            }
+            std::cout << std::endl;
+        }
+    }
+}
+
+} // end of <anonymous> namespace
+
+int main(int argc, char ** argv) {
+    std::size_t max_entries = argc > 1 ? std::stoul(argv[1]) : (1 << 18);
+    run_key_type<int>(max_entries);
+    run_key_type<std::uint64_t>(max_entries);
+    run_key_type<std::string>(max_entries);
+    return 0;
+}
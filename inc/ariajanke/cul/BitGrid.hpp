@@ -0,0 +1,472 @@
+/****************************************************************************
+
+    MIT License
+
+    Copyright (c) 2021 Aria Janke
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+
+*****************************************************************************/
+
+
+#pragma once
+
+#include <ariajanke/cul/Grid.hpp>
+
+#include <bitset>
+#include <cstdlib>
+#include <cstdint>
+
+namespace cul {
+
+namespace detail {
+
+using PackedGridWord = std::uint64_t;
+
+inline int count_trailing_zeros(PackedGridWord word) noexcept {
+    assert(word != 0);
+#   if defined(__GNUC__)
+    return __builtin_ctzll(word);
+#   else
+    int rv = 0;
+    for (; !(word & 1); word >>= 1)
+        { ++rv; }
+    return rv;
+#   endif
+}
+
+inline int count_set_bits(PackedGridWord word) noexcept
+    { return int(std::bitset<64>{word}.count()); }
+
+} // end of detail namespace -> into ::cul
+
+/** A two dimensional container of small unsigned values, packed at a fixed
+ *  number of bits per cell into 64 bit words. Each row starts on a new word,
+ *  and unused bits at the end of each row are always zero; so whole rows
+ *  (and whole grids) may be combined a word at a time.
+ *
+ *  Cell x of a row is kept in the bits starting at x*kt_bits_per_cell, with
+ *  bit zero being the least significant bit of the row's first word.
+ *
+ *  @tparam kt_bits_per_cell 1, 2, 4 or 8
+ */
+template <int kt_bits_per_cell>
+class PackedGrid final {
+public:
+    static_assert(   kt_bits_per_cell == 1 || kt_bits_per_cell == 2
+                  || kt_bits_per_cell == 4 || kt_bits_per_cell == 8,
+                  "Cells must be 1, 2, 4 or 8 bits wide.");
+
+    using Word      = detail::PackedGridWord;
+    using Value     = unsigned;
+    using IndexType = int;
+    using Vector    = Vector2<IndexType>;
+    using Size      = Size2<IndexType>;
+
+    static constexpr const int   k_bits_per_cell  = kt_bits_per_cell;
+    static constexpr const int   k_word_bits      = 64;
+    static constexpr const int   k_cells_per_word = k_word_bits / kt_bits_per_cell;
+    static constexpr const Value k_max_value      = (1u << kt_bits_per_cell) - 1;
+
+    /** Refers to one cell, as a packed cell has no address of its own. */
+    class Reference final {
+    public:
+        Reference(Word & word, int shift): m_word(&word), m_shift(shift) {}
+
+        operator Value () const noexcept
+            { return Value((*m_word >> m_shift) & k_max_value); }
+
+        /** Stores the low bits of value (as many as a cell holds). */
+        Reference & operator = (Value value) noexcept {
+            *m_word &= ~(Word(k_max_value) << m_shift);
+            *m_word |= Word(value & k_max_value) << m_shift;
+            return *this;
+        }
+
+        Reference & operator = (const Reference & rhs) noexcept
+            { return *this = Value(rhs); }
+
+    private:
+        Word * m_word;
+        int m_shift;
+    };
+
+    PackedGrid() {}
+
+    /** @throws std::invalid_argument if either dimension is negative */
+    PackedGrid(int width, int height, Value value = 0);
+
+    /** Copies a grid, converting each element to Value (which must then
+     *  fit in a cell).
+     */
+    template <typename T>
+    static PackedGrid from_grid(const Grid<T> &);
+
+    int width() const noexcept { return m_size.width; }
+
+    int height() const noexcept { return m_size.height; }
+
+    Size size2() const noexcept { return m_size; }
+
+    bool has_position(int x, int y) const noexcept
+        { return x >= 0 && y >= 0 && x < width() && y < height(); }
+
+    bool has_position(const Vector & r) const noexcept
+        { return has_position(r.x, r.y); }
+
+    /** @returns the "one past the end" position */
+    Vector end_position() const noexcept { return Vector(0, height()); }
+
+    /** @throws std::out_of_range if position is outside of the grid */
+    Reference operator () (int x, int y);
+
+    Reference operator () (const Vector & r)
+        { return (*this)(r.x, r.y); }
+
+    /** @throws std::out_of_range if position is outside of the grid */
+    Value operator () (int x, int y) const;
+
+    Value operator () (const Vector & r) const
+        { return (*this)(r.x, r.y); }
+
+    /** @returns cell at the given position, which must be inside the grid
+     *           (this is only asserted)
+     */
+    Reference element_unchecked(int x, int y) noexcept {
+        assert(has_position(x, y));
+        return Reference{word_of(x, y), shift_of(x)};
+    }
+
+    /** @copydoc PackedGrid::element_unchecked(int,int) */
+    Value element_unchecked(int x, int y) const noexcept {
+        assert(has_position(x, y));
+        return Value((word_of(x, y) >> shift_of(x)) & k_max_value);
+    }
+
+    /** @returns number of words each row takes */
+    int words_per_row() const noexcept { return m_words_per_row; }
+
+    /** @returns first word of a row (y must be a row in the grid), bits past
+     *           the row's last cell must be left zero
+     */
+    Word * row_words(int y) noexcept {
+        assert(y >= 0 && y < height());
+        return m_words.data() + std::size_t(y)*std::size_t(m_words_per_row);
+    }
+
+    /** @copydoc PackedGrid::row_words(int) */
+    const Word * row_words(int y) const noexcept {
+        assert(y >= 0 && y < height());
+        return m_words.data() + std::size_t(y)*std::size_t(m_words_per_row);
+    }
+
+    /** @returns number of set bits in the whole grid (for one bit cells,
+     *           the number of set cells)
+     */
+    std::size_t popcount() const noexcept;
+
+    /** @returns position of the first cell, in row order, which is not
+     *           zero; starting from (and including) the given position, or
+     *           end_position() if there is none
+     *
+     *  from may be one past the end of a row, so that searching again from
+     *  one past the last found position finds the next.
+     */
+    Vector find_first_set(const Vector & from = Vector{}) const noexcept;
+
+    /** @returns a copy, with every cell moved by (dx, dy); cells moved in
+     *           from outside the grid are zero
+     *
+     *  For instance, with one bit cells, (a.shifted(1, 0) | a.shifted(-1, 0))
+     *  marks every cell with a set neighbor to its left or right.
+     */
+    PackedGrid shifted(int dx, int dy) const;
+
+    /** @throws std::invalid_argument if sizes differ */
+    PackedGrid & operator &= (const PackedGrid &);
+
+    /** @copydoc PackedGrid::operator&=(const PackedGrid&) */
+    PackedGrid & operator |= (const PackedGrid &);
+
+    /** @copydoc PackedGrid::operator&=(const PackedGrid&) */
+    PackedGrid & operator ^= (const PackedGrid &);
+
+    /** @returns a grid with every bit of every cell inverted */
+    PackedGrid operator ~ () const;
+
+    bool operator == (const PackedGrid & rhs) const noexcept
+        { return m_size == rhs.m_size && m_words == rhs.m_words; }
+
+    bool operator != (const PackedGrid & rhs) const noexcept
+        { return !(*this == rhs); }
+
+    /** @returns a grid of every cell converted to T */
+    template <typename T = Value>
+    Grid<T> to_grid() const;
+
+    void swap(PackedGrid &) noexcept;
+
+private:
+    static int words_for(int width) noexcept
+        { return (width + k_cells_per_word - 1) / k_cells_per_word; }
+
+    static int shift_of(int x) noexcept
+        { return (x % k_cells_per_word)*kt_bits_per_cell; }
+
+    Word & word_of(int x, int y) noexcept
+        { return row_words(y)[x / k_cells_per_word]; }
+
+    const Word & word_of(int x, int y) const noexcept
+        { return row_words(y)[x / k_cells_per_word]; }
+
+    // @returns mask of bits in use, in the last word of each row
+    Word last_word_mask() const noexcept;
+
+    template <typename Func>
+    PackedGrid & combine(const char * caller, const PackedGrid &, Func && f);
+
+    std::out_of_range make_out_of_range_error() const;
+
+    std::vector<Word> m_words;
+    Size m_size;
+    int m_words_per_row = 0;
+};
+
+/** One bit per cell, for masks of any kind. */
+using BitGrid = PackedGrid<1>;
+
+template <int kt_bits_per_cell>
+PackedGrid<kt_bits_per_cell> operator &
+    (PackedGrid<kt_bits_per_cell> lhs, const PackedGrid<kt_bits_per_cell> & rhs)
+{ return lhs &= rhs; }
+
+template <int kt_bits_per_cell>
+PackedGrid<kt_bits_per_cell> operator |
+    (PackedGrid<kt_bits_per_cell> lhs, const PackedGrid<kt_bits_per_cell> & rhs)
+{ return lhs |= rhs; }
+
+template <int kt_bits_per_cell>
+PackedGrid<kt_bits_per_cell> operator ^
+    (PackedGrid<kt_bits_per_cell> lhs, const PackedGrid<kt_bits_per_cell> & rhs)
+{ return lhs ^= rhs; }
+
+// ----------------------------------------------------------------------------
+
+#ifndef DOXYGEN_SHOULD_SKIP_THIS
+
+template <int kt_bits_per_cell>
+PackedGrid<kt_bits_per_cell>::PackedGrid(int width_, int height_, Value value) {
+    if (width_ < 0 || height_ < 0) {
+        throw std::invalid_argument("PackedGrid::PackedGrid: both dimensions "
+                                    "must be non-negative integers.");
+    }
+    m_size = Size{width_, height_};
+    m_words_per_row = words_for(width_);
+    // every cell of a word set to value
+    Word filled = 0;
+    for (int i = 0; i != k_cells_per_word; ++i)
+        { filled |= Word(value & k_max_value) << (i*kt_bits_per_cell); }
+    m_words.resize(std::size_t(m_words_per_row)*std::size_t(height_), filled);
+    if (m_words_per_row == 0) return;
+    const auto mask = last_word_mask();
+    for (int y = 0; y != height_; ++y)
+        { row_words(y)[m_words_per_row - 1] &= mask; }
+}
+
+template <int kt_bits_per_cell>
+template <typename T>
+/* static */ PackedGrid<kt_bits_per_cell>
+    PackedGrid<kt_bits_per_cell>::from_grid(const Grid<T> & grid)
+{
+    PackedGrid rv{grid.width(), grid.height()};
+    for (int y = 0; y != grid.height(); ++y) {
+        for (int x = 0; x != grid.width(); ++x) {
+            auto value = static_cast<Value>(grid.element_unchecked(x, y));
+            assert(value <= k_max_value);
+            rv.element_unchecked(x, y) = value;
+        }
+    }
+    return rv;
+}
+
+template <int kt_bits_per_cell>
+typename PackedGrid<kt_bits_per_cell>::Reference
+    PackedGrid<kt_bits_per_cell>::operator () (int x, int y)
+{
+    if (!has_position(x, y)) throw make_out_of_range_error();
+    return element_unchecked(x, y);
+}
+
+template <int kt_bits_per_cell>
+typename PackedGrid<kt_bits_per_cell>::Value
+    PackedGrid<kt_bits_per_cell>::operator () (int x, int y) const
+{
+    if (!has_position(x, y)) throw make_out_of_range_error();
+    return element_unchecked(x, y);
+}
+
+template <int kt_bits_per_cell>
+std::size_t PackedGrid<kt_bits_per_cell>::popcount() const noexcept {
+    std::size_t rv = 0;
+    for (auto word : m_words)
+        { rv += std::size_t(detail::count_set_bits(word)); }
+    return rv;
+}
+
+template <int kt_bits_per_cell>
+typename PackedGrid<kt_bits_per_cell>::Vector
+    PackedGrid<kt_bits_per_cell>::find_first_set(const Vector & from) const noexcept
+{
+    // one past a row's last cell is the start of the next row
+    auto start = from.x == width() ? Vector{0, from.y + 1} : from;
+    if (!has_position(start)) return end_position();
+    // bits of cells before start are masked off the first word looked at
+    int first_word = start.x / k_cells_per_word;
+    Word mask = ~Word(0) << shift_of(start.x);
+    for (int y = start.y; y != height(); ++y) {
+        const auto * words = row_words(y);
+        for (int i = first_word; i != m_words_per_row; ++i) {
+            auto word = words[i] & mask;
+            mask = ~Word(0);
+            if (word == 0) continue;
+            int cell = detail::count_trailing_zeros(word) / kt_bits_per_cell;
+            return Vector{i*k_cells_per_word + cell, y};
+        }
+        first_word = 0;
+    }
+    return end_position();
+}
+
+template <int kt_bits_per_cell>
+PackedGrid<kt_bits_per_cell>
+    PackedGrid<kt_bits_per_cell>::shifted(int dx, int dy) const
+{
+    PackedGrid rv{width(), height()};
+    if (dx <= -width() || dx >= width() || dy <= -height() || dy >= height())
+        { return rv; }
+    // moving cells right moves their bits to higher positions
+    const int bit_shift  = std::abs(dx)*kt_bits_per_cell;
+    const int word_shift = bit_shift / k_word_bits;
+    const int bit_rem    = bit_shift % k_word_bits;
+    for (int y = std::max(0, dy); y != std::min(height(), height() + dy); ++y) {
+        const auto * src = row_words(y - dy);
+        auto * dest = rv.row_words(y);
+        for (int i = 0; i != m_words_per_row; ++i) {
+            // source words which land on dest[i]
+            Word word = 0;
+            if (dx >= 0) {
+                int j = i - word_shift;
+                if (j >= 0) word |= src[j] << bit_rem;
+                if (bit_rem != 0 && j - 1 >= 0)
+                    { word |= src[j - 1] >> (k_word_bits - bit_rem); }
+            } else {
+                int j = i + word_shift;
+                if (j < m_words_per_row) word |= src[j] >> bit_rem;
+                if (bit_rem != 0 && j + 1 < m_words_per_row)
+                    { word |= src[j + 1] << (k_word_bits - bit_rem); }
+            }
+            dest[i] = word;
+        }
+        dest[m_words_per_row - 1] &= last_word_mask();
+    }
+    return rv;
+}
+
+template <int kt_bits_per_cell>
+PackedGrid<kt_bits_per_cell> & PackedGrid<kt_bits_per_cell>::operator &=
+    (const PackedGrid & rhs)
+{ return combine("operator&=", rhs, [] (Word a, Word b) { return a & b; }); }
+
+template <int kt_bits_per_cell>
+PackedGrid<kt_bits_per_cell> & PackedGrid<kt_bits_per_cell>::operator |=
+    (const PackedGrid & rhs)
+{ return combine("operator|=", rhs, [] (Word a, Word b) { return a | b; }); }
+
+template <int kt_bits_per_cell>
+PackedGrid<kt_bits_per_cell> & PackedGrid<kt_bits_per_cell>::operator ^=
+    (const PackedGrid & rhs)
+{ return combine("operator^=", rhs, [] (Word a, Word b) { return a ^ b; }); }
+
+template <int kt_bits_per_cell>
+PackedGrid<kt_bits_per_cell> PackedGrid<kt_bits_per_cell>::operator ~ () const {
+    PackedGrid rv{*this};
+    for (auto & word : rv.m_words)
+        { word = ~word; }
+    if (m_words_per_row == 0) return rv;
+    const auto mask = last_word_mask();
+    for (int y = 0; y != height(); ++y)
+        { rv.row_words(y)[m_words_per_row - 1] &= mask; }
+    return rv;
+}
+
+template <int kt_bits_per_cell>
+template <typename T>
+Grid<T> PackedGrid<kt_bits_per_cell>::to_grid() const {
+    Grid<T> rv;
+    rv.set_size(width(), height());
+    for (int y = 0; y != height(); ++y) {
+        for (int x = 0; x != width(); ++x)
+            { rv.element_unchecked(x, y) = static_cast<T>(element_unchecked(x, y)); }
+    }
+    return rv;
+}
+
+template <int kt_bits_per_cell>
+void PackedGrid<kt_bits_per_cell>::swap(PackedGrid & rhs) noexcept {
+    m_words.swap(rhs.m_words);
+    std::swap(m_size, rhs.m_size);
+    std::swap(m_words_per_row, rhs.m_words_per_row);
+}
+
+template <int kt_bits_per_cell>
+/* private */ typename PackedGrid<kt_bits_per_cell>::Word
+    PackedGrid<kt_bits_per_cell>::last_word_mask() const noexcept
+{
+    const int used_bits = (width() % k_cells_per_word)*kt_bits_per_cell;
+    return used_bits == 0 ? ~Word(0) : (Word(1) << used_bits) - 1;
+}
+
+template <int kt_bits_per_cell>
+template <typename Func>
+/* private */ PackedGrid<kt_bits_per_cell> &
+    PackedGrid<kt_bits_per_cell>::combine
+    (const char * caller, const PackedGrid & rhs, Func && f)
+{
+    if (m_size != rhs.m_size) {
+        throw std::invalid_argument("PackedGrid::" + std::string(caller) +
+                                    ": grids must be the same size.");
+    }
+    for (std::size_t i = 0; i != m_words.size(); ++i)
+        { m_words[i] = f(m_words[i], rhs.m_words[i]); }
+    return *this;
+}
+
+template <int kt_bits_per_cell>
+/* private */ std::out_of_range
+    PackedGrid<kt_bits_per_cell>::make_out_of_range_error() const
+{
+    return std::out_of_range("PackedGrid::operator(): requested position is "
+                             "out of range, size: width "
+                             + std::to_string(width()) + " height "
+                             + std::to_string(height()));
+}
+
+#endif // ifndef DOXYGEN_SHOULD_SKIP_THIS
+
+} // end of cul namespace
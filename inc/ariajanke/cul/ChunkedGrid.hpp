@@ -0,0 +1,437 @@
+/****************************************************************************
+
+    MIT License
+
+    Copyright (c) 2021 Aria Janke
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+
+*****************************************************************************/
+
+
+#pragma once
+
+#include <ariajanke/cul/Grid.hpp>
+#include <ariajanke/cul/HashMap.hpp>
+
+#include <limits>
+#include <memory>
+
+namespace cul {
+
+template <typename T, int kt_chunk_size>
+class ChunkedGrid;
+
+namespace detail {
+
+/** Chunk positions are small and close together, so both components are
+ *  mixed into every bit of the hash.
+ */
+struct ChunkPositionHash final {
+    std::size_t operator () (const Vector2<int> & r) const noexcept {
+        auto packed =   (std::uint64_t(std::uint32_t(r.x)) << 32)
+                      |  std::uint64_t(std::uint32_t(r.y));
+        packed *= 0x9E3779B97F4A7C15ull;
+        return std::size_t(packed ^ (packed >> 29));
+    }
+};
+
+} // end of detail namespace -> into ::cul
+
+/** A rectangular window onto a ChunkedGrid, which may span any number of
+ *  chunks (including ones not yet allocated).
+ *
+ *  Positions given to a view are relative to its offset. Writing through a
+ *  non-constant view allocates chunks the same way ChunkedGrid does.
+ *
+ *  @tparam ParentT ChunkedGrid type, const qualified for read only views
+ */
+template <typename ParentT>
+class ChunkedSubGrid final {
+public:
+    using Element            = typename std::remove_const_t<ParentT>::Element;
+    using Vector             = Vector2<int>;
+    using Size               = Size2<int>;
+    using ReferenceType      = std::conditional_t<std::is_const_v<ParentT>,
+        typename ParentT::ConstReferenceType, typename ParentT::ReferenceType>;
+    using ConstReferenceType = typename ParentT::ConstReferenceType;
+
+    ChunkedSubGrid() {}
+
+    /** Constructor specific for ChunkedGrid, use its make_sub_grid instead.
+     */
+    ChunkedSubGrid(ParentT & parent, Vector offset_, Size size_):
+        m_parent(&parent), m_offset(offset_), m_size(size_) {}
+
+    /** @returns position of this view's first element in its parent */
+    Vector offset() const noexcept { return m_offset; }
+
+    int width() const noexcept { return m_size.width; }
+
+    int height() const noexcept { return m_size.height; }
+
+    Size size2() const noexcept { return m_size; }
+
+    bool has_position(int x, int y) const noexcept
+        { return x >= 0 && y >= 0 && x < width() && y < height(); }
+
+    bool has_position(const Vector & r) const noexcept
+        { return has_position(r.x, r.y); }
+
+    /** @throws std::out_of_range if position is outside of the view */
+    ReferenceType operator () (int x, int y) const;
+
+    ReferenceType operator () (const Vector & r) const
+        { return (*this)(r.x, r.y); }
+
+    /** @returns a narrower view, with an offset relative to this one
+     *  @throws std::out_of_range if it does not fit inside this view
+     */
+    ChunkedSubGrid make_sub_grid(Vector offset_, int width_, int height_) const;
+
+    /** Copies every element of this view into a new grid. Chunks are read a
+     *  row segment at a time, rather than looked up for each element.
+     */
+    Grid<Element> to_grid() const;
+
+private:
+    ParentT * m_parent = nullptr;
+    Vector m_offset;
+    Size m_size;
+};
+
+/** An unbounded two dimensional container, which keeps elements in square
+ *  Grid chunks, found by their chunk position in a HashMap. Chunks are only
+ *  allocated once an element in them is written, so memory follows the area
+ *  in use, rather than its bounding box. Any position (including negative
+ *  ones) may be used.
+ *
+ *  Elements of chunks which have not been allocated read as the default
+ *  element. References to elements stay valid until their chunk is erased.
+ *
+ *  @tparam kt_chunk_size width and height of each chunk in elements, a
+ *          power of two
+ */
+template <typename T, int kt_chunk_size = 32>
+class ChunkedGrid final {
+public:
+    static_assert(kt_chunk_size > 0 && (kt_chunk_size & (kt_chunk_size - 1)) == 0,
+                  "Chunk size must be a power of two.");
+
+    using Element            = T;
+    using Chunk              = Grid<T>;
+    using ReferenceType      = typename Chunk::ReferenceType;
+    using ConstReferenceType = typename Chunk::ConstReferenceType;
+    using Vector             = Vector2<int>;
+    using Size               = Size2<int>;
+    using SubGrid            = ChunkedSubGrid<ChunkedGrid>;
+    using ConstSubGrid       = ChunkedSubGrid<const ChunkedGrid>;
+
+    static constexpr const int k_chunk_size = kt_chunk_size;
+
+    ChunkedGrid() {}
+
+    /** @param default_element value of elements never written, and of new
+     *         chunks
+     */
+    explicit ChunkedGrid(const Element & default_element):
+        m_default_element(default_element) {}
+
+    ChunkedGrid(const ChunkedGrid &);
+
+    ChunkedGrid(ChunkedGrid &&) = default;
+
+    ChunkedGrid & operator = (const ChunkedGrid &);
+
+    ChunkedGrid & operator = (ChunkedGrid &&) = default;
+
+    /** @returns element at the given position, allocating its chunk if it
+     *           has none
+     */
+    ReferenceType operator () (int x, int y);
+
+    ReferenceType operator () (const Vector & r)
+        { return (*this)(r.x, r.y); }
+
+    /** @returns element at the given position, or the default element if it
+     *           has no chunk (never allocates)
+     */
+    ConstReferenceType operator () (int x, int y) const;
+
+    ConstReferenceType operator () (const Vector & r) const
+        { return (*this)(r.x, r.y); }
+
+    const Element & default_element() const noexcept
+        { return m_default_element; }
+
+    /** @returns position of the chunk holding an element position */
+    static Vector chunk_position_of(const Vector & r) noexcept {
+        return Vector{(r.x - (r.x & k_chunk_mask)) / kt_chunk_size,
+                      (r.y - (r.y & k_chunk_mask)) / kt_chunk_size};
+    }
+
+    /** @returns element position of a chunk's first element */
+    static Vector chunk_origin(const Vector & chunk_position) noexcept
+        { return chunk_position*kt_chunk_size; }
+
+    /** @returns chunk at the given chunk position, nullptr if it has not
+     *           been allocated
+     */
+    Chunk * find_chunk(const Vector & chunk_position) noexcept;
+
+    /** @copydoc ChunkedGrid::find_chunk(const Vector&) */
+    const Chunk * find_chunk(const Vector & chunk_position) const noexcept;
+
+    /** @returns chunk at the given chunk position, allocating it (filled with
+     *           the default element) if needed
+     */
+    Chunk & ensure_chunk(const Vector & chunk_position);
+
+    /** @returns true if a chunk was there to erase */
+    bool erase_chunk(const Vector & chunk_position);
+
+    /** @returns number of allocated chunks */
+    std::size_t chunk_count() const noexcept { return m_chunks.size(); }
+
+    /** Erases all chunks. */
+    void clear() noexcept { m_chunks.clear(); }
+
+    /** Calls f with the chunk position and chunk of every allocated chunk,
+     *  in no particular order. Chunks must not be added or erased by f.
+     */
+    template <typename Func>
+    void for_each_chunk(Func && f);
+
+    /** @copydoc ChunkedGrid::for_each_chunk(Func&&) */
+    template <typename Func>
+    void for_each_chunk(Func && f) const;
+
+    /** @returns a view of the given area, which may span chunk borders
+     *  @throws std::invalid_argument if width or height is negative
+     */
+    SubGrid make_sub_grid(Vector offset, int width, int height);
+
+    /** @copydoc ChunkedGrid::make_sub_grid(Vector,int,int) */
+    ConstSubGrid make_sub_grid(Vector offset, int width, int height) const;
+
+    void swap(ChunkedGrid &) noexcept;
+
+private:
+    using ChunkPointer = std::unique_ptr<Chunk>;
+    using ChunkMap = HashMap<Vector, ChunkPointer, detail::ChunkPositionHash>;
+
+    static constexpr const int k_chunk_mask = kt_chunk_size - 1;
+
+    // chunk positions are element positions divided by the chunk size, so
+    // can never reach this
+    static constexpr const int k_no_chunk = std::numeric_limits<int>::min();
+
+    static Vector local_position_of(const Vector & r) noexcept
+        { return Vector{r.x & k_chunk_mask, r.y & k_chunk_mask}; }
+
+    static Size verify_size(const char * caller, int width, int height);
+
+    ChunkMap m_chunks = ChunkMap{Vector{k_no_chunk, k_no_chunk}};
+    Element m_default_element = Element{};
+};
+
+// ----------------------------------------------------------------------------
+
+#ifndef DOXYGEN_SHOULD_SKIP_THIS
+
+template <typename ParentT>
+typename ChunkedSubGrid<ParentT>::ReferenceType
+    ChunkedSubGrid<ParentT>::operator () (int x, int y) const
+{
+    if (!has_position(x, y)) {
+        throw std::out_of_range("ChunkedSubGrid::operator(): requested "
+                                "position is out of range, size: width "
+                                + std::to_string(width()) + " height "
+                                + std::to_string(height()));
+    }
+    return (*m_parent)(m_offset + Vector{x, y});
+}
+
+template <typename ParentT>
+ChunkedSubGrid<ParentT> ChunkedSubGrid<ParentT>::make_sub_grid
+    (Vector offset_, int width_, int height_) const
+{
+    if (   offset_.x < 0 || offset_.y < 0 || width_ < 0 || height_ < 0
+        || offset_.x + width_ > width() || offset_.y + height_ > height())
+    {
+        throw std::out_of_range("ChunkedSubGrid::make_sub_grid: sub grid "
+                                "does not fit inside this one.");
+    }
+    return ChunkedSubGrid{*m_parent, m_offset + offset_, Size{width_, height_}};
+}
+
+template <typename ParentT>
+Grid<typename ChunkedSubGrid<ParentT>::Element>
+    ChunkedSubGrid<ParentT>::to_grid() const
+{
+    static constexpr const int k_chunk_size = ParentT::k_chunk_size;
+    Grid<Element> rv;
+    rv.set_size(width(), height(), m_parent->default_element());
+    for (int y = 0; y != height(); ++y) {
+        // segments end at each chunk border
+        int x = 0;
+        while (x != width()) {
+            auto pos = m_offset + Vector{x, y};
+            auto chunk_pos = ParentT::chunk_position_of(pos);
+            auto local = pos - ParentT::chunk_origin(chunk_pos);
+            int segment = std::min(k_chunk_size - local.x, width() - x);
+            const auto * chunk = std::as_const(*m_parent).find_chunk(chunk_pos);
+            if (chunk) {
+                for (int i = 0; i != segment; ++i) {
+                    rv.element_unchecked(x + i, y) =
+                        chunk->element_unchecked(local.x + i, local.y);
+                }
+            }
+            x += segment;
+        }
+    }
+    return rv;
+}
+
+// ----------------------------------------------------------------------------
+
+template <typename T, int kt_chunk_size>
+ChunkedGrid<T, kt_chunk_size>::ChunkedGrid(const ChunkedGrid & rhs):
+    m_default_element(rhs.m_default_element)
+{
+    m_chunks.reserve(rhs.chunk_count());
+    rhs.for_each_chunk([this] (const Vector & chunk_pos, const Chunk & chunk)
+        { m_chunks.emplace(chunk_pos, std::make_unique<Chunk>(chunk)); });
+}
+
+template <typename T, int kt_chunk_size>
+ChunkedGrid<T, kt_chunk_size> & ChunkedGrid<T, kt_chunk_size>::operator =
+    (const ChunkedGrid & rhs)
+{
+    if (this != &rhs) {
+        ChunkedGrid temp{rhs};
+        swap(temp);
+    }
+    return *this;
+}
+
+template <typename T, int kt_chunk_size>
+typename ChunkedGrid<T, kt_chunk_size>::ReferenceType
+    ChunkedGrid<T, kt_chunk_size>::operator () (int x, int y)
+{
+    Vector r{x, y};
+    auto local = local_position_of(r);
+    return ensure_chunk(chunk_position_of(r)).element_unchecked(local.x, local.y);
+}
+
+template <typename T, int kt_chunk_size>
+typename ChunkedGrid<T, kt_chunk_size>::ConstReferenceType
+    ChunkedGrid<T, kt_chunk_size>::operator () (int x, int y) const
+{
+    Vector r{x, y};
+    const auto * chunk = find_chunk(chunk_position_of(r));
+    if (!chunk) return m_default_element;
+    auto local = local_position_of(r);
+    return chunk->element_unchecked(local.x, local.y);
+}
+
+template <typename T, int kt_chunk_size>
+typename ChunkedGrid<T, kt_chunk_size>::Chunk *
+    ChunkedGrid<T, kt_chunk_size>::find_chunk
+    (const Vector & chunk_position) noexcept
+{
+    auto itr = m_chunks.find(chunk_position);
+    return itr == m_chunks.end() ? nullptr : itr->second.get();
+}
+
+template <typename T, int kt_chunk_size>
+const typename ChunkedGrid<T, kt_chunk_size>::Chunk *
+    ChunkedGrid<T, kt_chunk_size>::find_chunk
+    (const Vector & chunk_position) const noexcept
+{
+    auto itr = m_chunks.find(chunk_position);
+    return itr == m_chunks.end() ? nullptr : itr->second.get();
+}
+
+template <typename T, int kt_chunk_size>
+typename ChunkedGrid<T, kt_chunk_size>::Chunk &
+    ChunkedGrid<T, kt_chunk_size>::ensure_chunk(const Vector & chunk_position)
+{
+    if (auto * chunk = find_chunk(chunk_position)) return *chunk;
+    auto chunk = std::make_unique<Chunk>();
+    chunk->set_size(kt_chunk_size, kt_chunk_size, m_default_element);
+    return *m_chunks.emplace(chunk_position, std::move(chunk)).position->second;
+}
+
+template <typename T, int kt_chunk_size>
+bool ChunkedGrid<T, kt_chunk_size>::erase_chunk(const Vector & chunk_position) {
+    auto itr = m_chunks.find(chunk_position);
+    if (itr == m_chunks.end()) return false;
+    m_chunks.erase(itr);
+    return true;
+}
+
+template <typename T, int kt_chunk_size>
+template <typename Func>
+void ChunkedGrid<T, kt_chunk_size>::for_each_chunk(Func && f) {
+    for (auto itr = m_chunks.begin(); itr != m_chunks.end(); ++itr)
+        { f(itr->first, *itr->second); }
+}
+
+template <typename T, int kt_chunk_size>
+template <typename Func>
+void ChunkedGrid<T, kt_chunk_size>::for_each_chunk(Func && f) const {
+    for (auto itr = m_chunks.begin(); itr != m_chunks.end(); ++itr)
+        { f(itr->first, static_cast<const Chunk &>(*itr->second)); }
+}
+
+template <typename T, int kt_chunk_size>
+typename ChunkedGrid<T, kt_chunk_size>::SubGrid
+    ChunkedGrid<T, kt_chunk_size>::make_sub_grid
+    (Vector offset, int width, int height)
+{ return SubGrid{*this, offset, verify_size("make_sub_grid", width, height)}; }
+
+template <typename T, int kt_chunk_size>
+typename ChunkedGrid<T, kt_chunk_size>::ConstSubGrid
+    ChunkedGrid<T, kt_chunk_size>::make_sub_grid
+    (Vector offset, int width, int height) const
+{ return ConstSubGrid{*this, offset, verify_size("make_sub_grid", width, height)}; }
+
+template <typename T, int kt_chunk_size>
+void ChunkedGrid<T, kt_chunk_size>::swap(ChunkedGrid & rhs) noexcept {
+    m_chunks.swap(rhs.m_chunks);
+    std::swap(m_default_element, rhs.m_default_element);
+}
+
+template <typename T, int kt_chunk_size>
+/* private static */ typename ChunkedGrid<T, kt_chunk_size>::Size
+    ChunkedGrid<T, kt_chunk_size>::verify_size
+    (const char * caller, int width, int height)
+{
+    if (width < 0 || height < 0) {
+        throw std::invalid_argument("ChunkedGrid::" + std::string(caller) +
+                                    ": both dimensions must be non-negative "
+                                    "integers.");
+    }
+    return Size{width, height};
+}
+
+#endif // ifndef DOXYGEN_SHOULD_SKIP_THIS
+
+} // end of cul namespace
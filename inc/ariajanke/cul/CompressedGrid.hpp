@@ -0,0 +1,506 @@
+/****************************************************************************
+
+    MIT License
+
+    Copyright (c) 2021 Aria Janke
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+
+*****************************************************************************/
+
+
+#pragma once
+
+#include <ariajanke/cul/Grid.hpp>
+
+#include <algorithm>
+#include <cstdint>
+#include <iterator>
+
+namespace cul {
+
+template <typename T>
+class CompressedGrid;
+
+/** Forward iterator over the elements of one row of a CompressedGrid. */
+template <typename T>
+class CompressedGridRowIterator final {
+public:
+    using Parent            = CompressedGrid<T>;
+    using iterator_category = std::forward_iterator_tag;
+    using value_type        = T;
+    using difference_type   = std::ptrdiff_t;
+    using pointer           = const T *;
+    using reference         = const T &;
+
+    CompressedGridRowIterator() {}
+
+    /** Constructor specific for CompressedGrid, use its row function
+     *  instead.
+     *  @param run first run of the row (run length encoding only)
+     */
+    CompressedGridRowIterator
+        (const Parent & parent, int y, int x, const typename Parent::Run * run):
+        m_parent(&parent), m_run(run), m_y(y), m_x(x) {}
+
+    reference operator * () const;
+
+    pointer operator -> () const { return &**this; }
+
+    CompressedGridRowIterator & operator ++ ();
+
+    CompressedGridRowIterator operator ++ (int) {
+        auto t = *this;
+        ++(*this);
+        return t;
+    }
+
+    bool operator == (const CompressedGridRowIterator & rhs) const noexcept
+        { return m_x == rhs.m_x && m_y == rhs.m_y && m_parent == rhs.m_parent; }
+
+    bool operator != (const CompressedGridRowIterator & rhs) const noexcept
+        { return !(*this == rhs); }
+
+private:
+    const Parent * m_parent = nullptr;
+    const typename Parent::Run * m_run = nullptr;
+    int m_y = 0;
+    int m_x = 0;
+};
+
+/** One row of a CompressedGrid, iterable like a container. */
+template <typename T>
+class CompressedGridRow final {
+public:
+    using Iterator = CompressedGridRowIterator<T>;
+
+    CompressedGridRow(Iterator beg, Iterator end_, std::size_t size_):
+        m_begin(beg), m_end(end_), m_size(size_) {}
+
+    Iterator begin() const noexcept { return m_begin; }
+
+    Iterator end() const noexcept { return m_end; }
+
+    std::size_t size() const noexcept { return m_size; }
+
+private:
+    Iterator m_begin, m_end;
+    std::size_t m_size;
+};
+
+/** A read only copy of a Grid, kept in far less memory where it has long
+ *  runs of equal elements, or few distinct elements. Elements stay randomly
+ *  accessible.
+ *
+ *  One of two encodings is used:
+ *  - run length encoding: each row is kept as runs of equal elements,
+ *    accessing an element is a binary search of its row's runs
+ *  - palette: each distinct element is kept once, and each position holds
+ *    an index into the palette, packed at 0, 1, 2, 4 or 8 bits each
+ *
+ *  @tparam T must be equality comparable
+ */
+template <typename T>
+class CompressedGrid final {
+public:
+    enum class Encoding { run_length, palette };
+
+    struct Run final {
+        int end_x;
+        T value;
+    };
+
+    using Element            = T;
+    using ConstReferenceType = const T &;
+    using IndexType          = int;
+    using Vector             = Vector2<IndexType>;
+    using Size               = Size2<IndexType>;
+    using Row                = CompressedGridRow<T>;
+    using RowIterator        = CompressedGridRowIterator<T>;
+
+    /** greatest number of distinct elements the palette encoding handles */
+    static constexpr const std::size_t k_max_palette_size = 256;
+
+    CompressedGrid() {}
+
+    /** Copies a grid, choosing whichever encoding takes less memory. */
+    explicit CompressedGrid(const Grid<T> &);
+
+    /** Copies a grid using the given encoding.
+     *  @throws std::invalid_argument if palette encoding is asked for, and
+     *          the grid has more than k_max_palette_size distinct elements
+     */
+    CompressedGrid(const Grid<T> &, Encoding);
+
+    int width() const noexcept { return m_size.width; }
+
+    int height() const noexcept { return m_size.height; }
+
+    Size size2() const noexcept { return m_size; }
+
+    std::size_t size() const noexcept
+        { return std::size_t(width())*std::size_t(height()); }
+
+    bool is_empty() const noexcept { return size() == 0; }
+
+    bool has_position(int x, int y) const noexcept
+        { return x >= 0 && y >= 0 && x < width() && y < height(); }
+
+    bool has_position(const Vector & r) const noexcept
+        { return has_position(r.x, r.y); }
+
+    Encoding encoding() const noexcept { return m_encoding; }
+
+    /** @throws std::out_of_range if position is outside of the grid */
+    ConstReferenceType operator () (int x, int y) const;
+
+    ConstReferenceType operator () (const Vector & r) const
+        { return (*this)(r.x, r.y); }
+
+    /** @returns element at the given position, which must be inside the
+     *           grid (this is only asserted)
+     */
+    ConstReferenceType element_unchecked(int x, int y) const noexcept;
+
+    /** @throws std::out_of_range if y is not a row in the grid */
+    Row row(int y) const;
+
+    /** Calls f(begin_x, end_x, element) for each run of equal elements in a
+     *  row, in order. This is the fastest way to read a whole row.
+     *
+     *  @throws std::out_of_range if y is not a row in the grid
+     */
+    template <typename Func>
+    void for_each_run(int y, Func && f) const;
+
+    /** @returns a copy of every element, in a Grid */
+    Grid<T> to_grid() const;
+
+    /** @returns bytes taken by the encoded elements (not counting this
+     *           object itself)
+     */
+    std::size_t storage_size() const noexcept;
+
+    void swap(CompressedGrid &) noexcept;
+
+private:
+    friend class CompressedGridRowIterator<T>;
+
+    // (avoids std::vector<bool>, so that elements may be referred to)
+    struct PaletteEntry final {
+        T value;
+    };
+
+    using Word = std::uint64_t;
+    static constexpr const int k_word_bits = 64;
+
+    static std::vector<Run> make_runs
+        (const Grid<T> &, std::vector<std::size_t> & row_starts);
+
+    // @returns false if there are too many distinct elements
+    static bool make_palette
+        (const std::vector<Run> &, std::vector<PaletteEntry> & palette);
+
+    // @returns palette's size if el is not in it
+    static std::size_t find_in_palette
+        (const std::vector<PaletteEntry> & palette, const T & el);
+
+    static int bits_for_palette(std::size_t palette_size) noexcept;
+
+    void encode_palette();
+
+    const Run * find_run(int x, int y) const noexcept;
+
+    std::size_t palette_index_at(int x, int y) const noexcept;
+
+    std::out_of_range make_out_of_range_error(const char * caller) const;
+
+    Size m_size;
+    Encoding m_encoding = Encoding::run_length;
+    // run length encoding
+    std::vector<Run> m_runs;
+    std::vector<std::size_t> m_row_starts;
+    // palette encoding
+    std::vector<PaletteEntry> m_palette;
+    std::vector<Word> m_packed;
+    int m_bits_per_cell = 0;
+};
+
+// ----------------------------------------------------------------------------
+
+#ifndef DOXYGEN_SHOULD_SKIP_THIS
+
+template <typename T>
+typename CompressedGridRowIterator<T>::reference
+    CompressedGridRowIterator<T>::operator * () const
+{
+    if (m_run) return m_run->value;
+    return m_parent->m_palette[m_parent->palette_index_at(m_x, m_y)].value;
+}
+
+template <typename T>
+CompressedGridRowIterator<T> & CompressedGridRowIterator<T>::operator ++ () {
+    if (++m_x == m_parent->width()) return *this;
+    if (m_run && m_run->end_x == m_x) ++m_run;
+    return *this;
+}
+
+// ----------------------------------------------------------------------------
+
+template <typename T>
+CompressedGrid<T>::CompressedGrid(const Grid<T> & grid):
+    m_size(grid.size2())
+{
+    m_runs = make_runs(grid, m_row_starts);
+    std::vector<PaletteEntry> palette;
+    if (!make_palette(m_runs, palette)) return;
+
+    const auto run_length_size =
+          m_runs.size()*sizeof(Run) + m_row_starts.size()*sizeof(std::size_t);
+    const auto palette_size =
+          palette.size()*sizeof(PaletteEntry)
+        + (size()*std::size_t(bits_for_palette(palette.size())) + 7) / 8;
+    if (run_length_size <= palette_size) return;
+
+    m_palette = std::move(palette);
+    encode_palette();
+}
+
+template <typename T>
+CompressedGrid<T>::CompressedGrid(const Grid<T> & grid, Encoding encoding_):
+    m_size(grid.size2())
+{
+    m_runs = make_runs(grid, m_row_starts);
+    if (encoding_ == Encoding::run_length) return;
+
+    if (!make_palette(m_runs, m_palette)) {
+        throw std::invalid_argument("CompressedGrid::CompressedGrid: grid has "
+                                    "too many distinct elements for a "
+                                    "palette.");
+    }
+    encode_palette();
+}
+
+template <typename T>
+typename CompressedGrid<T>::ConstReferenceType
+    CompressedGrid<T>::operator () (int x, int y) const
+{
+    if (!has_position(x, y)) throw make_out_of_range_error("operator()");
+    return element_unchecked(x, y);
+}
+
+template <typename T>
+typename CompressedGrid<T>::ConstReferenceType
+    CompressedGrid<T>::element_unchecked(int x, int y) const noexcept
+{
+    assert(has_position(x, y));
+    if (m_encoding == Encoding::palette)
+        { return m_palette[palette_index_at(x, y)].value; }
+    return find_run(x, y)->value;
+}
+
+template <typename T>
+typename CompressedGrid<T>::Row CompressedGrid<T>::row(int y) const {
+    if (!has_position(0, y)) throw make_out_of_range_error("row");
+    const Run * first_run = m_encoding == Encoding::run_length ?
+        m_runs.data() + m_row_starts[std::size_t(y)] : nullptr;
+    return Row{RowIterator{*this, y, 0, first_run},
+               RowIterator{*this, y, width(), nullptr},
+               std::size_t(width())};
+}
+
+template <typename T>
+template <typename Func>
+void CompressedGrid<T>::for_each_run(int y, Func && f) const {
+    if (!has_position(0, y)) throw make_out_of_range_error("for_each_run");
+    if (m_encoding == Encoding::run_length) {
+        auto beg = m_runs.begin() + std::ptrdiff_t(m_row_starts[std::size_t(y)]    );
+        auto end = m_runs.begin() + std::ptrdiff_t(m_row_starts[std::size_t(y) + 1]);
+        int begin_x = 0;
+        for (auto itr = beg; itr != end; ++itr) {
+            f(begin_x, itr->end_x, static_cast<const T &>(itr->value));
+            begin_x = itr->end_x;
+        }
+        return;
+    }
+    int begin_x = 0;
+    auto index = palette_index_at(0, y);
+    for (int x = 1; x != width(); ++x) {
+        auto next_index = palette_index_at(x, y);
+        if (next_index == index) continue;
+        f(begin_x, x, static_cast<const T &>(m_palette[index].value));
+        begin_x = x;
+        index = next_index;
+    }
+    f(begin_x, width(), static_cast<const T &>(m_palette[index].value));
+}
+
+template <typename T>
+Grid<T> CompressedGrid<T>::to_grid() const {
+    Grid<T> rv;
+    rv.set_size(width(), height());
+    for (int y = 0; y != height(); ++y) {
+        auto row_begin = rv.begin() + std::ptrdiff_t(y)*width();
+        for_each_run(y, [row_begin] (int begin_x, int end_x, const T & el)
+            { std::fill(row_begin + begin_x, row_begin + end_x, el); });
+    }
+    return rv;
+}
+
+template <typename T>
+std::size_t CompressedGrid<T>::storage_size() const noexcept {
+    return   m_runs.size()*sizeof(Run)
+           + m_row_starts.size()*sizeof(std::size_t)
+           + m_palette.size()*sizeof(PaletteEntry)
+           + m_packed.size()*sizeof(Word);
+}
+
+template <typename T>
+void CompressedGrid<T>::swap(CompressedGrid & rhs) noexcept {
+    std::swap(m_size, rhs.m_size);
+    std::swap(m_encoding, rhs.m_encoding);
+    m_runs.swap(rhs.m_runs);
+    m_row_starts.swap(rhs.m_row_starts);
+    m_palette.swap(rhs.m_palette);
+    m_packed.swap(rhs.m_packed);
+    std::swap(m_bits_per_cell, rhs.m_bits_per_cell);
+}
+
+template <typename T>
+/* private static */ std::vector<typename CompressedGrid<T>::Run>
+    CompressedGrid<T>::make_runs
+    (const Grid<T> & grid, std::vector<std::size_t> & row_starts)
+{
+    std::vector<Run> runs;
+    row_starts.clear();
+    row_starts.reserve(std::size_t(grid.height()) + 1);
+    for (int y = 0; y != grid.height(); ++y) {
+        row_starts.push_back(runs.size());
+        for (int x = 0; x != grid.width(); ++x) {
+            const T & el = grid.element_unchecked(x, y);
+            if (x != 0 && runs.back().value == el) {
+                runs.back().end_x = x + 1;
+            } else {
+                runs.push_back(Run{x + 1, el});
+            }
+        }
+    }
+    row_starts.push_back(runs.size());
+    runs.shrink_to_fit();
+    return runs;
+}
+
+template <typename T>
+/* private static */ bool CompressedGrid<T>::make_palette
+    (const std::vector<Run> & runs, std::vector<PaletteEntry> & palette)
+{
+    palette.clear();
+    for (const auto & run : runs) {
+        if (find_in_palette(palette, run.value) != palette.size()) continue;
+        if (palette.size() == k_max_palette_size) return false;
+        palette.push_back(PaletteEntry{run.value});
+    }
+    return true;
+}
+
+template <typename T>
+/* private static */ std::size_t CompressedGrid<T>::find_in_palette
+    (const std::vector<PaletteEntry> & palette, const T & el)
+{
+    return std::size_t(std::find_if(palette.begin(), palette.end(),
+        [&el] (const PaletteEntry & entry) { return entry.value == el; })
+        - palette.begin());
+}
+
+template <typename T>
+/* private static */ int CompressedGrid<T>::bits_for_palette
+    (std::size_t palette_size) noexcept
+{
+    // widths divide a word evenly, so no index spans two words
+    if (palette_size <= 1) return 0;
+    if (palette_size <= 2) return 1;
+    if (palette_size <= 4) return 2;
+    if (palette_size <= 16) return 4;
+    return 8;
+}
+
+template <typename T>
+/* private */ void CompressedGrid<T>::encode_palette() {
+    m_encoding = Encoding::palette;
+    m_bits_per_cell = bits_for_palette(m_palette.size());
+    m_packed.clear();
+    if (m_bits_per_cell != 0) {
+        // each run's palette index is only searched for once
+        const auto cells_per_word = std::size_t(k_word_bits / m_bits_per_cell);
+        m_packed.resize((size() + cells_per_word - 1) / cells_per_word, 0);
+        for (int y = 0; y != height(); ++y) {
+            auto beg = m_runs.begin() + std::ptrdiff_t(m_row_starts[std::size_t(y)]    );
+            auto end = m_runs.begin() + std::ptrdiff_t(m_row_starts[std::size_t(y) + 1]);
+            const auto row_start = std::size_t(y)*std::size_t(width());
+            auto i = row_start;
+            for (auto itr = beg; itr != end; ++itr) {
+                auto index = Word(find_in_palette(m_palette, itr->value));
+                for (; i != row_start + std::size_t(itr->end_x); ++i) {
+                    m_packed[i / cells_per_word] |=
+                        index << ((i % cells_per_word)*std::size_t(m_bits_per_cell));
+                }
+            }
+        }
+    }
+    m_runs.clear();
+    m_runs.shrink_to_fit();
+    m_row_starts.clear();
+    m_row_starts.shrink_to_fit();
+}
+
+template <typename T>
+/* private */ const typename CompressedGrid<T>::Run *
+    CompressedGrid<T>::find_run(int x, int y) const noexcept
+{
+    auto beg = m_runs.data() + m_row_starts[std::size_t(y)    ];
+    auto end = m_runs.data() + m_row_starts[std::size_t(y) + 1];
+    return std::upper_bound(beg, end, x,
+        [] (int x_, const Run & run) { return x_ < run.end_x; });
+}
+
+template <typename T>
+/* private */ std::size_t CompressedGrid<T>::palette_index_at
+    (int x, int y) const noexcept
+{
+    if (m_bits_per_cell == 0) return 0;
+    const auto cells_per_word = std::size_t(k_word_bits / m_bits_per_cell);
+    const auto i = std::size_t(x) + std::size_t(y)*std::size_t(width());
+    const auto mask = (Word(1) << m_bits_per_cell) - 1;
+    return std::size_t(  (m_packed[i / cells_per_word]
+                      >> ((i % cells_per_word)*std::size_t(m_bits_per_cell))) & mask);
+}
+
+template <typename T>
+/* private */ std::out_of_range CompressedGrid<T>::make_out_of_range_error
+    (const char * caller) const
+{
+    return std::out_of_range("CompressedGrid::" + std::string(caller) + ": "
+                             "requested position is out of range, size: width "
+                             + std::to_string(width()) + " height "
+                             + std::to_string(height()));
+}
+
+#endif // ifndef DOXYGEN_SHOULD_SKIP_THIS
+
+} // end of cul namespace
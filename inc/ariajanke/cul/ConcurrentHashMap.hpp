@@ -0,0 +1,340 @@
+/****************************************************************************
+
+    MIT License
+
+    Copyright (c) 2023 Aria Janke
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+
+*****************************************************************************/
+
+
+#pragma once
+
+#include <ariajanke/cul/HashMap.hpp>
+
+#include <array>
+#include <mutex>
+#include <optional>
+#include <utility>
+#include <shared_mutex>
+
+namespace cul {
+
+/** A HashMap which may be used from many threads at once.
+ *
+ *  Elements are spread over a fixed number of shards (chosen by the high
+ *  bits of each key's hash), each being its own HashMap with its own
+ *  reader/writer lock. Threads working on different shards never wait on
+ *  each other, and any number of threads may read a shard together.
+ *
+ *  Nothing here hands out iterators or references, as those could outlive
+ *  the lock that protects them. Elements are instead copied out, or visited
+ *  while the lock is held.
+ *
+ *  @tparam kt_shard_count number of shards, must be a power of two
+ */
+template <
+    typename KeyT,
+    typename ElementT,
+    typename HashT = std::hash<KeyT>,
+    typename KeyEqualT = std::equal_to<void>,
+    typename AllocatorT = std::allocator<std::pair<KeyT, std::aligned_storage_t<sizeof(ElementT)>>>,
+    typename PolicyT = HashMapDefaultPolicy,
+    std::size_t kt_shard_count = 16
+>
+class ConcurrentHashMap final {
+public:
+    using KeyType = KeyT;
+    using ElementType = ElementT;
+    using Hasher = HashT;
+    using KeyEquality = KeyEqualT;
+    using Allocator = AllocatorT;
+    using Policy = PolicyT;
+    using ShardMap = HashMap
+        <KeyT, ElementT, HashT, KeyEqualT, AllocatorT, PolicyT>;
+
+    static constexpr const std::size_t k_shard_count = kt_shard_count;
+
+    static_assert(   kt_shard_count != 0
+                  && (kt_shard_count & (kt_shard_count - 1)) == 0,
+                  "Shard count must be a power of two");
+
+    explicit ConcurrentHashMap
+        (KeyType empty_key, const Allocator & allocator_ = Allocator{}):
+        m_shards(make_shards
+            (empty_key, allocator_, std::make_index_sequence<kt_shard_count>{}))
+    {}
+
+    ConcurrentHashMap(const ConcurrentHashMap &) = delete;
+
+    ConcurrentHashMap & operator = (const ConcurrentHashMap &) = delete;
+
+    /** Removes all elements, one shard at a time. */
+    void clear();
+
+    /** @returns true if an element was removed */
+    template <typename OtherKeyType>
+    bool erase(const OtherKeyType & key);
+
+    /** @returns a copy of the element with the given key, if present */
+    template <typename OtherKeyType>
+    std::optional<ElementType> find(const OtherKeyType & key) const;
+
+    /** Calls a function on each shard's map, with that shard locked for
+     *  writing.
+     *
+     *  @param f called as f(ShardMap &), shards may be visited in any order
+     */
+    template <typename Func>
+    void for_each_shard(Func && f);
+
+    /** Calls a function on each shard's map, with that shard locked for
+     *  reading.
+     *
+     *  @param f called as f(const ShardMap &)
+     */
+    template <typename Func>
+    void for_each_shard(Func && f) const;
+
+    /** Inserts an element, or assigns over an existing element with the
+     *  same key.
+     *  @returns true if a new element was inserted
+     */
+    template <typename OtherKeyType, typename OtherElementType>
+    bool insert_or_assign(OtherKeyType && key, OtherElementType && element);
+
+    /** Reserves room in every shard, as if keys are spread evenly. */
+    void reserve(std::size_t for_at_least_this_many_elements);
+
+    /** @returns total number of elements, which may already be stale if
+     *           other threads are making changes
+     */
+    std::size_t size() const;
+
+    /** Calls a function on the element with the given key, with its shard
+     *  locked for writing.
+     *
+     *  @param f called as f(ElementType &)
+     *  @returns true if there was an element to call the function on
+     */
+    template <typename OtherKeyType, typename Func>
+    bool visit(const OtherKeyType & key, Func && f);
+
+    /** Calls a function on the element with the given key, with its shard
+     *  locked for reading.
+     *
+     *  @param f called as f(const ElementType &)
+     *  @returns true if there was an element to call the function on
+     */
+    template <typename OtherKeyType, typename Func>
+    bool visit(const OtherKeyType & key, Func && f) const;
+
+private:
+    // on its own cache line, so that locking one shard does not slow down
+    // threads working on neighboring shards
+    struct alignas(64) Shard final {
+        Shard(const KeyType & empty_key, const Allocator & allocator_):
+            map(empty_key, allocator_) {}
+
+        mutable std::shared_mutex mutex;
+        ShardMap map;
+    };
+
+    using SharedLock = std::shared_lock<std::shared_mutex>;
+    using UniqueLock = std::unique_lock<std::shared_mutex>;
+
+    template <std::size_t ... kt_indices>
+    static std::array<Shard, kt_shard_count> make_shards
+        (const KeyType & empty_key, const Allocator & allocator_,
+         std::index_sequence<kt_indices...>)
+    {
+        return std::array<Shard, kt_shard_count>
+            {{ ((void)kt_indices, Shard{empty_key, allocator_})... }};
+    }
+
+    /** @returns which shard a hash belongs to
+     *  @note the hash is remixed with a different multiplier than the one
+     *        for control bytes, so that shards do not share tag bits
+     */
+    static std::size_t shard_index_for(std::size_t hash) noexcept;
+
+    template <typename OtherKeyType, typename Func>
+    bool visit_impl(const OtherKeyType & key, Func && f) const;
+
+    std::array<Shard, kt_shard_count> m_shards;
+};
+
+// ----------------------------------------------------------------------------
+
+#define MACRO_CONCURRENT_TEMPLATES \
+    template < \
+        typename KeyT, \
+        typename ElementT, \
+        typename HashT, \
+        typename KeyEqualT, \
+        typename AllocatorT, \
+        typename PolicyT, \
+        std::size_t kt_shard_count \
+    >
+
+#define MACRO_CONCURRENT_CLASSNAME \
+    ConcurrentHashMap \
+        <KeyT, ElementT, HashT, KeyEqualT, AllocatorT, PolicyT, kt_shard_count>
+
+MACRO_CONCURRENT_TEMPLATES
+void MACRO_CONCURRENT_CLASSNAME::clear() {
+    for (auto & shard : m_shards) {
+        UniqueLock lock{shard.mutex};
+        shard.map.clear();
+    }
+}
+
+MACRO_CONCURRENT_TEMPLATES
+template <typename OtherKeyType>
+bool MACRO_CONCURRENT_CLASSNAME::erase(const OtherKeyType & key) {
+    const auto hash = ShardMap::detail_hash(key);
+    auto & shard = m_shards[shard_index_for(hash)];
+    UniqueLock lock{shard.mutex};
+    auto itr = shard.map.detail_find_hashed(key, hash);
+    if (itr == shard.map.end()) return false;
+    shard.map.erase(itr);
+    return true;
+}
+
+MACRO_CONCURRENT_TEMPLATES
+template <typename OtherKeyType>
+std::optional<ElementT> MACRO_CONCURRENT_CLASSNAME::find
+    (const OtherKeyType & key) const
+{
+    std::optional<ElementType> rv;
+    visit_impl(key, [&rv] (const ElementType & el) { rv = el; });
+    return rv;
+}
+
+MACRO_CONCURRENT_TEMPLATES
+template <typename Func>
+void MACRO_CONCURRENT_CLASSNAME::for_each_shard(Func && f) {
+    for (auto & shard : m_shards) {
+        UniqueLock lock{shard.mutex};
+        f(shard.map);
+    }
+}
+
+MACRO_CONCURRENT_TEMPLATES
+template <typename Func>
+void MACRO_CONCURRENT_CLASSNAME::for_each_shard(Func && f) const {
+    for (auto & shard : m_shards) {
+        SharedLock lock{shard.mutex};
+        f(static_cast<const ShardMap &>(shard.map));
+    }
+}
+
+MACRO_CONCURRENT_TEMPLATES
+template <typename OtherKeyType, typename OtherElementType>
+bool MACRO_CONCURRENT_CLASSNAME::insert_or_assign
+    (OtherKeyType && key, OtherElementType && element)
+{
+    const auto hash = ShardMap::detail_hash(key);
+    auto & shard = m_shards[shard_index_for(hash)];
+    UniqueLock lock{shard.mutex};
+    auto itr = shard.map.detail_find_hashed(key, hash);
+    if (itr != shard.map.end()) {
+        itr->second = std::forward<OtherElementType>(element);
+        return false;
+    }
+    shard.map.detail_emplace_hashed
+        (hash, std::forward<OtherKeyType>(key),
+         std::forward<OtherElementType>(element));
+    return true;
+}
+
+MACRO_CONCURRENT_TEMPLATES
+void MACRO_CONCURRENT_CLASSNAME::reserve
+    (std::size_t for_at_least_this_many_elements)
+{
+    // keys never spread perfectly, so leave a little extra room
+    auto per_shard = for_at_least_this_many_elements / kt_shard_count;
+    per_shard += per_shard / 8 + 1;
+    for_each_shard([per_shard] (ShardMap & map) { map.reserve(per_shard); });
+}
+
+MACRO_CONCURRENT_TEMPLATES
+std::size_t MACRO_CONCURRENT_CLASSNAME::size() const {
+    std::size_t rv = 0;
+    for_each_shard([&rv] (const ShardMap & map) { rv += map.size(); });
+    return rv;
+}
+
+MACRO_CONCURRENT_TEMPLATES
+template <typename OtherKeyType, typename Func>
+bool MACRO_CONCURRENT_CLASSNAME::visit
+    (const OtherKeyType & key, Func && f)
+{
+    const auto hash = ShardMap::detail_hash(key);
+    auto & shard = m_shards[shard_index_for(hash)];
+    UniqueLock lock{shard.mutex};
+    auto itr = shard.map.detail_find_hashed(key, hash);
+    if (itr == shard.map.end()) return false;
+    f(itr->second);
+    return true;
+}
+
+MACRO_CONCURRENT_TEMPLATES
+template <typename OtherKeyType, typename Func>
+bool MACRO_CONCURRENT_CLASSNAME::visit
+    (const OtherKeyType & key, Func && f) const
+{ return visit_impl(key, std::forward<Func>(f)); }
+
+MACRO_CONCURRENT_TEMPLATES
+/* private static */ std::size_t MACRO_CONCURRENT_CLASSNAME::shard_index_for
+    (std::size_t hash) noexcept
+{
+    if constexpr (kt_shard_count == 1) {
+        return 0;
+    } else {
+        constexpr int k_shard_bits = [] {
+            int bits = 0;
+            for (auto n = kt_shard_count; n != 1; n /= 2)
+                { ++bits; }
+            return bits;
+        } ();
+        return std::size_t
+            ((std::uint64_t(hash)*0xC2B2AE3D27D4EB4Full) >> (64 - k_shard_bits));
+    }
+}
+
+MACRO_CONCURRENT_TEMPLATES
+template <typename OtherKeyType, typename Func>
+/* private */ bool MACRO_CONCURRENT_CLASSNAME::visit_impl
+    (const OtherKeyType & key, Func && f) const
+{
+    const auto hash = ShardMap::detail_hash(key);
+    const auto & shard = m_shards[shard_index_for(hash)];
+    SharedLock lock{shard.mutex};
+    auto itr = shard.map.detail_find_hashed(key, hash);
+    if (itr == shard.map.end()) return false;
+    f(static_cast<const ElementType &>(itr->second));
+    return true;
+}
+
+#undef MACRO_CONCURRENT_TEMPLATES
+#undef MACRO_CONCURRENT_CLASSNAME
+
+} // end of cul namespace
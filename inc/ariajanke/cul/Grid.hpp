@@ -32,11 +32,53 @@
 #include <functional>
 #include <limits>
 #include <string>
+#include <type_traits>
 
 #include <ariajanke/cul/Vector2.hpp>
 
+#include <cassert>
+
 namespace cul {
 
+/** A contiguous run of grid elements (a row, or part of one), much like
+ *  C++20's std::span. Loops over one compile to plain pointer loops.
+ *
+ *  Only valid for as long as the grid it came from is not resized.
+ */
+template <typename T>
+class GridRow final {
+public:
+    using Element  = std::remove_const_t<T>;
+    using Iterator = T *;
+
+    GridRow() {}
+
+    GridRow(T * begin_, std::size_t size_):
+        m_begin(begin_), m_size(size_) {}
+
+    /** Writable rows convert to constant ones. */
+    template <typename OtherT,
+              typename = std::enable_if_t<std::is_same_v<const OtherT, T>>>
+    GridRow(const GridRow<OtherT> & rhs):
+        m_begin(rhs.data()), m_size(rhs.size()) {}
+
+    Iterator begin() const noexcept { return m_begin; }
+
+    Iterator end() const noexcept { return m_begin + m_size; }
+
+    T * data() const noexcept { return m_begin; }
+
+    bool is_empty() const noexcept { return m_size == 0; }
+
+    std::size_t size() const noexcept { return m_size; }
+
+    T & operator [] (std::size_t i) const noexcept { return m_begin[i]; }
+
+private:
+    T * m_begin = nullptr;
+    std::size_t m_size = 0;
+};
+
 /** Container class meant to be like std::vector but laid out in two
  *  diminsions.
  */
@@ -51,7 +93,8 @@ public:
     using ConstReferenceType = typename std::vector<T>::const_reference;
     using Vector             = Vector2<IndexType>;
     using Size               = Size2<IndexType>;
-
+    using Row                = GridRow<T>;
+    using ConstRow           = GridRow<const T>;
 
     Grid() {}
     explicit Grid(std::initializer_list<std::initializer_list<T>>);
@@ -95,6 +138,8 @@ public:
      *  @param width new width
      *  @param height new height
      *  @param e default element value to fill the space
+     *  @throws std::invalid_argument if either dimension is negative, or if
+     *          the grid would have more elements than an int can count
      */
     void set_size(int width, int height, Element && e = Element());
     
@@ -165,6 +210,33 @@ public:
     /** @returns the size of the grid in two dimensions: width and height */
     Size size2() const noexcept;
 
+    /** @returns element at the given position, which must be inside the
+     *           grid (this is only asserted, nothing is thrown)
+     *  @note for hot loops, where positions are already known to be good
+     */
+    ReferenceType element_unchecked(int x, int y) noexcept;
+
+    /** @copydoc Grid<T>::element_unchecked(int,int) */
+    ConstReferenceType element_unchecked(int x, int y) const noexcept;
+
+    /** @copydoc Grid<T>::element_unchecked(int,int) */
+    ReferenceType element_unchecked(const Vector & r) noexcept
+        { return element_unchecked(r.x, r.y); }
+
+    /** @copydoc Grid<T>::element_unchecked(int,int) */
+    ConstReferenceType element_unchecked(const Vector & r) const noexcept
+        { return element_unchecked(r.x, r.y); }
+
+    /** @returns all elements of row y, which are contiguous
+     *  @throws if y is not a row of the grid
+     *  @note not available for Grid<bool>, as std::vector<bool> packs its
+     *        elements
+     */
+    Row row(int y);
+
+    /** @copydoc Grid<T>::row(int) */
+    ConstRow row(int y) const;
+
     // -------------------------- STL like functions ---------------------------
 
     ReferenceType      operator () (const Vector &);
@@ -263,7 +335,12 @@ void Grid<T>::set_size(int width_, int height_, const Element & obj) {
     if (width_ < 0 || height_ < 0) {
         throw std::invalid_argument("Grid::set_size: both dimensions must be non-negative integers.");
     }
-    m_elements.resize(std::size_t(width_*height_), obj);
+    // positions are ints, so must be the element count
+    const auto count = std::size_t(width_)*std::size_t(height_);
+    if (count > std::size_t(std::numeric_limits<int>::max())) {
+        throw std::invalid_argument("Grid::set_size: exceeds maximum value of integer type.");
+    }
+    m_elements.resize(count, obj);
     m_width = width_;
 }
 
@@ -351,6 +428,34 @@ template <typename T>
 typename Grid<T>::Size Grid<T>::size2() const noexcept
     { return Size{width(), height()}; }
 
+template <typename T>
+typename Grid<T>::ReferenceType
+    Grid<T>::element_unchecked(int x, int y) noexcept
+{
+    assert(has_position(x, y));
+    return m_elements[to_index(x, y)];
+}
+
+template <typename T>
+typename Grid<T>::ConstReferenceType
+    Grid<T>::element_unchecked(int x, int y) const noexcept
+{
+    assert(has_position(x, y));
+    return m_elements[to_index(x, y)];
+}
+
+template <typename T>
+typename Grid<T>::Row Grid<T>::row(int y) {
+    if (!has_position(0, y)) throw make_out_of_range_error();
+    return Row{m_elements.data() + to_index(0, y), std::size_t(width())};
+}
+
+template <typename T>
+typename Grid<T>::ConstRow Grid<T>::row(int y) const {
+    if (!has_position(0, y)) throw make_out_of_range_error();
+    return ConstRow{m_elements.data() + to_index(0, y), std::size_t(width())};
+}
+
 template <typename T>
 void Grid<T>::swap(Grid<T> & other) noexcept {
     m_elements.swap(other.m_elements);
@@ -0,0 +1,217 @@
+/****************************************************************************
+
+    MIT License
+
+    Copyright (c) 2021 Aria Janke
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+
+*****************************************************************************/
+
+
+#pragma once
+
+#include <ariajanke/cul/SubGrid.hpp>
+
+#include <algorithm>
+#include <cstring>
+#include <functional>
+
+namespace cul {
+
+// All of these work on any mix of Grids, SubGrids and ConstSubGrids, a row
+// at a time (using each one's row function). None work with Grid<bool>, as
+// its elements are packed.
+
+/** Copies every element of source into the same position of destination.
+ *  Regions may overlap (as two sub grids of one grid may), the result is
+ *  as if source was copied somewhere else first.
+ *
+ *  Trivially copyable elements of the same type are copied with memmove.
+ *
+ *  @throws std::invalid_argument if sizes differ
+ */
+template <typename SourceGridType, typename DestinationGridType>
+void copy_sub_grid(const SourceGridType & source, DestinationGridType && destination);
+
+/** Assigns value to every element of a grid or sub grid. */
+template <typename GridType, typename T>
+void fill(GridType && grid, const T & value);
+
+/** Assigns every element of destination f of the same position's element
+ *  in source. Source and destination may be the same region, but should
+ *  not otherwise overlap.
+ *
+ *  @throws std::invalid_argument if sizes differ
+ */
+template <typename SourceGridType, typename DestinationGridType, typename Func>
+void transform_into
+    (const SourceGridType & source, DestinationGridType && destination, Func && f);
+
+/** @returns a copy of source, mirrored left to right */
+template <typename GridType>
+Grid<typename GridType::Element> flip_horizontal(const GridType & source);
+
+/** @returns a copy of source, mirrored top to bottom */
+template <typename GridType>
+Grid<typename GridType::Element> flip_vertical(const GridType & source);
+
+/** @returns a copy of source, turned a quarter turn clockwise (so that
+ *           its width and height are swapped)
+ */
+template <typename GridType>
+Grid<typename GridType::Element> rotate_90_clockwise(const GridType & source);
+
+/** @returns a copy of source, turned a quarter turn counter clockwise */
+template <typename GridType>
+Grid<typename GridType::Element> rotate_90_counterclockwise(const GridType & source);
+
+// ----------------------------------------------------------------------------
+
+#ifndef DOXYGEN_SHOULD_SKIP_THIS
+
+namespace detail {
+
+template <typename LhsGridType, typename RhsGridType>
+void verify_same_grid_sizes
+    (const char * caller, const LhsGridType & lhs, const RhsGridType & rhs)
+{
+    if (lhs.width() == rhs.width() && lhs.height() == rhs.height()) return;
+    throw std::invalid_argument(std::string{caller} + ": source and "
+                                "destination must be the same size.");
+}
+
+template <typename SourceRow, typename DestinationRow>
+void copy_grid_row(const SourceRow & source, const DestinationRow & destination) {
+    using SourceElement      = typename SourceRow::Element;
+    using DestinationElement = typename DestinationRow::Element;
+    if constexpr (   std::is_same_v<SourceElement, DestinationElement>
+                  && std::is_trivially_copyable_v<SourceElement>)
+    {
+        std::memmove(destination.data(), source.data(),
+                     source.size()*sizeof(SourceElement));
+    } else if (std::less<const void *>{}(destination.data(), source.data())) {
+        std::copy(source.begin(), source.end(), destination.begin());
+    } else {
+        std::copy_backward(source.begin(), source.end(), destination.end());
+    }
+}
+
+template <typename GridType>
+Grid<typename GridType::Element> make_grid_for
+    (const GridType & source, bool swap_dimensions)
+{
+    Grid<typename GridType::Element> rv;
+    if (swap_dimensions)
+        { rv.set_size(source.height(), source.width()); }
+    else
+        { rv.set_size(source.width(), source.height()); }
+    return rv;
+}
+
+} // end of detail namespace -> into ::cul
+
+template <typename SourceGridType, typename DestinationGridType>
+void copy_sub_grid(const SourceGridType & source, DestinationGridType && destination) {
+    detail::verify_same_grid_sizes("copy_sub_grid", source, destination);
+    if (source.width() == 0 || source.height() == 0) return;
+    // rows are copied in the order that never overwrites a source row
+    // before it's read
+    const void * source_start      = source.row(0).data();
+    const void * destination_start = destination.row(0).data();
+    if (std::less<const void *>{}(source_start, destination_start)) {
+        for (int y = source.height() - 1; y != -1; --y)
+            { detail::copy_grid_row(source.row(y), destination.row(y)); }
+    } else {
+        for (int y = 0; y != source.height(); ++y)
+            { detail::copy_grid_row(source.row(y), destination.row(y)); }
+    }
+}
+
+template <typename GridType, typename T>
+void fill(GridType && grid, const T & value) {
+    for (int y = 0; y != grid.height(); ++y) {
+        auto row = grid.row(y);
+        std::fill(row.begin(), row.end(), value);
+    }
+}
+
+template <typename SourceGridType, typename DestinationGridType, typename Func>
+void transform_into
+    (const SourceGridType & source, DestinationGridType && destination, Func && f)
+{
+    detail::verify_same_grid_sizes("transform_into", source, destination);
+    for (int y = 0; y != source.height(); ++y) {
+        auto source_row = source.row(y);
+        std::transform(source_row.begin(), source_row.end(),
+                       destination.row(y).begin(), f);
+    }
+}
+
+template <typename GridType>
+Grid<typename GridType::Element> flip_horizontal(const GridType & source) {
+    auto rv = detail::make_grid_for(source, false);
+    for (int y = 0; y != source.height(); ++y) {
+        auto source_row = source.row(y);
+        std::reverse_copy(source_row.begin(), source_row.end(), rv.row(y).begin());
+    }
+    return rv;
+}
+
+template <typename GridType>
+Grid<typename GridType::Element> flip_vertical(const GridType & source) {
+    auto rv = detail::make_grid_for(source, false);
+    for (int y = 0; y != source.height(); ++y) {
+        auto source_row = source.row(y);
+        std::copy(source_row.begin(), source_row.end(),
+                  rv.row(source.height() - 1 - y).begin());
+    }
+    return rv;
+}
+
+template <typename GridType>
+Grid<typename GridType::Element> rotate_90_clockwise(const GridType & source) {
+    // source row y becomes column (height - 1 - y)
+    auto rv = detail::make_grid_for(source, true);
+    for (int y = 0; y != source.height(); ++y) {
+        auto source_row = source.row(y);
+        const int column = source.height() - 1 - y;
+        for (int x = 0; x != source.width(); ++x)
+            { rv.element_unchecked(column, x) = source_row[std::size_t(x)]; }
+    }
+    return rv;
+}
+
+template <typename GridType>
+Grid<typename GridType::Element> rotate_90_counterclockwise(const GridType & source) {
+    // source row y becomes column y, read from the bottom up
+    auto rv = detail::make_grid_for(source, true);
+    for (int y = 0; y != source.height(); ++y) {
+        auto source_row = source.row(y);
+        for (int x = 0; x != source.width(); ++x) {
+            rv.element_unchecked(y, source.width() - 1 - x) =
+                source_row[std::size_t(x)];
+        }
+    }
+    return rv;
+}
+
+#endif // ifndef DOXYGEN_SHOULD_SKIP_THIS
+
+} // end of cul namespace
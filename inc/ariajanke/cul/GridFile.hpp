@@ -0,0 +1,350 @@
+/****************************************************************************
+
+    MIT License
+
+    Copyright (c) 2021 Aria Janke
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+
+*****************************************************************************/
+
+
+#pragma once
+
+#include <ariajanke/cul/Grid.hpp>
+
+#include <cstdint>
+#include <fstream>
+#include <string>
+
+namespace cul {
+
+/** Describes the grid stored in a grid file.
+ *
+ *  A grid file is a fixed size header followed by the raw bytes of each row
+ *  of the grid, first to last. The header begins with a magic string, a
+ *  byte order mark, and the fields below; and is padded out so that the
+ *  first element is aligned to k_data_offset bytes.
+ *
+ *  Files are only readable on machines with the same byte order (and
+ *  element layout) as the one that wrote them.
+ */
+struct GridFileHeader final {
+    static constexpr const std::uint32_t k_current_version = 1;
+    static constexpr const std::size_t   k_data_offset     = 64;
+
+    std::uint32_t version      = k_current_version;
+    std::uint32_t element_size = 0;
+    std::int32_t  width        = 0;
+    std::int32_t  height       = 0;
+
+    /** @returns size of all element data in bytes */
+    std::size_t data_size() const noexcept
+        { return std::size_t(element_size)*std::size_t(width)*std::size_t(height); }
+};
+
+/** Writes a header, padded to GridFileHeader::k_data_offset bytes.
+ *  @throws std::runtime_error if the stream fails
+ */
+void write_grid_file_header(std::ostream &, const GridFileHeader &);
+
+/** Reads a header from the first GridFileHeader::k_data_offset bytes.
+ *  @throws std::runtime_error if there are too few bytes, or if they are not
+ *          a grid file header this library can read
+ */
+GridFileHeader read_grid_file_header(const void * bytes, std::size_t length);
+
+/** Reads a header from a stream, leaving it at the first element.
+ *  @copydoc read_grid_file_header(const void*,std::size_t)
+ */
+GridFileHeader read_grid_file_header(std::istream &);
+
+/** Writes a grid in the grid file format, one row at a time.
+ *  @throws std::runtime_error if the stream fails
+ */
+template <typename T>
+void save_grid(std::ostream &, const Grid<T> &);
+
+/** @copydoc save_grid(std::ostream&,const Grid<T>&) */
+template <typename T>
+void save_grid(const std::string & filename, const Grid<T> &);
+
+/** Reads a grid in the grid file format, one row at a time.
+ *  @throws std::runtime_error if the stream fails, or its header does not
+ *          describe a grid of this element type
+ */
+template <typename T>
+Grid<T> load_grid(std::istream &);
+
+/** @copydoc load_grid(std::istream&) */
+template <typename T>
+Grid<T> load_grid(const std::string & filename);
+
+/** Maps a whole grid file into memory, read only, validating its header.
+ *  Pages are loaded by the OS as elements are read, so opening even a very
+ *  large file costs very little.
+ *
+ *  @note Implementation is platform specific, where memory mapping is not
+ *        available, the file is read into memory instead.
+ */
+class MappedGridFile final {
+public:
+    MappedGridFile() {}
+
+    /** @throws std::runtime_error if the file cannot be opened, or is not a
+     *          complete grid file
+     */
+    explicit MappedGridFile(const std::string & filename);
+
+    MappedGridFile(const MappedGridFile &) = delete;
+
+    MappedGridFile(MappedGridFile &&) noexcept;
+
+    ~MappedGridFile();
+
+    MappedGridFile & operator = (const MappedGridFile &) = delete;
+
+    MappedGridFile & operator = (MappedGridFile &&) noexcept;
+
+    const GridFileHeader & header() const noexcept { return m_header; }
+
+    /** @returns first byte of the first element, nullptr if nothing is
+     *           mapped
+     */
+    const void * data() const noexcept;
+
+    bool is_open() const noexcept { return m_mapping; }
+
+    void swap(MappedGridFile &) noexcept;
+
+private:
+    void release() noexcept;
+
+    void * m_mapping = nullptr;
+    std::size_t m_length = 0;
+    GridFileHeader m_header;
+};
+
+/** A read only grid, whose elements are those of a memory mapped grid file.
+ *  Element access, and rows, are the same as a constant Grid; so it may be
+ *  used with the row based grid algorithms.
+ *
+ *  @tparam T must be trivially copyable
+ */
+template <typename T>
+class MappedGrid final {
+public:
+    static_assert(std::is_trivially_copyable_v<T>,
+                  "Only trivially copyable elements may be mapped.");
+    static_assert(alignof(T) <= GridFileHeader::k_data_offset,
+                  "Element type has stricter alignment than the file format "
+                  "provides.");
+
+    using Element            = T;
+    using ConstReferenceType = const T &;
+    using ConstIterator      = const T *;
+    using IndexType          = int;
+    using Vector             = Vector2<IndexType>;
+    using Size               = Size2<IndexType>;
+    using ConstRow           = GridRow<const T>;
+
+    MappedGrid() {}
+
+    /** @throws std::runtime_error if the file cannot be mapped, or does not
+     *          hold elements the size of T
+     */
+    explicit MappedGrid(const std::string & filename);
+
+    int width() const noexcept { return m_file.header().width; }
+
+    int height() const noexcept { return m_file.header().height; }
+
+    Size size2() const noexcept { return Size{width(), height()}; }
+
+    std::size_t size() const noexcept
+        { return std::size_t(width())*std::size_t(height()); }
+
+    bool is_empty() const noexcept { return size() == 0; }
+
+    bool has_position(int x, int y) const noexcept
+        { return x >= 0 && y >= 0 && x < width() && y < height(); }
+
+    bool has_position(const Vector & r) const noexcept
+        { return has_position(r.x, r.y); }
+
+    /** @throws std::out_of_range if position is outside of the grid */
+    ConstReferenceType operator () (int x, int y) const;
+
+    ConstReferenceType operator () (const Vector & r) const
+        { return (*this)(r.x, r.y); }
+
+    /** @returns element at the given position, which must be inside the
+     *           grid (this is only asserted)
+     */
+    ConstReferenceType element_unchecked(int x, int y) const noexcept {
+        assert(has_position(x, y));
+        return elements()[std::size_t(x) + std::size_t(y)*std::size_t(width())];
+    }
+
+    /** @throws std::out_of_range if y is not a row in the grid */
+    ConstRow row(int y) const;
+
+    ConstIterator begin() const noexcept { return elements(); }
+
+    ConstIterator end() const noexcept { return elements() + size(); }
+
+    /** @returns a copy of every element, in a Grid */
+    Grid<T> to_grid() const;
+
+private:
+    const T * elements() const noexcept
+        { return reinterpret_cast<const T *>(m_file.data()); }
+
+    std::out_of_range make_out_of_range_error(const char * caller) const;
+
+    MappedGridFile m_file;
+};
+
+// ----------------------------------------------------------------------------
+
+#ifndef DOXYGEN_SHOULD_SKIP_THIS
+
+namespace detail {
+
+[[noreturn]] void throw_grid_file_error
+    (const char * caller, const std::string & what);
+
+/** @returns true if the rest of the stream holds all of the header's data,
+ *           false if the stream cannot seek to tell
+ *  @throws std::runtime_error if the stream is too short
+ */
+bool verify_grid_file_length
+    (const char * caller, std::istream &, const GridFileHeader &);
+
+template <typename T>
+void verify_grid_file_element(const char * caller, const GridFileHeader & header) {
+    static_assert(std::is_trivially_copyable_v<T>,
+                  "Only trivially copyable elements may be saved or loaded.");
+    if (header.element_size == sizeof(T)) return;
+    throw_grid_file_error(caller, "file holds elements of "
+                          + std::to_string(header.element_size) + " bytes, "
+                          "not " + std::to_string(sizeof(T)) + ".");
+}
+
+} // end of detail namespace -> into ::cul
+
+template <typename T>
+void save_grid(std::ostream & out, const Grid<T> & grid) {
+    static_assert(std::is_trivially_copyable_v<T>,
+                  "Only trivially copyable elements may be saved.");
+    GridFileHeader header;
+    header.element_size = sizeof(T);
+    header.width  = grid.width ();
+    header.height = grid.height();
+    write_grid_file_header(out, header);
+    for (int y = 0; y != grid.height(); ++y) {
+        auto row = grid.row(y);
+        out.write(reinterpret_cast<const char *>(row.data()),
+                  std::streamsize(row.size()*sizeof(T)));
+    }
+    if (!out)
+        { detail::throw_grid_file_error("save_grid", "failed to write rows."); }
+}
+
+template <typename T>
+void save_grid(const std::string & filename, const Grid<T> & grid) {
+    std::ofstream out{filename, std::ios::binary | std::ios::trunc};
+    if (!out)
+        { detail::throw_grid_file_error("save_grid", "cannot open " + filename); }
+    save_grid(out, grid);
+}
+
+template <typename T>
+Grid<T> load_grid(std::istream & in) {
+    static constexpr const char * k_caller = "load_grid";
+    auto header = read_grid_file_header(in);
+    detail::verify_grid_file_element<T>(k_caller, header);
+    Grid<T> rv;
+    // header values are untrusted, so the whole grid is only allocated up
+    // front if the stream is known to hold it; otherwise it grows as rows
+    // arrive
+    if (detail::verify_grid_file_length(k_caller, in, header))
+        { rv.set_size(header.width, header.height); }
+    if (header.width == 0) return rv;
+    for (int y = 0; y != header.height; ++y) {
+        if (y == rv.height()) rv.set_size(header.width, y + 1);
+        auto row = rv.row(y);
+        in.read(reinterpret_cast<char *>(row.data()),
+                std::streamsize(row.size()*sizeof(T)));
+        if (!in)
+            { detail::throw_grid_file_error(k_caller, "file ends before its last row."); }
+    }
+    return rv;
+}
+
+template <typename T>
+Grid<T> load_grid(const std::string & filename) {
+    std::ifstream in{filename, std::ios::binary};
+    if (!in)
+        { detail::throw_grid_file_error("load_grid", "cannot open " + filename); }
+    return load_grid<T>(in);
+}
+
+// ----------------------------------------------------------------------------
+
+template <typename T>
+MappedGrid<T>::MappedGrid(const std::string & filename):
+    m_file(filename)
+{ detail::verify_grid_file_element<T>("MappedGrid", m_file.header()); }
+
+template <typename T>
+typename MappedGrid<T>::ConstReferenceType
+    MappedGrid<T>::operator () (int x, int y) const
+{
+    if (!has_position(x, y)) throw make_out_of_range_error("operator()");
+    return element_unchecked(x, y);
+}
+
+template <typename T>
+typename MappedGrid<T>::ConstRow MappedGrid<T>::row(int y) const {
+    if (!has_position(0, y)) throw make_out_of_range_error("row");
+    return ConstRow{&element_unchecked(0, y), std::size_t(width())};
+}
+
+template <typename T>
+Grid<T> MappedGrid<T>::to_grid() const {
+    Grid<T> rv;
+    rv.set_size(width(), height());
+    std::copy(begin(), end(), rv.begin());
+    return rv;
+}
+
+template <typename T>
+/* private */ std::out_of_range MappedGrid<T>::make_out_of_range_error
+    (const char * caller) const
+{
+    return std::out_of_range("MappedGrid::" + std::string(caller) + ": "
+                             "requested position is out of range, size: width "
+                             + std::to_string(width()) + " height "
+                             + std::to_string(height()));
+}
+
+#endif // ifndef DOXYGEN_SHOULD_SKIP_THIS
+
+} // end of cul namespace
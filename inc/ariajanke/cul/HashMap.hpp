@@ -51,17 +51,159 @@ Disadvantages:
  */
 // --------------------------- ORIGINAL LICENSE END ---------------------------
 
+// Note: the last two disadvantages no longer hold for this version. The
+// maximum (and minimum) load factors are policy parameters (see
+// HashMapDefaultPolicy), and memory may be reclaimed with shrink_to_fit (or
+// automatically, with a nonzero MinLoadFactor).
+
 #pragma once
 
 #include <ariajanke/cul/Util.hpp>
+#include <ariajanke/cul/detail/hash-map-helpers.hpp>
 
+#include <iterator>
+#include <memory_resource>
+#include <ratio>
 #include <stdexcept>
+#include <string_view>
+#include <type_traits>
+#include <utility>
 #include <vector>
 
 #include <cassert>
 
 namespace cul {
 
+/** Default behaviors for a HashMap. A policy is provided as the last
+ *  template argument for HashMap. To change a behavior, derive from this
+ *  class and hide the relevant constants.
+ */
+struct HashMapDefaultPolicy {
+    /** If true, a separate array of one byte "control" tags is kept
+     *  alongside the buckets. Each tag is either empty, or seven bits from
+     *  the hash of the key in that bucket. Lookups then scan many tags at a
+     *  time (with SSE2/AVX2 where available), and only compare keys whose
+     *  tags match.
+     */
+    static constexpr const bool k_use_control_bytes = false;
+
+    /** Largest fraction of buckets which may be occupied, before the map
+     *  grows. Must be greater than zero, and less than one.
+     */
+    using MaxLoadFactor = std::ratio<1, 2>;
+
+    /** If the fraction of occupied buckets falls below this (following
+     *  erasures), then the next insertion first shrinks the map. Zero
+     *  means the map never shrinks on its own.
+     *
+     *  Must be no more than a quarter of the maximum load factor, so that a
+     *  map does not shrink and grow repeatedly.
+     */
+    using MinLoadFactor = std::ratio<0>;
+
+    /** If true, insertions use Robin Hood displacement: an element being
+     *  placed takes the bucket of any element closer to its own ideal
+     *  bucket. Each bucket's distance from its element's ideal bucket is
+     *  stored (four bytes per bucket), and lookups for missing keys stop as
+     *  soon as they pass an element closer to its ideal bucket than they
+     *  are.
+     */
+    static constexpr const bool k_use_robin_hood = false;
+
+    /** If true, the full hash of each key is stored alongside it. Growing
+     *  or shrinking the map then never calls the hasher, and lookups compare
+     *  hashes before comparing keys. Worthwhile for keys which are expensive
+     *  to hash or compare (like strings).
+     */
+    static constexpr const bool k_store_hashes = false;
+
+    /** If non-zero, growing the map does not move every element at once.
+     *  The old buckets are kept alongside the new ones, and each following
+     *  insertion migrates about this many of them (always finishing a run
+     *  of occupied buckets). Lookups, erasures and iteration cover both sets
+     *  of buckets until migration completes.
+     */
+    static constexpr const std::size_t k_incremental_rehash_step = 0;
+
+    /** If true, bucket blocks of two megabytes or more are aligned to two
+     *  megabyte boundaries, so that they may be backed by transparent huge
+     *  pages (which Linux is also asked to use for them). Very large maps
+     *  then take far fewer TLB misses, at the cost of up to two megabytes
+     *  of unused address space per block.
+     */
+    static constexpr const bool k_align_for_huge_pages = false;
+};
+
+/** Policy for a HashMap which probes using control bytes. */
+struct HashMapControlBytesPolicy : public HashMapDefaultPolicy {
+    static constexpr const bool k_use_control_bytes = true;
+};
+
+/** Policy for a HashMap which uses Robin Hood displacement, and fills up to
+ *  seven eighths of its buckets.
+ */
+struct HashMapRobinHoodPolicy : public HashMapDefaultPolicy {
+    using MaxLoadFactor = std::ratio<7, 8>;
+    static constexpr const bool k_use_robin_hood = true;
+};
+
+/** Policy for a HashMap which stores the hash of each key. */
+struct HashMapStoredHashesPolicy : public HashMapDefaultPolicy {
+    static constexpr const bool k_store_hashes = true;
+};
+
+/** Policy for a HashMap which spreads the work of growing across many
+ *  insertions.
+ */
+struct HashMapIncrementalRehashPolicy : public HashMapDefaultPolicy {
+    static constexpr const std::size_t k_incremental_rehash_step = 16;
+};
+
+/** Hashes any string-like type as its std::string_view would be. A map with
+ *  std::string keys using this hasher, may be searched with
+ *  std::string_view or const char * keys, without creating a std::string.
+ */
+struct TransparentStringHash final {
+    using is_transparent = void;
+
+    std::size_t operator () (std::string_view str) const noexcept
+        { return std::hash<std::string_view>{}(str); }
+};
+
+/** A key, and space for an element. Space for empty (trivial) element types
+ *  takes no room at all.
+ */
+template <typename KeyT, typename SpaceT, bool kt_is_empty = std::is_empty_v<SpaceT>>
+class HashMapBucket final {
+public:
+    template <typename OtherKeyT>
+    HashMapBucket(std::in_place_t, OtherKeyT && key_):
+        key(std::forward<OtherKeyT>(key_)) {}
+
+    SpaceT * space() noexcept { return &m_space; }
+
+    const SpaceT * space() const noexcept { return &m_space; }
+
+    KeyT key;
+
+private:
+    SpaceT m_space;
+};
+
+template <typename KeyT, typename SpaceT>
+class HashMapBucket<KeyT, SpaceT, true> final : private SpaceT {
+public:
+    template <typename OtherKeyT>
+    HashMapBucket(std::in_place_t, OtherKeyT && key_):
+        key(std::forward<OtherKeyT>(key_)) {}
+
+    SpaceT * space() noexcept { return this; }
+
+    const SpaceT * space() const noexcept { return this; }
+
+    KeyT key;
+};
+
 template <
     typename KeyT,
     typename ElementT,
@@ -70,17 +212,228 @@ template <
 >
 class HashMapBucketDefinitions {
 public:
-    using ElementSpace = std::aligned_storage_t<sizeof(ElementT)>;
+    template <typename T>
+    using Rebind = typename std::allocator_traits<AllocatorT>::
+        template rebind_alloc<T>;
+
+    // an empty element type is its own space, so it may share an address
+    // with the key
+    using ElementSpace = std::conditional_t<
+        std::is_empty_v<ElementT> && std::is_trivial_v<ElementT> &&
+        !std::is_final_v<ElementT>,
+        ElementT,
+        std::aligned_storage_t<sizeof(ElementT)>>;
     using KeyValuePairType = std::pair<KeyT, ElementT>;
-    using Bucket = std::pair<KeyT, ElementSpace>;
-    using BucketContainer = std::vector<Bucket, AllocatorT>;
+    using Bucket = HashMapBucket<KeyT, ElementSpace>;
+    using BlockChunk = detail::HashMapBlockChunk;
+    using BlockAllocator = Rebind<BlockChunk>;
+    using ProbeDistance = std::uint32_t;
+
+    static_assert(alignof(Bucket) <= alignof(BlockChunk),
+                  "Buckets may not be more aligned than a block chunk.");
 };
 
+/** Owns all buckets (and their meta data) for a HashMap. Keeps track of
+ *  which buckets are occupied, and handles the lifetimes of elements.
+ *
+ *  Buckets, control bytes, probe distances and hashes all live in one raw
+ *  block from the allocator (which may be an arena, through
+ *  std::pmr::polymorphic_allocator). Only what marks buckets as empty is
+ *  initialized: with control bytes that's just the control bytes, and the
+ *  key of a bucket only exists while it's occupied. Otherwise every bucket
+ *  holds a copy of the empty key.
+ *
+ *  Nothing here knows how to hash, the map decides where things go.
+ */
 template <
     typename KeyT,
     typename ElementT,
     typename AllocatorT,
     typename KeyEqualityT,
+    typename PolicyT
+>
+class HashMapBucketStorage final {
+    using Defs = HashMapBucketDefinitions<KeyT, ElementT, AllocatorT, KeyEqualityT>;
+public:
+    using KeyType = KeyT;
+    using ElementType = ElementT;
+    using KeyEquality = KeyEqualityT;
+    using ElementSpace = typename Defs::ElementSpace;
+    using ControlGroup = detail::HashMapControlGroup;
+    using ProbeDistance = typename Defs::ProbeDistance;
+
+    static constexpr const bool k_use_control_bytes =
+        PolicyT::k_use_control_bytes;
+
+    static constexpr const bool k_use_robin_hood = PolicyT::k_use_robin_hood;
+
+    static constexpr const bool k_store_hashes = PolicyT::k_store_hashes;
+
+    static constexpr const bool k_align_for_huge_pages =
+        PolicyT::k_align_for_huge_pages;
+
+    HashMapBucketStorage(const KeyType & empty_key, const AllocatorT &);
+
+    HashMapBucketStorage(const HashMapBucketStorage &);
+
+    HashMapBucketStorage(HashMapBucketStorage &&);
+
+    ~HashMapBucketStorage();
+
+    HashMapBucketStorage & operator = (const HashMapBucketStorage &) = delete;
+
+    HashMapBucketStorage & operator = (HashMapBucketStorage &&) = delete;
+
+    const AllocatorT & allocator() const noexcept { return m_allocator; }
+
+    std::size_t bucket_count() const noexcept
+        { return m_bucket_count; }
+
+    /** @returns control bytes, readable for bucket_count() +
+     *           ControlGroup::k_width - 1 bytes (the last few mirror the
+     *           first few)
+     */
+    const std::uint8_t * controls() const noexcept
+        { return m_controls; }
+
+    ElementType & element(std::size_t index)
+        { return *reinterpret_cast<ElementType *>(m_buckets[index].space()); }
+
+    const ElementType & element(std::size_t index) const {
+        return *reinterpret_cast<const ElementType *>
+            (m_buckets[index].space());
+    }
+
+    ElementSpace * element_space(std::size_t index)
+        { return m_buckets[index].space(); }
+
+    const ElementSpace * element_space(std::size_t index) const
+        { return m_buckets[index].space(); }
+
+    const KeyType & empty_key() const noexcept { return m_empty_key; }
+
+    /** Stored hashes only: hash of the key in an occupied bucket */
+    std::size_t hash(std::size_t index) const
+        { return m_hashes[index]; }
+
+    bool is_empty(std::size_t index) const;
+
+    const KeyType & key(std::size_t index) const
+        { return m_buckets[index].key; }
+
+    /** Moves the contents of an occupied bucket into an empty one, leaving
+     *  the first empty.
+     */
+    void move_bucket(std::size_t from, std::size_t to) noexcept;
+
+    /** @returns index of the first occupied bucket at or after the given
+     *           index, or bucket_count() if there are none
+     */
+    std::size_t next_occupied(std::size_t index) const;
+
+    /** Hints that the given bucket (and its meta data) will soon be read.
+     */
+    void prefetch(std::size_t index) const noexcept;
+
+    /** Occupies an empty bucket. */
+    template <typename OtherKeyType, typename ... ArgTypes>
+    void place(std::size_t index, std::size_t hash,
+               OtherKeyType && key, ArgTypes &&... element_args);
+
+    /** Robin Hood only: distance of an occupied bucket from its element's
+     *  ideal bucket
+     */
+    ProbeDistance probe_distance(std::size_t index) const
+        { return m_distances[index]; }
+
+    /** Discards all buckets and replaces them with the given number of
+     *  empty ones. All buckets must be empty.
+     */
+    void reset(std::size_t bucket_count);
+
+    /** Discards all buckets, freeing their memory. All buckets must be
+     *  empty.
+     */
+    void release() noexcept;
+
+    /** Robin Hood only */
+    void set_probe_distance(std::size_t index, ProbeDistance distance)
+        { m_distances[index] = distance; }
+
+    /** Allocators are only exchanged if they propagate on swap, otherwise
+     *  they must be equal.
+     */
+    void swap(HashMapBucketStorage &) noexcept;
+
+    /** Moves the contents of an occupied bucket, from this or another
+     *  storage, into an empty bucket of this one. The source bucket is left
+     *  empty. Probe distances are left for the caller.
+     */
+    void take(std::size_t index, HashMapBucketStorage & source,
+              std::size_t source_index) noexcept;
+
+    /** Destroys the element and empties the bucket.
+     *  @returns the (moved) key, which was in the bucket
+     */
+    KeyType vacate(std::size_t index) noexcept;
+
+    /** empties all buckets */
+    void vacate_all() noexcept;
+
+private:
+    using Bucket = typename Defs::Bucket;
+    using BlockChunk = typename Defs::BlockChunk;
+    using BlockAllocator = typename Defs::BlockAllocator;
+    using BlockAllocatorTraits = std::allocator_traits<BlockAllocator>;
+
+    /** byte offsets of each array, from the start of a block */
+    struct BlockLayout final {
+        std::size_t controls = 0;
+        std::size_t distances = 0;
+        std::size_t hashes = 0;
+        std::size_t size = 0;
+    };
+
+    static BlockLayout block_layout_for(std::size_t bucket_count);
+
+    static std::size_t round_up(std::size_t n, std::size_t multiple) noexcept
+        { return ((n + multiple - 1) / multiple)*multiple; }
+
+    /** Allocates a block for the given number of buckets, all empty. There
+     *  must be no block already.
+     */
+    void allocate_block(std::size_t bucket_count);
+
+    /** Destroys all elements and keys (empty keys included). */
+    void destroy_buckets() noexcept;
+
+    /** Frees the block, its buckets must already be destroyed. */
+    void free_block() noexcept;
+
+    template <typename OtherKeyType>
+    void set_key(std::size_t index, OtherKeyType && key);
+
+    void clear_key(std::size_t index) noexcept;
+
+    void set_control(std::size_t index, std::uint8_t) noexcept;
+
+    AllocatorT m_allocator;
+    KeyType m_empty_key;
+    BlockChunk * m_chunks = nullptr;
+    std::size_t m_chunk_count = 0;
+    std::size_t m_bucket_count = 0;
+    Bucket * m_buckets = nullptr;
+    std::uint8_t * m_controls = nullptr;
+    ProbeDistance * m_distances = nullptr;
+    std::size_t * m_hashes = nullptr;
+};
+
+template <
+    typename KeyT,
+    typename ElementT,
+    typename AllocatorT,
+    typename KeyEqualityT,
+    typename PolicyT,
     bool kt_is_constant
 >
 class HashMapIteratorImpl;
@@ -90,19 +443,22 @@ template <
     typename ElementT,
     typename HashT = std::hash<KeyT>,
     typename KeyEqualT = std::equal_to<void>,
-    typename AllocatorT = std::allocator<std::pair<KeyT, std::aligned_storage_t<sizeof(ElementT)>>>
+    typename AllocatorT = std::allocator<std::pair<KeyT, std::aligned_storage_t<sizeof(ElementT)>>>,
+    typename PolicyT = HashMapDefaultPolicy
 >
 class HashMap final {
-    using Defs = HashMapBucketDefinitions<KeyT, ElementT, AllocatorT, KeyEqualT>;
+    using Storage = HashMapBucketStorage
+        <KeyT, ElementT, AllocatorT, KeyEqualT, PolicyT>;
     template <bool kt_is_constant>
     using IteratorImpl = HashMapIteratorImpl
-        <KeyT, ElementT, AllocatorT, KeyEqualT, kt_is_constant>;
+        <KeyT, ElementT, AllocatorT, KeyEqualT, PolicyT, kt_is_constant>;
 public:
     using KeyType = KeyT;
     using ElementType = ElementT;
     using Hasher = HashT;
     using KeyEquality = KeyEqualT;
     using Allocator = AllocatorT;
+    using Policy = PolicyT;
     using Iterator      = IteratorImpl<false>;
     using ConstIterator = IteratorImpl<true>;
 
@@ -123,6 +479,40 @@ public:
         Iterator position;
     };
 
+    /** Hashes a key as the map does. A key of another type is passed
+     *  straight to the hasher if it accepts it (as transparent hashers do),
+     *  and otherwise converted to a KeyType once first.
+     */
+    template <typename OtherKeyType>
+    static std::size_t detail_hash(const OtherKeyType & key) {
+        if constexpr (std::is_invocable_v<const Hasher &, const OtherKeyType &>)
+            { return Hasher{}(key); }
+        else
+            { return Hasher{}(KeyType{key}); }
+    }
+
+    /** For containers built on this one, which hash keys themselves.
+     *  @param hash must be what detail_hash gives for the key
+     */
+    template <typename OtherKeyType, typename ... ArgTypes>
+    Insertion detail_emplace_hashed
+        (std::size_t hash, OtherKeyType && key, ArgTypes &&... element_args)
+    {
+        return emplace_hashed(hash, std::forward<OtherKeyType>(key),
+                              std::forward<ArgTypes>(element_args)...);
+    }
+
+    /** @copydoc detail_emplace_hashed */
+    template <typename OtherKeyType>
+    Iterator detail_find_hashed(const OtherKeyType & key, std::size_t hash)
+        { return make_iterator(find_hashed(key, hash)); }
+
+    /** @copydoc detail_emplace_hashed */
+    template <typename OtherKeyType>
+    ConstIterator detail_find_hashed
+        (const OtherKeyType & key, std::size_t hash) const
+    { return make_iterator(find_hashed(key, hash)); }
+
     explicit HashMap(KeyType empty_key,
                      const Allocator & = Allocator{});
 
@@ -130,28 +520,38 @@ public:
 
     HashMap(HashMap &&);
 
-    ~HashMap();
+    ~HashMap() {}
 
     HashMap & operator = (const HashMap &);
 
     HashMap & operator = (HashMap &&);
 
+    /** @returns the allocator buckets are taken from */
+    const Allocator & allocator() const noexcept
+        { return m_storage.allocator(); }
+
     ConstIterator begin() const noexcept { return cbegin(); }
 
     Iterator begin() noexcept
         { return advance_past_empty(make_iterator(0)); }
 
+    /** @returns number of buckets new elements are placed into (excluding
+     *           any not yet migrated by an incremental rehash)
+     */
     std::size_t bucket_count() const noexcept
-        { return m_bucket_container.size(); }
+        { return m_storage.bucket_count(); }
 
+    /** @returns the number of elements this map may hold before it needs
+     *           to grow
+     */
     std::size_t capacity() const noexcept
-        { return m_bucket_container.size() / k_load_factor; }
+        { return bucket_count()*MaxLoadFactor::num / MaxLoadFactor::den; }
 
     ConstIterator cbegin() const noexcept
         { return advance_past_empty(make_iterator(0)); }
 
     ConstIterator cend() const noexcept
-        { return make_iterator(m_bucket_container.size()); }
+        { return make_iterator(bucket_index_end()); }
 
     void clear() noexcept;
 
@@ -162,7 +562,7 @@ public:
     ConstIterator end() const noexcept { return cend(); }
 
     Iterator end() noexcept
-        { return make_iterator(m_bucket_container.size()); }
+        { return make_iterator(bucket_index_end()); }
 
     Iterator erase(const Iterator &);
 
@@ -174,27 +574,110 @@ public:
     template <typename OtherKeyType>
     ConstIterator find(const OtherKeyType &) const;
 
+    /** Finds many keys at once. All keys in a stretch are hashed, and their
+     *  buckets prefetched, before any are looked up; so that cache misses
+     *  overlap rather than follow one another.
+     *
+     *  @param keys_beg must be a forward iterator (or better), as each
+     *                  stretch of keys is passed over twice
+     *  @param out receives an iterator for each key, end() for keys not
+     *             present
+     *  @returns out, advanced past the last iterator written
+     */
+    template <typename KeyIterator, typename OutIterator>
+    OutIterator find_batch(KeyIterator keys_beg, KeyIterator keys_end,
+                           OutIterator out);
+
+    template <typename KeyIterator, typename OutIterator>
+    OutIterator find_batch(KeyIterator keys_beg, KeyIterator keys_end,
+                           OutIterator out) const;
+
     template <typename OtherKeyType>
     Insertion insert(const OtherKeyType & key, const ElementType & el)
         { return emplace_impl(key, el); }
 
+    /** Inserts many key/element pairs at once, hashing and prefetching ahead
+     *  the same way find_batch does. Pairs whose keys are already present
+     *  are skipped. Calling reserve first avoids growing part way through.
+     *
+     *  @param beg first of a sequence of pairs, whose first members are
+     *             keys, and second members are elements; must be a forward
+     *             iterator (or better), as find_batch's keys must be
+     *  @returns number of elements inserted
+     */
+    template <typename PairIterator>
+    std::size_t insert_batch(PairIterator beg, PairIterator end);
+
     bool is_empty() const noexcept { return m_size == 0; }
 
+    /** @returns true if an incremental rehash has elements left to migrate
+     */
+    bool is_rehashing() const noexcept
+        { return m_old_storage.bucket_count() != 0; }
+
+    /** Migrates all elements remaining from an incremental rehash, if any.
+     */
+    void finish_rehash() noexcept
+        { continue_rehash(m_rehash_remaining); }
+
+    /** A probe length is how many buckets past its ideal bucket an element
+     *  sits, zero if the element is in its ideal bucket.
+     *
+     *  @returns the longest probe length of any element, zero if empty
+     */
+    std::size_t max_probe_length() const;
+
+    /** @returns mean probe length of all elements, zero if empty */
+    double average_probe_length() const;
+
+    /** @returns number of elements with each probe length (indexed by
+     *           probe length), empty if the map is empty
+     */
+    std::vector<std::size_t> probe_length_histogram() const;
+
+    /** Rebuilds the map, with room for at least the given number of
+     *  elements. Never reduces the number of buckets.
+     */
     void rehash(std::size_t for_at_least_this_many_elements = 0);
 
     void reserve(std::size_t for_at_least_this_many_elements);
 
+    /** Rebuilds the map with the fewest buckets that can hold its current
+     *  elements, releasing all memory if the map is empty.
+     */
+    void shrink_to_fit();
+
     std::size_t size() const noexcept { return m_size; }
 
     void swap(HashMap &);
 
 private:
-    using ElementSpace = typename Defs::ElementSpace;
-    using Bucket = typename Defs::Bucket;
-    using BucketContainer = typename Defs::BucketContainer;
-    using BucketIterator = typename BucketContainer::iterator;
+    struct ProbeResult final {
+        std::size_t index;
+        bool found;
+    };
+
+    using MaxLoadFactor = typename PolicyT::MaxLoadFactor;
+    using MinLoadFactor = typename PolicyT::MinLoadFactor;
+
+    static_assert(   MaxLoadFactor::num > 0
+                  && MaxLoadFactor::num < MaxLoadFactor::den,
+                  "Maximum load factor must be in (0, 1)");
 
-    static constexpr const std::size_t k_load_factor = 2;
+    static_assert(std::ratio_less_equal_v
+                  <MinLoadFactor, std::ratio_divide<MaxLoadFactor, std::ratio<4>>>,
+                  "Minimum load factor must be no more than a quarter of "
+                  "the maximum load factor");
+
+    static constexpr const bool k_use_control_bytes =
+        PolicyT::k_use_control_bytes;
+
+    static constexpr const bool k_use_robin_hood = PolicyT::k_use_robin_hood;
+
+    static constexpr const bool k_store_hashes = PolicyT::k_store_hashes;
+
+    static constexpr const std::size_t k_incremental_rehash_step =
+        PolicyT::k_incremental_rehash_step;
 
     static Iterator advance_past_empty(Iterator && itr)
         { return Iterator::detail_advance_past_empty(std::move(itr)); }
@@ -202,33 +685,140 @@ private:
     static ConstIterator advance_past_empty(ConstIterator && itr)
         { return ConstIterator::detail_advance_past_empty(std::move(itr)); }
 
-    static void swap_buckets(BucketIterator & lhs, BucketIterator & rhs) noexcept;
+    /** @returns the fewest buckets needed to hold the given number of
+     *           elements
+     */
+    static std::size_t bucket_count_for(std::size_t element_count);
 
     Iterator make_iterator(std::size_t);
 
     ConstIterator make_iterator(std::size_t) const;
 
+    /** number of keys hashed and prefetched together by batch operations */
+    static constexpr const std::size_t k_batch_stretch = 16;
+
     template <typename OtherKeyType, typename ... ArgTypes>
-    Insertion emplace_impl(OtherKeyType &&, ArgTypes &&...);
+    Insertion emplace_impl(OtherKeyType && key, ArgTypes &&... element_args) {
+        const auto hash = detail_hash(key);
+        return emplace_hashed(hash, std::forward<OtherKeyType>(key),
+                              std::forward<ArgTypes>(element_args)...);
+    }
 
-    std::size_t probe_next(std::size_t) const noexcept;
+    template <typename OtherKeyType, typename ... ArgTypes>
+    Insertion emplace_hashed(std::size_t hash, OtherKeyType &&, ArgTypes &&...);
 
-    template <typename OtherKeyType>
-    std::size_t key_to_index(const OtherKeyType & key) const noexcept
-        { return Hasher{}(key) & size_mask(); }
+    /** Places a new element without growing or shrinking. */
+    template <typename OtherKeyType, typename ... ArgTypes>
+    Insertion emplace_in_place(std::size_t hash, OtherKeyType &&, ArgTypes &&...);
+
+    std::size_t probe_next(std::size_t index) const noexcept
+        { return probe_next(m_storage, index); }
+
+    static std::size_t probe_next(const Storage &, std::size_t) noexcept;
+
+    static std::size_t probe_distance(const Storage &, std::size_t index);
+
+    /** @returns hash of the key in an occupied bucket, without calling the
+     *           hasher if hashes are stored
+     */
+    static std::size_t bucket_hash(const Storage &, std::size_t index);
+
+    /** Moves an element from another map's storage, whose key is known not
+     *  to be in this map, into a bucket of this map.
+     */
+    void take_from(Storage & source, std::size_t source_index,
+                   std::size_t hash) noexcept;
+
+    /** @returns the bucket where an element with this hash, whose key is
+     *           known not to be in the map, should be placed
+     */
+    std::size_t vacancy_for(std::size_t hash) const noexcept;
+
+    /** Fills an empty bucket by moving back any following elements, which
+     *  may sit closer to their ideal buckets.
+     */
+    static void close_gap(Storage &, std::size_t empty_index) noexcept;
+
+    /** Robin Hood only: makes the given bucket empty, moving it and any
+     *  following elements forward one bucket.
+     */
+    void make_room(std::size_t index) noexcept;
+
+    /** Robin Hood only: @returns where an element with this hash would be
+     *  placed
+     */
+    static std::size_t robin_hood_position
+        (const Storage &, std::size_t hash) noexcept;
+
+    /** Makes room for at least one more element, either all at once or by
+     *  starting an incremental rehash.
+     */
+    void grow();
+
+    /** Migrates old buckets, about the given number of them, from an
+     *  incremental rehash.
+     */
+    void continue_rehash(std::size_t bucket_budget) noexcept;
+
+    /** Moves all elements into a new set of buckets. */
+    void rebuild(std::size_t bucket_count);
+
+    bool should_shrink() const noexcept;
 
     std::size_t size_mask() const noexcept
-        { return m_bucket_container.size() - 1; }
+        { return size_mask(m_storage); }
+
+    static std::size_t size_mask(const Storage & storage) noexcept
+        { return storage.bucket_count() - 1; }
+
+    /** Iterators index new buckets, followed by any old ones from an
+     *  incremental rehash.
+     */
+    std::size_t bucket_index_end() const noexcept
+        { return bucket_count() + m_old_storage.bucket_count(); }
 
-    Extraction extract_bucket_and_advance
-        (BucketIterator && bucket, const Iterator & iterator) noexcept;
+    template <typename Func>
+    void for_each_probe_length(Func &&) const;
 
     template <typename OtherKeyType>
-    std::size_t find_impl(const OtherKeyType &) const noexcept;
+    std::size_t find_impl(const OtherKeyType & key) const noexcept
+        { return find_hashed(key, detail_hash(key)); }
 
-    KeyType m_empty_key;
-    BucketContainer m_bucket_container;
+    template <typename OtherKeyType>
+    std::size_t find_hashed(const OtherKeyType &, std::size_t hash) const noexcept;
+
+    /** Hashes up to k_batch_stretch keys, and prefetches their buckets.
+     *  @returns iterator following the last key hashed
+     */
+    template <typename KeyIterator, typename KeyFunc>
+    KeyIterator hash_stretch
+        (KeyIterator beg, KeyIterator end, KeyFunc && key_of,
+         std::size_t * hashes, std::size_t & count) const;
+
+    template <typename KeyIterator, typename OutIterator, typename MakeIteratorFunc>
+    OutIterator find_batch_impl(KeyIterator keys_beg, KeyIterator keys_end,
+                                OutIterator out, MakeIteratorFunc &&) const;
+
+    /** Finds either the bucket containing the key, or the bucket where it
+     *  should be placed. There must be at least one bucket.
+     */
+    template <typename OtherKeyType>
+    static ProbeResult probe_for
+        (const Storage &, const OtherKeyType &, std::size_t hash) noexcept;
+
+    /** @returns true if an occupied bucket holds the given key */
+    template <typename OtherKeyType>
+    static bool bucket_holds(const Storage &, std::size_t index,
+                             const OtherKeyType &, std::size_t hash) noexcept;
+
+    Storage m_storage;
+    // buckets not yet migrated by an incremental rehash
+    Storage m_old_storage;
+    std::size_t m_rehash_cursor = 0;
+    std::size_t m_rehash_remaining = 0;
     std::size_t m_size = 0;
+    // only erasures (since the last rebuild) may cause shrinking
+    bool m_has_erased = false;
 };
 
 // ----------------------------------------------------------------------------
@@ -241,10 +831,12 @@ template <
     typename ElementT,
     typename AllocatorT,
     typename KeyEqualityT,
+    typename PolicyT,
     bool kt_is_constant
 >
 class HashMapIteratorImpl final {
-    using Defs = HashMapBucketDefinitions<KeyT, ElementT, AllocatorT, KeyEqualityT>;
+    using Storage = HashMapBucketStorage
+        <KeyT, ElementT, AllocatorT, KeyEqualityT, PolicyT>;
 public:
     using ElementType = ElementT;
     using KeyType = KeyT;
@@ -252,10 +844,9 @@ public:
     using KeyValuePairType = std::pair<KeyType, ElementType>;
     using Allocator = AllocatorT;
     using KeyEquality = KeyEqualityT;
-    using BucketContainer = typename Defs::BucketContainer;
     using ElementReference = typename PairWrapperImpl::ElementReference;
-    using BucketContainerPtr = std::conditional_t
-        <kt_is_constant, const BucketContainer *, BucketContainer *>;
+    using StoragePtr = std::conditional_t
+        <kt_is_constant, const Storage *, Storage *>;
     using Reference = typename PairWrapperImpl::PairType;
     using Pointer = PairWrapperImpl;
 
@@ -272,10 +863,8 @@ public:
     static HashMapIteratorImpl detail_advance_past_empty
         (HashMapIteratorImpl && itr);
 
-    HashMapIteratorImpl
-        (std::size_t index,
-         BucketContainerPtr container,
-         const KeyType & empty);
+    HashMapIteratorImpl(std::size_t index, StoragePtr storage,
+                        StoragePtr old_storage);
 
     HashMapIteratorImpl(const HashMapIteratorImpl &);
 
@@ -302,13 +891,12 @@ private:
 
     PairWrapperImpl element() const;
 
-    auto key() const { return (*m_container)[m_index].first; }
-
     void advance_past_empty_();
 
     std::size_t m_index = 0;
-    BucketContainerPtr m_container = nullptr;
-    const KeyType * m_empty_key = nullptr;
+    StoragePtr m_storage = nullptr;
+    // indices past the new buckets refer to these
+    StoragePtr m_old_storage = nullptr;
 };
 
 // ----------------------------------------------------------------------------
@@ -357,11 +945,12 @@ inline std::size_t nearest_base2_number(std::size_t n) {
         typename ElementT, \
         typename HashT, \
         typename KeyEqualT, \
-        typename AllocatorT \
+        typename AllocatorT, \
+        typename PolicyT \
     >
 
 #define MACRO_HASHMAP_CLASSNAME \
-    HashMap<KeyT, ElementT, HashT, KeyEqualT, AllocatorT>
+    HashMap<KeyT, ElementT, HashT, KeyEqualT, AllocatorT, PolicyT>
 
 #define MACRO_ITERATOR_TEMPLATES \
     template < \
@@ -369,11 +958,350 @@ inline std::size_t nearest_base2_number(std::size_t n) {
         typename ElementT, \
         typename AllocatorT, \
         typename KeyEqualT, \
+        typename PolicyT, \
         bool kt_is_constant \
     >
 
 #define MACRO_ITERATOR_CLASSNAME \
-    HashMapIteratorImpl<KeyT, ElementT, AllocatorT, KeyEqualT, kt_is_constant>
+    HashMapIteratorImpl<KeyT, ElementT, AllocatorT, KeyEqualT, PolicyT, kt_is_constant>
+
+#define MACRO_STORAGE_TEMPLATES \
+    template < \
+        typename KeyT, \
+        typename ElementT, \
+        typename AllocatorT, \
+        typename KeyEqualT, \
+        typename PolicyT \
+    >
+
+#define MACRO_STORAGE_CLASSNAME \
+    HashMapBucketStorage<KeyT, ElementT, AllocatorT, KeyEqualT, PolicyT>
+
+MACRO_STORAGE_TEMPLATES
+MACRO_STORAGE_CLASSNAME::HashMapBucketStorage
+    (const KeyType & empty_key_, const AllocatorT & allocator_):
+    m_allocator(allocator_),
+    m_empty_key(empty_key_) {}
+
+MACRO_STORAGE_TEMPLATES
+MACRO_STORAGE_CLASSNAME::HashMapBucketStorage
+    (const HashMapBucketStorage & rhs):
+    m_allocator(std::allocator_traits<AllocatorT>::
+        select_on_container_copy_construction(rhs.m_allocator)),
+    m_empty_key(rhs.m_empty_key)
+{
+    allocate_block(rhs.bucket_count());
+    try {
+        for (auto i = rhs.next_occupied(0); i != rhs.bucket_count();
+             i = rhs.next_occupied(i + 1))
+        {
+            set_key(i, rhs.key(i));
+            try {
+                new (element_space(i)) ElementType{rhs.element(i)};
+            } catch (...) {
+                clear_key(i);
+                throw;
+            }
+            if constexpr (k_use_control_bytes)
+                { set_control(i, rhs.m_controls[i]); }
+            if constexpr (k_use_robin_hood)
+                { m_distances[i] = rhs.m_distances[i]; }
+            if constexpr (k_store_hashes)
+                { m_hashes[i] = rhs.m_hashes[i]; }
+        }
+    } catch (...) {
+        destroy_buckets();
+        free_block();
+        throw;
+    }
+}
+
+MACRO_STORAGE_TEMPLATES
+MACRO_STORAGE_CLASSNAME::HashMapBucketStorage
+    (HashMapBucketStorage && rhs):
+    m_allocator(rhs.m_allocator),
+    m_empty_key(rhs.m_empty_key),
+    m_chunks(std::exchange(rhs.m_chunks, nullptr)),
+    m_chunk_count(std::exchange(rhs.m_chunk_count, 0)),
+    m_bucket_count(std::exchange(rhs.m_bucket_count, 0)),
+    m_buckets(std::exchange(rhs.m_buckets, nullptr)),
+    m_controls(std::exchange(rhs.m_controls, nullptr)),
+    m_distances(std::exchange(rhs.m_distances, nullptr)),
+    m_hashes(std::exchange(rhs.m_hashes, nullptr)) {}
+
+MACRO_STORAGE_TEMPLATES
+MACRO_STORAGE_CLASSNAME::~HashMapBucketStorage() {
+    destroy_buckets();
+    free_block();
+}
+
+MACRO_STORAGE_TEMPLATES
+bool MACRO_STORAGE_CLASSNAME::is_empty(std::size_t index) const {
+    if constexpr (k_use_control_bytes)
+        { return m_controls[index] == ControlGroup::k_empty; }
+    else
+        { return KeyEquality{}(m_buckets[index].key, m_empty_key); }
+}
+
+MACRO_STORAGE_TEMPLATES
+std::size_t MACRO_STORAGE_CLASSNAME::next_occupied(std::size_t index) const {
+    if constexpr (k_use_control_bytes) {
+        for (; index < bucket_count(); index += ControlGroup::k_width) {
+            auto full = ControlGroup{controls() + index}.match_full();
+            if (full.has_any())
+                { return std::min(index + full.lowest(), bucket_count()); }
+        }
+        return bucket_count();
+    } else {
+        while (index < bucket_count() && is_empty(index))
+            { ++index; }
+        return index;
+    }
+}
+
+MACRO_STORAGE_TEMPLATES
+void MACRO_STORAGE_CLASSNAME::move_bucket
+    (std::size_t from, std::size_t to) noexcept
+{
+    take(to, *this, from);
+    if constexpr (k_use_robin_hood)
+        { m_distances[to] = m_distances[from]; }
+}
+
+MACRO_STORAGE_TEMPLATES
+void MACRO_STORAGE_CLASSNAME::prefetch(std::size_t index) const noexcept {
+    detail::prefetch_for_read(m_buckets + index);
+    if constexpr (k_use_control_bytes)
+        { detail::prefetch_for_read(m_controls + index); }
+    if constexpr (k_store_hashes)
+        { detail::prefetch_for_read(m_hashes + index); }
+}
+
+MACRO_STORAGE_TEMPLATES
+template <typename OtherKeyType, typename ... ArgTypes>
+void MACRO_STORAGE_CLASSNAME::place
+    (std::size_t index, std::size_t hash,
+     OtherKeyType && key, ArgTypes &&... element_args)
+{
+    assert(is_empty(index));
+    set_key(index, std::forward<OtherKeyType>(key));
+    try {
+        new (element_space(index))
+            ElementType{std::forward<ArgTypes>(element_args)...};
+    } catch (...) {
+        clear_key(index);
+        throw;
+    }
+    if constexpr (k_use_control_bytes)
+        { set_control(index, ControlGroup::tag_for(hash)); }
+    if constexpr (k_store_hashes)
+        { m_hashes[index] = hash; }
+}
+
+MACRO_STORAGE_TEMPLATES
+void MACRO_STORAGE_CLASSNAME::reset(std::size_t bucket_count_) {
+    release();
+    allocate_block(bucket_count_);
+}
+
+MACRO_STORAGE_TEMPLATES
+void MACRO_STORAGE_CLASSNAME::release() noexcept {
+    destroy_buckets();
+    free_block();
+}
+
+MACRO_STORAGE_TEMPLATES
+void MACRO_STORAGE_CLASSNAME::swap(HashMapBucketStorage & rhs) noexcept {
+    using AllocatorTraits = std::allocator_traits<AllocatorT>;
+    if constexpr (AllocatorTraits::propagate_on_container_swap::value) {
+        std::swap(m_allocator, rhs.m_allocator);
+    } else if constexpr (!AllocatorTraits::is_always_equal::value) {
+        assert(m_allocator == rhs.m_allocator);
+    }
+    std::swap(m_empty_key, rhs.m_empty_key);
+    std::swap(m_chunks, rhs.m_chunks);
+    std::swap(m_chunk_count, rhs.m_chunk_count);
+    std::swap(m_bucket_count, rhs.m_bucket_count);
+    std::swap(m_buckets, rhs.m_buckets);
+    std::swap(m_controls, rhs.m_controls);
+    std::swap(m_distances, rhs.m_distances);
+    std::swap(m_hashes, rhs.m_hashes);
+}
+
+MACRO_STORAGE_TEMPLATES
+void MACRO_STORAGE_CLASSNAME::take
+    (std::size_t index, HashMapBucketStorage & source,
+     std::size_t source_index) noexcept
+{
+    assert(is_empty(index) && !source.is_empty(source_index));
+    set_key(index, std::move(source.m_buckets[source_index].key));
+    new (element_space(index))
+        ElementType{std::move(source.element(source_index))};
+    source.element(source_index).~ElementType();
+    source.clear_key(source_index);
+    if constexpr (k_use_control_bytes) {
+        set_control(index, source.m_controls[source_index]);
+        source.set_control(source_index, ControlGroup::k_empty);
+    }
+    if constexpr (k_store_hashes)
+        { m_hashes[index] = source.m_hashes[source_index]; }
+}
+
+MACRO_STORAGE_TEMPLATES
+typename MACRO_STORAGE_CLASSNAME::KeyType
+    MACRO_STORAGE_CLASSNAME::vacate(std::size_t index) noexcept
+{
+    element(index).~ElementType();
+    auto key = std::move(m_buckets[index].key);
+    clear_key(index);
+    if constexpr (k_use_control_bytes)
+        { set_control(index, ControlGroup::k_empty); }
+    return key;
+}
+
+MACRO_STORAGE_TEMPLATES
+void MACRO_STORAGE_CLASSNAME::vacate_all() noexcept {
+    for (auto i = next_occupied(0); i != bucket_count(); i = next_occupied(i + 1))
+        { vacate(i); }
+}
+
+MACRO_STORAGE_TEMPLATES
+/* private static */ typename MACRO_STORAGE_CLASSNAME::BlockLayout
+    MACRO_STORAGE_CLASSNAME::block_layout_for(std::size_t bucket_count_)
+{
+    BlockLayout layout;
+    layout.controls = bucket_count_*sizeof(Bucket);
+    layout.distances = layout.controls;
+    if constexpr (k_use_control_bytes)
+        { layout.distances += bucket_count_ + ControlGroup::k_width - 1; }
+    layout.distances = round_up(layout.distances, alignof(ProbeDistance));
+    layout.hashes = layout.distances;
+    if constexpr (k_use_robin_hood)
+        { layout.hashes += bucket_count_*sizeof(ProbeDistance); }
+    layout.hashes = round_up(layout.hashes, alignof(std::size_t));
+    layout.size = layout.hashes;
+    if constexpr (k_store_hashes)
+        { layout.size += bucket_count_*sizeof(std::size_t); }
+    return layout;
+}
+
+MACRO_STORAGE_TEMPLATES
+/* private */ void MACRO_STORAGE_CLASSNAME::allocate_block
+    (std::size_t bucket_count_)
+{
+    assert(!m_chunks);
+    if (bucket_count_ == 0) return;
+
+    const auto layout = block_layout_for(bucket_count_);
+    std::size_t alignment = alignof(BlockChunk);
+    if constexpr (k_align_for_huge_pages) {
+        if (layout.size >= detail::k_huge_page_size)
+            { alignment = detail::k_huge_page_size; }
+    }
+    // over allocate, so that an aligned block fits somewhere inside
+    const auto chunk_count = round_up
+        (layout.size + alignment - alignof(BlockChunk), sizeof(BlockChunk))
+        / sizeof(BlockChunk);
+    BlockAllocator block_allocator{m_allocator};
+    auto * chunks = BlockAllocatorTraits::allocate(block_allocator, chunk_count);
+    auto * block = reinterpret_cast<std::byte *>(chunks);
+    const auto address = reinterpret_cast<std::uintptr_t>(block);
+    block += round_up(address, alignment) - address;
+
+    auto * buckets = reinterpret_cast<Bucket *>(block);
+    if constexpr (k_use_control_bytes) {
+        std::fill_n(reinterpret_cast<std::uint8_t *>(block + layout.controls),
+                    bucket_count_ + ControlGroup::k_width - 1,
+                    ControlGroup::k_empty);
+    } else {
+        std::size_t constructed = 0;
+        try {
+            for (; constructed != bucket_count_; ++constructed)
+                { new (buckets + constructed) Bucket{std::in_place, m_empty_key}; }
+        } catch (...) {
+            for (std::size_t i = 0; i != constructed; ++i)
+                { buckets[i].~Bucket(); }
+            BlockAllocatorTraits::deallocate(block_allocator, chunks, chunk_count);
+            throw;
+        }
+    }
+    if (alignment == detail::k_huge_page_size)
+        { detail::advise_huge_pages(block, layout.size); }
+
+    m_chunks = chunks;
+    m_chunk_count = chunk_count;
+    m_bucket_count = bucket_count_;
+    m_buckets = buckets;
+    if constexpr (k_use_control_bytes)
+        { m_controls = reinterpret_cast<std::uint8_t *>(block + layout.controls); }
+    if constexpr (k_use_robin_hood)
+        { m_distances = reinterpret_cast<ProbeDistance *>(block + layout.distances); }
+    if constexpr (k_store_hashes)
+        { m_hashes = reinterpret_cast<std::size_t *>(block + layout.hashes); }
+}
+
+MACRO_STORAGE_TEMPLATES
+/* private */ void MACRO_STORAGE_CLASSNAME::destroy_buckets() noexcept {
+    for (auto i = next_occupied(0); i != bucket_count(); i = next_occupied(i + 1)) {
+        element(i).~ElementType();
+        if constexpr (k_use_control_bytes)
+            { m_buckets[i].~Bucket(); }
+    }
+    if constexpr (!k_use_control_bytes && !std::is_trivially_destructible_v<Bucket>) {
+        for (std::size_t i = 0; i != bucket_count(); ++i)
+            { m_buckets[i].~Bucket(); }
+    }
+}
+
+MACRO_STORAGE_TEMPLATES
+/* private */ void MACRO_STORAGE_CLASSNAME::free_block() noexcept {
+    if (!m_chunks) return;
+    BlockAllocator block_allocator{m_allocator};
+    BlockAllocatorTraits::deallocate(block_allocator, m_chunks, m_chunk_count);
+    m_chunks = nullptr;
+    m_chunk_count = m_bucket_count = 0;
+    m_buckets = nullptr;
+    m_controls = nullptr;
+    m_distances = nullptr;
+    m_hashes = nullptr;
+}
+
+MACRO_STORAGE_TEMPLATES
+template <typename OtherKeyType>
+/* private */ void MACRO_STORAGE_CLASSNAME::set_key
+    (std::size_t index, OtherKeyType && key)
+{
+    // with control bytes, an empty bucket has no key at all
+    if constexpr (k_use_control_bytes) {
+        new (m_buckets + index)
+            Bucket{std::in_place, std::forward<OtherKeyType>(key)};
+    } else {
+        m_buckets[index].key = std::forward<OtherKeyType>(key);
+    }
+}
+
+MACRO_STORAGE_TEMPLATES
+/* private */ void MACRO_STORAGE_CLASSNAME::clear_key
+    (std::size_t index) noexcept
+{
+    if constexpr (k_use_control_bytes)
+        { m_buckets[index].~Bucket(); }
+    else
+        { m_buckets[index].key = m_empty_key; }
+}
+
+MACRO_STORAGE_TEMPLATES
+/* private */ void MACRO_STORAGE_CLASSNAME::set_control
+    (std::size_t index, std::uint8_t control) noexcept
+{
+    // the tail mirrors the head, so that a group may start at any bucket
+    m_controls[index] = control;
+    const auto end_of_mirror = bucket_count() + ControlGroup::k_width - 1;
+    for (auto i = index + bucket_count(); i < end_of_mirror; i += bucket_count())
+        { m_controls[i] = control; }
+}
+
+// ----------------------------------------------------------------------------
 
 MACRO_ITERATOR_TEMPLATES
 /* static */ MACRO_ITERATOR_CLASSNAME
@@ -386,26 +1314,24 @@ MACRO_ITERATOR_TEMPLATES
 
 MACRO_ITERATOR_TEMPLATES
 MACRO_ITERATOR_CLASSNAME::HashMapIteratorImpl
-    (std::size_t index_,
-     BucketContainerPtr container_,
-     const KeyType & empty_key_):
+    (std::size_t index_, StoragePtr storage_, StoragePtr old_storage_):
     m_index(index_),
-    m_container(container_),
-    m_empty_key(&empty_key_) {}
+    m_storage(storage_),
+    m_old_storage(old_storage_) {}
 
 MACRO_ITERATOR_TEMPLATES
 MACRO_ITERATOR_CLASSNAME::HashMapIteratorImpl
     (const HashMapIteratorImpl & rhs):
     m_index(rhs.m_index),
-    m_container(rhs.m_container),
-    m_empty_key(rhs.m_empty_key) {}
+    m_storage(rhs.m_storage),
+    m_old_storage(rhs.m_old_storage) {}
 
 MACRO_ITERATOR_TEMPLATES
 MACRO_ITERATOR_CLASSNAME::HashMapIteratorImpl
     (HashMapIteratorImpl && rhs):
     m_index(std::move(rhs.m_index)),
-    m_container(std::move(rhs.m_container)),
-    m_empty_key(std::move(rhs.m_empty_key)) {}
+    m_storage(std::move(rhs.m_storage)),
+    m_old_storage(std::move(rhs.m_old_storage)) {}
 
 MACRO_ITERATOR_TEMPLATES
 MACRO_ITERATOR_CLASSNAME &
@@ -413,8 +1339,8 @@ MACRO_ITERATOR_CLASSNAME &
 {
     if (this != &rhs) {
         m_index = rhs.m_index;
-        m_container = rhs.m_container;
-        m_empty_key = rhs.m_empty_key;
+        m_storage = rhs.m_storage;
+        m_old_storage = rhs.m_old_storage;
     }
     return *this;
 }
@@ -424,9 +1350,9 @@ MACRO_ITERATOR_CLASSNAME &
     MACRO_ITERATOR_CLASSNAME::operator = (HashMapIteratorImpl && rhs)
 {
     if (this != &rhs) {
-        std::swap(m_index    , rhs.m_index    );
-        std::swap(m_container, rhs.m_container);
-        std::swap(m_empty_key, rhs.m_empty_key);
+        std::swap(m_index  , rhs.m_index  );
+        std::swap(m_storage, rhs.m_storage);
+        std::swap(m_old_storage, rhs.m_old_storage);
     }
     return *this;
 }
@@ -442,22 +1368,32 @@ MACRO_ITERATOR_CLASSNAME &
 
 MACRO_ITERATOR_TEMPLATES
 /* private */ void MACRO_ITERATOR_CLASSNAME::advance_past_empty_() {
-    while (m_index < m_container->size() && KeyEquality{}(key(), *m_empty_key))
-        { ++m_index; }
+    const auto new_count = m_storage->bucket_count();
+    if (m_index < new_count) {
+        m_index = m_storage->next_occupied(m_index);
+        if (m_index != new_count) return;
+    }
+    m_index = new_count + m_old_storage->next_occupied(m_index - new_count);
 }
 
 MACRO_ITERATOR_TEMPLATES
 /* private */ bool MACRO_ITERATOR_CLASSNAME::equal_to
     (const HashMapIteratorImpl & rhs) const
-{ return m_index == rhs.m_index && m_container == rhs.m_container; }
+{ return m_index == rhs.m_index && m_storage == rhs.m_storage; }
 
 MACRO_ITERATOR_TEMPLATES
 /* private */
     typename MACRO_ITERATOR_CLASSNAME::PairWrapperImpl
     MACRO_ITERATOR_CLASSNAME::element() const
 {
-    auto & bucket = (*m_container)[m_index];
-    return PairWrapperImpl{bucket.first, &bucket.second};
+    const auto new_count = m_storage->bucket_count();
+    if (m_index >= new_count) {
+        return PairWrapperImpl
+            {m_old_storage->key(m_index - new_count),
+             m_old_storage->element_space(m_index - new_count)};
+    }
+    return PairWrapperImpl
+        {m_storage->key(m_index), m_storage->element_space(m_index)};
 }
 
 // ----------------------------------------------------------------------------
@@ -466,28 +1402,29 @@ MACRO_HASHMAP_TEMPLATES
 MACRO_HASHMAP_CLASSNAME::HashMap
     (KeyType empty_key_,
      const Allocator & allocator_):
-    m_empty_key(empty_key_),
-    m_bucket_container(allocator_) {}
+    m_storage(empty_key_, allocator_),
+    m_old_storage(empty_key_, allocator_) {}
 
 MACRO_HASHMAP_TEMPLATES
 MACRO_HASHMAP_CLASSNAME::HashMap(const HashMap & rhs):
-    m_empty_key(rhs.m_empty_key),
-    m_bucket_container(rhs.m_bucket_container),
-    m_size(rhs.m_size) {}
+    m_storage(rhs.m_storage),
+    m_old_storage(rhs.m_old_storage),
+    m_rehash_cursor(rhs.m_rehash_cursor),
+    m_rehash_remaining(rhs.m_rehash_remaining),
+    m_size(rhs.m_size),
+    m_has_erased(rhs.m_has_erased) {}
 
 MACRO_HASHMAP_TEMPLATES
 MACRO_HASHMAP_CLASSNAME::HashMap(HashMap && rhs):
-    m_empty_key(std::move(rhs.m_empty_key)),
-    m_bucket_container(std::move(rhs.m_bucket_container)),
-    m_size(std::move(rhs.m_size)) {}
-
-MACRO_HASHMAP_TEMPLATES
-MACRO_HASHMAP_CLASSNAME::~HashMap() {
-    for (auto & bucket : m_bucket_container) {
-        if (KeyEquality{}(bucket.first, m_empty_key))
-            { continue; }
-        reinterpret_cast<ElementType *>(&bucket.second)->~ElementType();
-    }
+    m_storage(std::move(rhs.m_storage)),
+    m_old_storage(std::move(rhs.m_old_storage)),
+    m_rehash_cursor(rhs.m_rehash_cursor),
+    m_rehash_remaining(rhs.m_rehash_remaining),
+    m_size(std::move(rhs.m_size)),
+    m_has_erased(rhs.m_has_erased)
+{
+    rhs.m_rehash_remaining = 0;
+    rhs.m_size = 0;
 }
 
 MACRO_HASHMAP_TEMPLATES
@@ -512,12 +1449,10 @@ MACRO_HASHMAP_CLASSNAME & MACRO_HASHMAP_CLASSNAME::operator =
 
 MACRO_HASHMAP_TEMPLATES
 void MACRO_HASHMAP_CLASSNAME::clear() noexcept {
-    for (auto & bucket : m_bucket_container) {
-        if (KeyEquality{}(bucket.first, m_empty_key))
-            { continue; }
-        bucket.first = m_empty_key;
-        reinterpret_cast<ElementType *>(&bucket.second)->~ElementType();
-    }
+    m_storage.vacate_all();
+    m_old_storage.vacate_all();
+    m_old_storage.release();
+    m_rehash_remaining = 0;
     m_size = 0;
 }
 
@@ -536,21 +1471,25 @@ typename MACRO_HASHMAP_CLASSNAME::Extraction
             {"Cannot extract/erase at the end position of the container"};
     }
 
-    auto index = Iterator::detail_bucket_index_of(iterator);
-    const auto beg_ = m_bucket_container.begin();
-    auto bucket = beg_ + index;
-    for (index = probe_next(index); true; index = probe_next(index)) {
-        assert(index < m_bucket_container.size());
-        auto index_itr = beg_ + index;
-        if (KeyEquality{}(index_itr->first, m_empty_key))
-            { return extract_bucket_and_advance(std::move(bucket), iterator); }
+    // note the order:
+    // extract bucket contents before
+    // destroying the element object and setting the key to empty before
+    // filling the gap and advancing the iterator
+    auto bucket = Iterator::detail_bucket_index_of(iterator);
+    --m_size;
+    m_has_erased = true;
 
-        auto ideal = m_bucket_container.begin() + key_to_index(index_itr->first);
-        if (magnitude(bucket - ideal) < magnitude(index_itr - ideal)) {
-            swap_buckets(bucket, index_itr);
-            bucket = index_itr;
-        }
-    }
+    auto & storage = bucket < bucket_count() ? m_storage : m_old_storage;
+    if (bucket >= bucket_count())
+        { bucket -= bucket_count(); }
+    auto returned_el = std::move(storage.element(bucket));
+    auto key = storage.vacate(bucket);
+    close_gap(storage, bucket);
+
+    return Extraction
+        {advance_past_empty(Iterator{iterator}),
+         std::move(returned_el),
+         std::move(key)};
 }
 
 MACRO_HASHMAP_TEMPLATES
@@ -565,142 +1504,527 @@ typename MACRO_HASHMAP_CLASSNAME::ConstIterator
     MACRO_HASHMAP_CLASSNAME::find(const OtherKeyType & key) const
 { return make_iterator(find_impl(key)); }
 
+MACRO_HASHMAP_TEMPLATES
+template <typename KeyIterator, typename OutIterator>
+OutIterator MACRO_HASHMAP_CLASSNAME::find_batch
+    (KeyIterator keys_beg, KeyIterator keys_end, OutIterator out)
+{
+    return find_batch_impl(keys_beg, keys_end, out,
+        [this] (std::size_t index) { return make_iterator(index); });
+}
+
+MACRO_HASHMAP_TEMPLATES
+template <typename KeyIterator, typename OutIterator>
+OutIterator MACRO_HASHMAP_CLASSNAME::find_batch
+    (KeyIterator keys_beg, KeyIterator keys_end, OutIterator out) const
+{
+    return find_batch_impl(keys_beg, keys_end, out,
+        [this] (std::size_t index) { return make_iterator(index); });
+}
+
+MACRO_HASHMAP_TEMPLATES
+template <typename PairIterator>
+std::size_t MACRO_HASHMAP_CLASSNAME::insert_batch
+    (PairIterator beg, PairIterator end)
+{
+    std::size_t hashes[k_batch_stretch];
+    std::size_t inserted = 0;
+    while (beg != end) {
+        std::size_t count = 0;
+        auto stretch_beg = beg;
+        beg = hash_stretch(beg, end,
+                           [] (const auto & pair) -> decltype(auto)
+                           { return (pair.first); },
+                           hashes, count);
+        for (std::size_t i = 0; i != count; ++i, ++stretch_beg) {
+            const auto & pair = *stretch_beg;
+            if (emplace_hashed(hashes[i], pair.first, pair.second).success)
+                { ++inserted; }
+        }
+    }
+    return inserted;
+}
+
+MACRO_HASHMAP_TEMPLATES
+std::size_t MACRO_HASHMAP_CLASSNAME::max_probe_length() const {
+    std::size_t rv = 0;
+    for_each_probe_length([&rv] (std::size_t length)
+        { rv = std::max(rv, length); });
+    return rv;
+}
+
+MACRO_HASHMAP_TEMPLATES
+double MACRO_HASHMAP_CLASSNAME::average_probe_length() const {
+    if (is_empty()) return 0.;
+    std::size_t sum = 0;
+    for_each_probe_length([&sum] (std::size_t length)
+        { sum += length; });
+    return double(sum) / double(size());
+}
+
+MACRO_HASHMAP_TEMPLATES
+std::vector<std::size_t> MACRO_HASHMAP_CLASSNAME::probe_length_histogram() const {
+    std::vector<std::size_t> rv;
+    for_each_probe_length([&rv] (std::size_t length) {
+        if (length >= rv.size())
+            { rv.resize(length + 1, 0); }
+        ++rv[length];
+    });
+    return rv;
+}
+
 MACRO_HASHMAP_TEMPLATES
 void MACRO_HASHMAP_CLASSNAME::rehash
     (std::size_t for_at_least_this_many_elements)
 {
-    HashMap temp{m_empty_key};
-    temp.reserve(std::max(m_bucket_container.size()*k_load_factor,
-                          for_at_least_this_many_elements));
-    for (auto itr = begin(); itr != end(); ) {
-        assert(!KeyEquality{}(itr->first, m_empty_key));
-        auto extraction = extract(itr);
-        temp.emplace(std::move(extraction.key),
-                     std::move(extraction.element));
-        itr = extraction.next;
-    }
-    swap(temp);
+    rebuild(std::max(bucket_count(), bucket_count_for
+        (std::max(size(), for_at_least_this_many_elements))));
 }
 
 MACRO_HASHMAP_TEMPLATES
 void MACRO_HASHMAP_CLASSNAME::reserve
     (std::size_t for_at_least_this_many_elements)
 {
-    if (for_at_least_this_many_elements <= m_bucket_container.size())
+    if (for_at_least_this_many_elements <= capacity())
         { return; }
+    rebuild(bucket_count_for(for_at_least_this_many_elements));
+}
 
-    Bucket empty_bucket = std::make_pair(m_empty_key, ElementSpace{});
-    m_bucket_container.resize
-        (detail::nearest_base2_number
-            (for_at_least_this_many_elements*k_load_factor),
-         empty_bucket);
+MACRO_HASHMAP_TEMPLATES
+void MACRO_HASHMAP_CLASSNAME::shrink_to_fit() {
+    auto fewest_buckets = bucket_count_for(size());
+    if (fewest_buckets < bucket_count())
+        { rebuild(fewest_buckets); }
 }
 
 MACRO_HASHMAP_TEMPLATES
 void MACRO_HASHMAP_CLASSNAME::swap(HashMap & rhs) {
-    m_bucket_container.swap(rhs.m_bucket_container);
-    std::swap(m_empty_key, rhs.m_empty_key);
-    std::swap(m_size     , rhs.m_size     );
+    m_storage.swap(rhs.m_storage);
+    m_old_storage.swap(rhs.m_old_storage);
+    std::swap(m_rehash_cursor   , rhs.m_rehash_cursor   );
+    std::swap(m_rehash_remaining, rhs.m_rehash_remaining);
+    std::swap(m_size            , rhs.m_size            );
+    std::swap(m_has_erased      , rhs.m_has_erased      );
 }
 
 MACRO_HASHMAP_TEMPLATES
-/* private static */ void MACRO_HASHMAP_CLASSNAME::swap_buckets
-    (BucketIterator & lhs, BucketIterator & rhs) noexcept
+/* private static */ std::size_t MACRO_HASHMAP_CLASSNAME::bucket_count_for
+    (std::size_t element_count)
 {
-    auto & lhs_el = *reinterpret_cast<ElementType *>(&lhs->second);
-    auto & rhs_el = *reinterpret_cast<ElementType *>(&rhs->second);
-    std::swap(lhs->first, rhs->first);
-    std::swap(lhs_el, rhs_el);
+    if (element_count == 0) return 0;
+    // since the load factor is less than one, this always leaves at least
+    // one bucket empty
+    return detail::nearest_base2_number
+        ((element_count*MaxLoadFactor::den + MaxLoadFactor::num - 1)
+         / MaxLoadFactor::num);
 }
 
 MACRO_HASHMAP_TEMPLATES
 /* private */ typename MACRO_HASHMAP_CLASSNAME::Iterator
     MACRO_HASHMAP_CLASSNAME::make_iterator(std::size_t index)
-{ return Iterator{index, &m_bucket_container, m_empty_key}; }
+{ return Iterator{index, &m_storage, &m_old_storage}; }
 
 MACRO_HASHMAP_TEMPLATES
 /* private */ typename MACRO_HASHMAP_CLASSNAME::ConstIterator
     MACRO_HASHMAP_CLASSNAME::make_iterator(std::size_t index) const
-{ return ConstIterator{index, &m_bucket_container, m_empty_key}; }
+{ return ConstIterator{index, &m_storage, &m_old_storage}; }
 
 MACRO_HASHMAP_TEMPLATES
 template <typename OtherKeyType, typename ... ArgTypes>
 /* private */
     typename MACRO_HASHMAP_CLASSNAME::Insertion
-    MACRO_HASHMAP_CLASSNAME::emplace_impl
-    (OtherKeyType && key, ArgTypes &&... element_args)
+    MACRO_HASHMAP_CLASSNAME::emplace_hashed
+    (std::size_t hash, OtherKeyType && key, ArgTypes &&... element_args)
 {
-    if (KeyEquality{}(m_empty_key, key)) {
+    if (KeyEquality{}(m_storage.empty_key(), key)) {
         throw std::invalid_argument
             {"Cannot use empty key for inserting elements in hash map"};
     }
 
+    if (is_rehashing())
+        { continue_rehash(k_incremental_rehash_step); }
+    if (should_shrink())
+        { rebuild(bucket_count_for((size() + 1)*2)); }
     if (size() + 1 > capacity())
-        { rehash((size() + 1)*2); }
-
-    for (auto index = key_to_index(key); true; index = probe_next(index)) {
-        auto & bucket = m_bucket_container[index];
-        if (KeyEquality{}(bucket.first, m_empty_key)) {
-            bucket.first = std::move(key);
-            new (&bucket.second)
-                ElementType{std::forward<ArgTypes>(element_args)...};
-            ++m_size;
-            return Insertion{true, make_iterator(index)};
-        } else if (KeyEquality{}(bucket.first, key)) {
-            return Insertion{false, make_iterator(index)};
+        { grow(); }
+
+    if (is_rehashing()) {
+        auto old_probe = probe_for(m_old_storage, key, hash);
+        if (old_probe.found) {
+            return Insertion
+                {false, make_iterator(bucket_count() + old_probe.index)};
         }
     }
+    return emplace_in_place(hash, std::forward<OtherKeyType>(key),
+                            std::forward<ArgTypes>(element_args)...);
 }
 
 MACRO_HASHMAP_TEMPLATES
-/* private */ std::size_t MACRO_HASHMAP_CLASSNAME::probe_next
-    (std::size_t idx) const noexcept
-    { return (idx + 1) & size_mask(); }
+template <typename OtherKeyType, typename ... ArgTypes>
+/* private */
+    typename MACRO_HASHMAP_CLASSNAME::Insertion
+    MACRO_HASHMAP_CLASSNAME::emplace_in_place
+    (std::size_t hash, OtherKeyType && key, ArgTypes &&... element_args)
+{
+    auto probe = probe_for(m_storage, key, hash);
+    if (probe.found)
+        { return Insertion{false, make_iterator(probe.index)}; }
+
+    if constexpr (k_use_robin_hood) {
+        make_room(probe.index);
+        try {
+            m_storage.place(probe.index, hash, std::forward<OtherKeyType>(key),
+                            std::forward<ArgTypes>(element_args)...);
+        } catch (...) {
+            close_gap(m_storage, probe.index);
+            throw;
+        }
+        m_storage.set_probe_distance
+            (probe.index, (probe.index - hash) & size_mask());
+    } else {
+        m_storage.place(probe.index, hash, std::forward<OtherKeyType>(key),
+                        std::forward<ArgTypes>(element_args)...);
+    }
+    ++m_size;
+    return Insertion{true, make_iterator(probe.index)};
+}
 
 MACRO_HASHMAP_TEMPLATES
-/* private */ typename MACRO_HASHMAP_CLASSNAME::Extraction
-    MACRO_HASHMAP_CLASSNAME::extract_bucket_and_advance
-    (BucketIterator && bucket, const Iterator & iterator) noexcept
+/* private static */ std::size_t MACRO_HASHMAP_CLASSNAME::probe_next
+    (const Storage & storage, std::size_t idx) noexcept
+    { return (idx + 1) & size_mask(storage); }
+
+MACRO_HASHMAP_TEMPLATES
+/* private static */ std::size_t MACRO_HASHMAP_CLASSNAME::probe_distance
+    (const Storage & storage, std::size_t index)
 {
-    // note the order:
-    // extract bucket contents before
-    // destroying the element object and setting the key to empty before
-    // advancing the iterator
-    --m_size;
+    if constexpr (k_use_robin_hood)
+        { return storage.probe_distance(index); }
+    else
+        { return (index - bucket_hash(storage, index)) & size_mask(storage); }
+}
 
-    auto & el = *reinterpret_cast<ElementType *>(&bucket->second);
-    auto returned_el = std::move(el);
-    el.~ElementType();
+MACRO_HASHMAP_TEMPLATES
+/* private static */ std::size_t MACRO_HASHMAP_CLASSNAME::bucket_hash
+    (const Storage & storage, std::size_t index)
+{
+    if constexpr (k_store_hashes)
+        { return storage.hash(index); }
+    else
+        { return Hasher{}(storage.key(index)); }
+}
 
-    auto key = std::move(bucket->first);
-    bucket->first = m_empty_key;
+MACRO_HASHMAP_TEMPLATES
+/* private */ void MACRO_HASHMAP_CLASSNAME::take_from
+    (Storage & source, std::size_t source_index, std::size_t hash) noexcept
+{
+    auto index = vacancy_for(hash);
+    if constexpr (k_use_robin_hood)
+        { make_room(index); }
+    m_storage.take(index, source, source_index);
+    if constexpr (k_use_robin_hood)
+        { m_storage.set_probe_distance(index, (index - hash) & size_mask()); }
+}
 
-    return Extraction
-        {advance_past_empty(Iterator{iterator}),
-         std::move(returned_el),
-         std::move(key)};
+MACRO_HASHMAP_TEMPLATES
+/* private */ std::size_t MACRO_HASHMAP_CLASSNAME::vacancy_for
+    (std::size_t hash) const noexcept
+{
+    if constexpr (k_use_robin_hood) {
+        return robin_hood_position(m_storage, hash);
+    } else if constexpr (k_use_control_bytes) {
+        using ControlGroup = detail::HashMapControlGroup;
+        for (auto index = hash & size_mask(); true;
+             index = (index + ControlGroup::k_width) & size_mask())
+        {
+            auto empties = ControlGroup{m_storage.controls() + index}.match_empty();
+            if (empties.has_any())
+                { return (index + empties.lowest()) & size_mask(); }
+        }
+    } else {
+        auto index = hash & size_mask();
+        while (!m_storage.is_empty(index))
+            { index = probe_next(index); }
+        return index;
+    }
+}
+
+MACRO_HASHMAP_TEMPLATES
+/* private static */ void MACRO_HASHMAP_CLASSNAME::close_gap
+    (Storage & storage, std::size_t empty_index) noexcept
+{
+    auto gap = empty_index;
+    for (auto index = probe_next(storage, gap); !storage.is_empty(index);
+         index = probe_next(storage, index))
+    {
+        auto distance = probe_distance(storage, index);
+        if constexpr (k_use_robin_hood) {
+            // following elements sit no closer to their ideal buckets
+            if (distance == 0) return;
+            storage.move_bucket(index, gap);
+            storage.set_probe_distance(gap, distance - 1);
+            gap = index;
+        } else if (((index - gap) & size_mask(storage)) <= distance) {
+            // element may only move back as far as its ideal bucket
+            storage.move_bucket(index, gap);
+            gap = index;
+        }
+    }
+}
+
+MACRO_HASHMAP_TEMPLATES
+/* private */ void MACRO_HASHMAP_CLASSNAME::make_room
+    (std::size_t index) noexcept
+{
+    auto last = index;
+    while (!m_storage.is_empty(last))
+        { last = probe_next(last); }
+    for (; last != index; last = (last - 1) & size_mask()) {
+        auto prev = (last - 1) & size_mask();
+        m_storage.move_bucket(prev, last);
+        m_storage.set_probe_distance(last, m_storage.probe_distance(last) + 1);
+    }
+}
+
+MACRO_HASHMAP_TEMPLATES
+/* private static */ std::size_t MACRO_HASHMAP_CLASSNAME::robin_hood_position
+    (const Storage & storage, std::size_t hash) noexcept
+{
+    std::size_t distance = 0;
+    auto index = hash & size_mask(storage);
+    while (   !storage.is_empty(index)
+           && storage.probe_distance(index) >= distance)
+    {
+        index = probe_next(storage, index);
+        ++distance;
+    }
+    return index;
+}
+
+MACRO_HASHMAP_TEMPLATES
+template <typename Func>
+/* private */ void MACRO_HASHMAP_CLASSNAME::for_each_probe_length
+    (Func && f) const
+{
+    for (const Storage * storage : { &m_storage, &m_old_storage }) {
+        for (auto i = storage->next_occupied(0); i != storage->bucket_count();
+             i = storage->next_occupied(i + 1))
+        { f(probe_distance(*storage, i)); }
+    }
+}
+
+MACRO_HASHMAP_TEMPLATES
+/* private */ void MACRO_HASHMAP_CLASSNAME::grow() {
+    finish_rehash();
+    auto bucket_count_ = std::max(bucket_count(), bucket_count_for(size() + 1));
+    if constexpr (k_incremental_rehash_step != 0) {
+        if (!is_empty()) {
+            // old buckets are migrated a cluster at a time, starting just
+            // past an empty bucket, so that what remains is always whole
+            // clusters (a valid table by itself)
+            m_old_storage.swap(m_storage);
+            m_storage.reset(bucket_count_);
+            std::size_t start = 0;
+            while (!m_old_storage.is_empty(start))
+                { ++start; }
+            m_rehash_cursor = probe_next(m_old_storage, start);
+            m_rehash_remaining = m_old_storage.bucket_count();
+            continue_rehash(k_incremental_rehash_step);
+            return;
+        }
+    }
+    rebuild(bucket_count_);
+}
+
+MACRO_HASHMAP_TEMPLATES
+/* private */ void MACRO_HASHMAP_CLASSNAME::continue_rehash
+    (std::size_t bucket_budget) noexcept
+{
+    std::size_t visited = 0;
+    while (m_rehash_remaining != 0) {
+        auto index = m_rehash_cursor;
+        m_rehash_cursor = probe_next(m_old_storage, index);
+        --m_rehash_remaining;
+        // only stop at the end of a cluster
+        if (m_old_storage.is_empty(index)) {
+            if (++visited >= bucket_budget) break;
+            continue;
+        }
+        ++visited;
+        take_from(m_old_storage, index, bucket_hash(m_old_storage, index));
+    }
+    if (m_rehash_remaining == 0)
+        { m_old_storage.release(); }
+}
+
+MACRO_HASHMAP_TEMPLATES
+/* private */ void MACRO_HASHMAP_CLASSNAME::rebuild(std::size_t bucket_count_) {
+    assert(bucket_count_ >= bucket_count_for(size()));
+    finish_rehash();
+    HashMap temp{m_storage.empty_key(), m_storage.allocator()};
+    temp.m_storage.reset(bucket_count_);
+    // each element is moved exactly once, straight into its new bucket
+    for (auto i = m_storage.next_occupied(0); i != bucket_count();
+         i = m_storage.next_occupied(i + 1))
+    { temp.take_from(m_storage, i, bucket_hash(m_storage, i)); }
+    temp.m_size = m_size;
+    swap(temp);
+    m_has_erased = false;
+}
+
+MACRO_HASHMAP_TEMPLATES
+/* private */ bool MACRO_HASHMAP_CLASSNAME::should_shrink() const noexcept {
+    if constexpr (MinLoadFactor::num == 0) {
+        return false;
+    } else {
+        return    m_has_erased
+               && bucket_count()*MinLoadFactor::num / MinLoadFactor::den > size()
+               && bucket_count_for((size() + 1)*2) < bucket_count();
+    }
+}
+
+MACRO_HASHMAP_TEMPLATES
+template <typename OtherKeyType>
+/* private */ std::size_t MACRO_HASHMAP_CLASSNAME::find_hashed
+    (const OtherKeyType & key, std::size_t hash) const noexcept
+{
+    if (KeyEquality{}(key, m_storage.empty_key()) || bucket_count() == 0)
+        { return bucket_index_end(); }
+
+    auto probe = probe_for(m_storage, key, hash);
+    if (probe.found)
+        { return probe.index; }
+    if (is_rehashing()) {
+        // old buckets follow new ones in iteration order
+        auto old_probe = probe_for(m_old_storage, key, hash);
+        if (old_probe.found)
+            { return bucket_count() + old_probe.index; }
+    }
+    return bucket_index_end();
+}
+
+MACRO_HASHMAP_TEMPLATES
+template <typename KeyIterator, typename KeyFunc>
+/* private */ KeyIterator MACRO_HASHMAP_CLASSNAME::hash_stretch
+    (KeyIterator beg, KeyIterator end, KeyFunc && key_of,
+     std::size_t * hashes, std::size_t & count) const
+{
+    static_assert(std::is_base_of_v<
+        std::forward_iterator_tag,
+        typename std::iterator_traits<KeyIterator>::iterator_category>,
+        "Batch operations pass over each stretch twice, and so require "
+        "forward iterators (single pass input iterators are not supported).");
+    for (count = 0; count != k_batch_stretch && beg != end; ++count, ++beg) {
+        hashes[count] = detail_hash(key_of(*beg));
+        if (bucket_count() != 0)
+            { m_storage.prefetch(hashes[count] & size_mask()); }
+    }
+    return beg;
+}
+
+MACRO_HASHMAP_TEMPLATES
+template <typename KeyIterator, typename OutIterator, typename MakeIteratorFunc>
+/* private */ OutIterator MACRO_HASHMAP_CLASSNAME::find_batch_impl
+    (KeyIterator keys_beg, KeyIterator keys_end, OutIterator out,
+     MakeIteratorFunc && make_iterator_) const
+{
+    std::size_t hashes[k_batch_stretch];
+    while (keys_beg != keys_end) {
+        std::size_t count = 0;
+        auto stretch_beg = keys_beg;
+        keys_beg = hash_stretch(keys_beg, keys_end,
+                                [] (const auto & key) -> decltype(auto)
+                                { return (key); },
+                                hashes, count);
+        for (std::size_t i = 0; i != count; ++i, ++stretch_beg) {
+            *out++ = make_iterator_(find_hashed(*stretch_beg, hashes[i]));
+        }
+    }
+    return out;
 }
 
 MACRO_HASHMAP_TEMPLATES
 template <typename OtherKeyType>
-/* private */ std::size_t MACRO_HASHMAP_CLASSNAME::find_impl
-    (const OtherKeyType & key) const noexcept
+/* private static */ typename MACRO_HASHMAP_CLASSNAME::ProbeResult
+    MACRO_HASHMAP_CLASSNAME::probe_for
+    (const Storage & storage, const OtherKeyType & key, std::size_t hash) noexcept
 {
-    if (KeyEquality{}(key, m_empty_key) || m_bucket_container.empty())
-        { return m_bucket_container.size(); }
+    const auto mask = size_mask(storage);
+    if constexpr (k_use_control_bytes) {
+        using ControlGroup = detail::HashMapControlGroup;
+        const auto tag = ControlGroup::tag_for(hash);
+        for (auto index = hash & mask; true;
+             index = (index + ControlGroup::k_width) & mask)
+        {
+            ControlGroup group{storage.controls() + index};
+            auto empties = group.match_empty();
+            auto matches = group.match(tag).before_lowest_of(empties);
+            for (; matches.has_any(); matches = matches.without_lowest()) {
+                auto candidate = (index + matches.lowest()) & mask;
+                if (bucket_holds(storage, candidate, key, hash))
+                    { return ProbeResult{candidate, true}; }
+            }
+            if (!empties.has_any())
+                { continue; }
+            if constexpr (k_use_robin_hood)
+                { return ProbeResult{robin_hood_position(storage, hash), false}; }
+            else
+                { return ProbeResult{(index + empties.lowest()) & mask, false}; }
+        }
+    } else {
+        std::size_t distance = 0;
+        for (auto index = hash & mask; true; index = probe_next(storage, index)) {
+            if (storage.is_empty(index))
+                { return ProbeResult{index, false}; }
+            if constexpr (k_use_robin_hood) {
+                if (storage.probe_distance(index) < distance)
+                    { return ProbeResult{index, false}; }
+                ++distance;
+            }
+            if (bucket_holds(storage, index, key, hash))
+                { return ProbeResult{index, true}; }
+        }
+    }
+}
 
-    for (auto index = key_to_index(key); true; index = probe_next(index)) {
-        auto & bucket = m_bucket_container[index];
-        if (KeyEquality{}(bucket.first, key))
-            { return index; }
-        if (KeyEquality{}(bucket.first, m_empty_key))
-            { return m_bucket_container.size(); }
+MACRO_HASHMAP_TEMPLATES
+template <typename OtherKeyType>
+/* private static */ bool MACRO_HASHMAP_CLASSNAME::bucket_holds
+    (const Storage & storage, std::size_t index, const OtherKeyType & key,
+     std::size_t hash) noexcept
+{
+    if constexpr (k_store_hashes) {
+        if (storage.hash(index) != hash)
+            return false;
     }
+    return KeyEquality{}(storage.key(index), key);
 }
 
+// ----------------------------------------------------------------------------
+
+namespace pmr {
+
+/** A HashMap which takes its buckets from a std::pmr::memory_resource (an
+ *  arena, or pool for instance).
+ */
+template <
+    typename KeyT,
+    typename ElementT,
+    typename HashT = std::hash<KeyT>,
+    typename KeyEqualT = std::equal_to<void>,
+    typename PolicyT = HashMapDefaultPolicy
+>
+using HashMap = cul::HashMap<
+    KeyT, ElementT, HashT, KeyEqualT,
+    std::pmr::polymorphic_allocator<std::byte>, PolicyT>;
+
+} // end of pmr namespace -> into ::cul
+
 #undef MACRO_ITERATOR_TEMPLATES
 #undef MACRO_ITERATOR_CLASSNAME
 #undef MACRO_HASHMAP_TEMPLATES
 #undef MACRO_HASHMAP_CLASSNAME
+#undef MACRO_STORAGE_TEMPLATES
+#undef MACRO_STORAGE_CLASSNAME
 
 } // end of cul namespace
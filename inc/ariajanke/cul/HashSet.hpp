@@ -0,0 +1,206 @@
+/****************************************************************************
+
+    MIT License
+
+    Copyright (c) 2023 Aria Janke
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+
+*****************************************************************************/
+
+
+#pragma once
+
+#include <ariajanke/cul/HashMap.hpp>
+
+namespace cul {
+
+namespace detail {
+
+/** Element type for a HashSet's underlying map, which takes no space in
+ *  its buckets.
+ */
+struct HashSetNoElement {};
+
+} // end of detail namespace -> into ::cul
+
+template <typename KeyT, typename MapIteratorT>
+class HashSetIteratorImpl;
+
+/** A set of keys, sharing all of HashMap's probing and storage (and its
+ *  policies), but storing no elements.
+ *
+ *  As with HashMap, one key value is reserved as the "empty" key, and may
+ *  never be inserted.
+ */
+template <
+    typename KeyT,
+    typename HashT = std::hash<KeyT>,
+    typename KeyEqualT = std::equal_to<void>,
+    typename AllocatorT = std::allocator<KeyT>,
+    typename PolicyT = HashMapDefaultPolicy
+>
+class HashSet final {
+    using MapType = HashMap
+        <KeyT, detail::HashSetNoElement, HashT, KeyEqualT, AllocatorT, PolicyT>;
+public:
+    using KeyType = KeyT;
+    using Hasher = HashT;
+    using KeyEquality = KeyEqualT;
+    using Allocator = AllocatorT;
+    using Policy = PolicyT;
+    using Iterator = HashSetIteratorImpl<KeyT, typename MapType::Iterator>;
+    using ConstIterator =
+        HashSetIteratorImpl<KeyT, typename MapType::ConstIterator>;
+
+    struct Insertion final {
+        bool success;
+        Iterator position;
+    };
+
+    explicit HashSet(KeyType empty_key, const Allocator & allocator_ = Allocator{}):
+        m_map(std::move(empty_key), allocator_) {}
+
+    ConstIterator begin() const noexcept { return ConstIterator{m_map.begin()}; }
+
+    Iterator begin() noexcept { return Iterator{m_map.begin()}; }
+
+    std::size_t bucket_count() const noexcept { return m_map.bucket_count(); }
+
+    std::size_t capacity() const noexcept { return m_map.capacity(); }
+
+    void clear() noexcept { m_map.clear(); }
+
+    template <typename OtherKeyType>
+    bool contains(const OtherKeyType & key) const
+        { return m_map.find(key) != m_map.end(); }
+
+    ConstIterator end() const noexcept { return ConstIterator{m_map.end()}; }
+
+    Iterator end() noexcept { return Iterator{m_map.end()}; }
+
+    /** @returns iterator following the erased key */
+    Iterator erase(const Iterator & itr)
+        { return Iterator{m_map.erase(itr.map_iterator())}; }
+
+    /** @returns true if the key was present */
+    template <typename OtherKeyType>
+    bool erase(const OtherKeyType & key);
+
+    template <typename OtherKeyType>
+    Iterator find(const OtherKeyType & key)
+        { return Iterator{m_map.find(key)}; }
+
+    template <typename OtherKeyType>
+    ConstIterator find(const OtherKeyType & key) const
+        { return ConstIterator{m_map.find(key)}; }
+
+    /** @throws std::invalid_argument if the key is the empty key */
+    template <typename OtherKeyType>
+    Insertion insert(OtherKeyType && key);
+
+    bool is_empty() const noexcept { return m_map.is_empty(); }
+
+    void rehash(std::size_t for_at_least_this_many_keys = 0)
+        { m_map.rehash(for_at_least_this_many_keys); }
+
+    void reserve(std::size_t for_at_least_this_many_keys)
+        { m_map.reserve(for_at_least_this_many_keys); }
+
+    void shrink_to_fit() { m_map.shrink_to_fit(); }
+
+    std::size_t size() const noexcept { return m_map.size(); }
+
+    void swap(HashSet & rhs) { m_map.swap(rhs.m_map); }
+
+private:
+    MapType m_map;
+};
+
+// ----------------------------------------------------------------------------
+
+template <typename KeyT, typename MapIteratorT>
+class HashSetIteratorImpl final {
+public:
+    // defs for std algorithms
+    using difference_type = std::ptrdiff_t;
+    using value_type = KeyT;
+    using pointer = const KeyT *;
+    using reference = const KeyT &;
+    using iterator_category = std::forward_iterator_tag;
+
+    explicit HashSetIteratorImpl(const MapIteratorT & itr): m_itr(itr) {}
+
+    bool operator == (const HashSetIteratorImpl & rhs) const
+        { return m_itr == rhs.m_itr; }
+
+    bool operator != (const HashSetIteratorImpl & rhs) const
+        { return m_itr != rhs.m_itr; }
+
+    HashSetIteratorImpl & operator ++ () {
+        ++m_itr;
+        return *this;
+    }
+
+    const KeyT & operator * () const { return (*m_itr).first; }
+
+    const KeyT * operator -> () const { return &(*m_itr).first; }
+
+    const MapIteratorT & map_iterator() const { return m_itr; }
+
+private:
+    MapIteratorT m_itr;
+};
+
+// ----------------------------------------------------------------------------
+
+#define MACRO_HASHSET_TEMPLATES \
+    template < \
+        typename KeyT, \
+        typename HashT, \
+        typename KeyEqualT, \
+        typename AllocatorT, \
+        typename PolicyT \
+    >
+
+#define MACRO_HASHSET_CLASSNAME \
+    HashSet<KeyT, HashT, KeyEqualT, AllocatorT, PolicyT>
+
+MACRO_HASHSET_TEMPLATES
+template <typename OtherKeyType>
+bool MACRO_HASHSET_CLASSNAME::erase(const OtherKeyType & key) {
+    auto itr = m_map.find(key);
+    if (itr == m_map.end()) return false;
+    m_map.erase(itr);
+    return true;
+}
+
+MACRO_HASHSET_TEMPLATES
+template <typename OtherKeyType>
+typename MACRO_HASHSET_CLASSNAME::Insertion
+    MACRO_HASHSET_CLASSNAME::insert(OtherKeyType && key)
+{
+    auto insertion = m_map.emplace(std::forward<OtherKeyType>(key));
+    return Insertion{insertion.success, Iterator{insertion.position}};
+}
+
+#undef MACRO_HASHSET_TEMPLATES
+#undef MACRO_HASHSET_CLASSNAME
+
+} // end of cul namespace
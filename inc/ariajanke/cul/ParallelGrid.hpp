@@ -0,0 +1,344 @@
+/****************************************************************************
+
+    MIT License
+
+    Copyright (c) 2021 Aria Janke
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+
+*****************************************************************************/
+
+
+#pragma once
+
+#include <ariajanke/cul/Grid.hpp>
+
+#include <atomic>
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace cul {
+
+/** A fixed set of threads, which all work through the tasks of one run at
+ *  a time. The thread calling run works too.
+ */
+class GridThreadPool final {
+public:
+    /** @param thread_count total number of threads working on each run
+     *                      (including the caller), zero for one per
+     *                      hardware thread
+     */
+    explicit GridThreadPool(int thread_count = 0);
+
+    GridThreadPool(const GridThreadPool &) = delete;
+
+    GridThreadPool(GridThreadPool &&) = delete;
+
+    ~GridThreadPool();
+
+    GridThreadPool & operator = (const GridThreadPool &) = delete;
+
+    GridThreadPool & operator = (GridThreadPool &&) = delete;
+
+    /** @returns the pool shared by all parallel grid functions, unless
+     *           they're given another
+     */
+    static GridThreadPool & default_instance();
+
+    int thread_count() const noexcept { return int(m_workers.size()) + 1; }
+
+    /** Calls f with every task index in [0, task_count), returning once
+     *  all are done.
+     *
+     *  Idle threads take the next unclaimed task, so that uneven tasks
+     *  balance out. If deterministic, thread i instead takes tasks i,
+     *  i + thread_count(), i + 2*thread_count()... in that order, every
+     *  time.
+     *
+     *  Runs from inside a task (or on a single thread pool) just call f in
+     *  order on the calling thread.
+     *
+     *  @throws the first exception thrown by f, remaining tasks are then
+     *          skipped
+     */
+    template <typename Func>
+    void run(std::size_t task_count, bool deterministic, Func && f);
+
+private:
+    using Job = std::function<void(int worker_index)>;
+
+    static bool & is_in_task() noexcept;
+
+    void run_job(const Job &);
+
+    void work(int worker_index);
+
+    std::mutex m_run_mutex;
+    std::mutex m_mutex;
+    std::condition_variable m_job_posted;
+    std::condition_variable m_job_finished;
+    const Job * m_job = nullptr;
+    std::size_t m_generation = 0;
+    int m_unfinished = 0;
+    bool m_stopping = false;
+    std::vector<std::thread> m_workers;
+};
+
+/** How a parallel grid function splits up its work. */
+struct ParallelGridOptions final {
+    static constexpr const int k_default_grain = 4096;
+
+    /** Least number of cells each task covers. Tasks are always whole
+     *  rows, so small grains mean single rows.
+     */
+    int grain = k_default_grain;
+
+    /** If true, each task always goes to the same thread (see
+     *  GridThreadPool::run), so that per thread state is reproducible.
+     */
+    bool deterministic = false;
+
+    /** Pool to run on, the default instance if null. */
+    GridThreadPool * pool = nullptr;
+};
+
+/** Calls f with every cell of a Grid (or SubGrid, or anything with width,
+ *  height and element access), spread over a thread pool a band of rows at
+ *  a time.
+ *
+ *  f is called either as f(position, element), or f(element). It's called
+ *  concurrently, and so may only touch its own cell (or read others that
+ *  nothing writes).
+ *
+ *  @note Grid<bool> packs its elements, so its cells may not be written
+ *        concurrently
+ */
+template <typename GridType, typename Func>
+void parallel_for_each_cell
+    (GridType && grid, Func && f,
+     const ParallelGridOptions & = ParallelGridOptions{});
+
+/** Assigns every cell of destination, from f called with the same cell of
+ *  source, spread over a thread pool as parallel_for_each_cell is.
+ *
+ *  f is called either as f(position, source element), or f(source
+ *  element). Source and destination may be the same grid.
+ *
+ *  @throws std::invalid_argument if source and destination sizes differ
+ */
+template <typename SourceGridType, typename DestinationGridType, typename Func>
+void parallel_transform
+    (const SourceGridType & source, DestinationGridType && destination, Func && f,
+     const ParallelGridOptions & = ParallelGridOptions{});
+
+// ----------------------------------------------------------------------------
+
+#ifndef DOXYGEN_SHOULD_SKIP_THIS
+
+namespace detail {
+
+template <typename GridType, typename = void>
+struct HasUncheckedElement : public std::false_type {};
+
+template <typename GridType>
+struct HasUncheckedElement<
+    GridType,
+    std::void_t<decltype(std::declval<GridType &>().element_unchecked(0, 0))>> :
+    public std::true_type {};
+
+template <typename GridType>
+decltype(auto) parallel_grid_cell(GridType & grid, int x, int y) {
+    if constexpr (HasUncheckedElement<GridType>::value)
+        { return grid.element_unchecked(x, y); }
+    else
+        { return grid(x, y); }
+}
+
+template <typename Func, typename ElementReference>
+decltype(auto) call_with_cell(Func & f, int x, int y, ElementReference && el) {
+    if constexpr (std::is_invocable_v<Func &, Vector2<int>, ElementReference &&>)
+        { return f(Vector2<int>{x, y}, std::forward<ElementReference>(el)); }
+    else
+        { return f(std::forward<ElementReference>(el)); }
+}
+
+/** Calls f(y_begin, y_end) for bands of rows, over a thread pool. */
+template <typename Func>
+void for_each_row_band
+    (int width, int height, const ParallelGridOptions & options, Func && f)
+{
+    if (width <= 0 || height <= 0) return;
+    const int rows_per_task = std::max(1, options.grain / width);
+    const auto task_count = std::size_t((height + rows_per_task - 1) / rows_per_task);
+    auto & pool = options.pool ? *options.pool : GridThreadPool::default_instance();
+    pool.run(task_count, options.deterministic, [&] (std::size_t task) {
+        const int y_begin = int(task)*rows_per_task;
+        f(y_begin, std::min(height, y_begin + rows_per_task));
+    });
+}
+
+} // end of detail namespace -> into ::cul
+
+inline GridThreadPool::GridThreadPool(int thread_count_) {
+    if (thread_count_ <= 0)
+        { thread_count_ = std::max(1, int(std::thread::hardware_concurrency())); }
+    m_workers.reserve(std::size_t(thread_count_ - 1));
+    for (int i = 1; i < thread_count_; ++i)
+        { m_workers.emplace_back([this, i] { work(i); }); }
+}
+
+inline GridThreadPool::~GridThreadPool() {
+    {
+    std::lock_guard lock{m_mutex};
+    m_stopping = true;
+    }
+    m_job_posted.notify_all();
+    for (auto & worker : m_workers)
+        { worker.join(); }
+}
+
+/* static */ inline GridThreadPool & GridThreadPool::default_instance() {
+    static GridThreadPool s_pool;
+    return s_pool;
+}
+
+template <typename Func>
+void GridThreadPool::run
+    (std::size_t task_count, bool deterministic, Func && f)
+{
+    if (task_count == 0) return;
+    if (is_in_task() || thread_count() == 1 || task_count == 1) {
+        for (std::size_t task = 0; task != task_count; ++task)
+            { f(task); }
+        return;
+    }
+
+    const auto threads = std::size_t(thread_count());
+    std::atomic_size_t next_task = 0;
+    std::atomic_bool failed = false;
+    std::exception_ptr error;
+    std::mutex error_mutex;
+    Job job = [&] (int worker_index) {
+        is_in_task() = true;
+        try {
+            if (deterministic) {
+                for (auto task = std::size_t(worker_index);
+                     task < task_count && !failed; task += threads)
+                { f(task); }
+            } else {
+                for (auto task = next_task++; task < task_count && !failed;
+                     task = next_task++)
+                { f(task); }
+            }
+        } catch (...) {
+            std::lock_guard lock{error_mutex};
+            if (!error) error = std::current_exception();
+            failed = true;
+        }
+        is_in_task() = false;
+    };
+    run_job(job);
+    if (error)
+        { std::rethrow_exception(error); }
+}
+
+/* private static */ inline bool & GridThreadPool::is_in_task() noexcept {
+    thread_local bool s_in_task = false;
+    return s_in_task;
+}
+
+/* private */ inline void GridThreadPool::run_job(const Job & job) {
+    std::lock_guard run_lock{m_run_mutex};
+    {
+    std::lock_guard lock{m_mutex};
+    m_job = &job;
+    m_unfinished = int(m_workers.size());
+    ++m_generation;
+    }
+    m_job_posted.notify_all();
+    job(0);
+    std::unique_lock lock{m_mutex};
+    m_job_finished.wait(lock, [this] { return m_unfinished == 0; });
+    m_job = nullptr;
+}
+
+/* private */ inline void GridThreadPool::work(int worker_index) {
+    std::size_t seen_generation = 0;
+    while (true) {
+        const Job * job = nullptr;
+        {
+        std::unique_lock lock{m_mutex};
+        m_job_posted.wait(lock, [this, seen_generation]
+            { return m_stopping || m_generation != seen_generation; });
+        if (m_stopping) return;
+        seen_generation = m_generation;
+        job = m_job;
+        }
+        (*job)(worker_index);
+        std::lock_guard lock{m_mutex};
+        if (--m_unfinished == 0)
+            { m_job_finished.notify_one(); }
+    }
+}
+
+template <typename GridType, typename Func>
+void parallel_for_each_cell
+    (GridType && grid, Func && f, const ParallelGridOptions & options)
+{
+    detail::for_each_row_band(grid.width(), grid.height(), options,
+        [&grid, &f, width = grid.width()] (int y_begin, int y_end)
+    {
+        for (int y = y_begin; y != y_end; ++y) {
+            for (int x = 0; x != width; ++x)
+                { detail::call_with_cell(f, x, y, detail::parallel_grid_cell(grid, x, y)); }
+        }
+    });
+}
+
+template <typename SourceGridType, typename DestinationGridType, typename Func>
+void parallel_transform
+    (const SourceGridType & source, DestinationGridType && destination, Func && f,
+     const ParallelGridOptions & options)
+{
+    if (   source.width () != destination.width ()
+        || source.height() != destination.height())
+    {
+        throw std::invalid_argument("parallel_transform: source and "
+                                    "destination must be the same size.");
+    }
+    detail::for_each_row_band(source.width(), source.height(), options,
+        [&source, &destination, &f, width = source.width()]
+        (int y_begin, int y_end)
+    {
+        for (int y = y_begin; y != y_end; ++y) {
+            for (int x = 0; x != width; ++x) {
+                detail::parallel_grid_cell(destination, x, y) =
+                    detail::call_with_cell(f, x, y, detail::parallel_grid_cell(source, x, y));
+            }
+        }
+    });
+}
+
+#endif // ifndef DOXYGEN_SHOULD_SKIP_THIS
+
+} // end of cul namespace
@@ -0,0 +1,358 @@
+/****************************************************************************
+
+    MIT License
+
+    Copyright (c) 2021 Aria Janke
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+
+*****************************************************************************/
+
+
+#pragma once
+
+#include <ariajanke/cul/Grid.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <memory>
+
+namespace cul {
+
+/** An immutable copy of a SnapshotGrid, as it was when the snapshot was
+ *  taken. It shares chunks with its grid (and other snapshots), so is cheap
+ *  to take, copy and keep; and may be read from any thread, while its grid
+ *  goes on being written to on another.
+ */
+template <typename T, int kt_chunk_size = 32>
+class GridSnapshot final {
+public:
+    using Element            = T;
+    using Chunk              = Grid<T>;
+    using ConstReferenceType = typename Chunk::ConstReferenceType;
+    using Vector             = Vector2<int>;
+    using Size               = Size2<int>;
+
+    static constexpr const int k_chunk_size = kt_chunk_size;
+
+    GridSnapshot() {}
+
+    /** Constructor specific for SnapshotGrid, use its snapshot function
+     *  instead.
+     */
+    GridSnapshot(std::vector<std::shared_ptr<const Chunk>> && chunks,
+                 Size size_, int chunks_across):
+        m_chunks(std::move(chunks)), m_size(size_),
+        m_chunks_across(chunks_across) {}
+
+    int width() const noexcept { return m_size.width; }
+
+    int height() const noexcept { return m_size.height; }
+
+    Size size2() const noexcept { return m_size; }
+
+    bool has_position(int x, int y) const noexcept
+        { return x >= 0 && y >= 0 && x < width() && y < height(); }
+
+    bool has_position(const Vector & r) const noexcept
+        { return has_position(r.x, r.y); }
+
+    /** @throws std::out_of_range if position is outside of the grid */
+    ConstReferenceType operator () (int x, int y) const;
+
+    ConstReferenceType operator () (const Vector & r) const
+        { return (*this)(r.x, r.y); }
+
+    /** @returns element at the given position, which must be inside the
+     *           grid (this is only asserted)
+     */
+    ConstReferenceType element_unchecked(int x, int y) const noexcept {
+        assert(has_position(x, y));
+        auto index = std::size_t(x / kt_chunk_size + (y / kt_chunk_size)*m_chunks_across);
+        return m_chunks[index]->element_unchecked(x % kt_chunk_size, y % kt_chunk_size);
+    }
+
+    /** Calls f with the position of every chunk's first element, and the
+     *  chunk (chunks at the right and bottom edges are clipped to the grid).
+     */
+    template <typename Func>
+    void for_each_chunk(Func && f) const;
+
+    /** @returns a copy of every element, in a Grid */
+    Grid<T> to_grid() const;
+
+private:
+    std::vector<std::shared_ptr<const Chunk>> m_chunks;
+    Size m_size;
+    int m_chunks_across = 0;
+};
+
+/** A two dimensional container, kept in square Grid chunks, from which
+ *  immutable snapshots may be taken in time proportional to the number of
+ *  chunks (rather than elements).
+ *
+ *  Snapshots share chunks with their grid. Writing to a chunk shared with
+ *  any snapshot first copies it (copy on write); so only chunks written to
+ *  since the last snapshot are ever copied.
+ *
+ *  A grid itself should only be used by one thread at a time, snapshots may
+ *  then be handed to and read by any number of others.
+ */
+template <typename T, int kt_chunk_size = 32>
+class SnapshotGrid final {
+public:
+    static_assert(kt_chunk_size > 0, "Chunk size must be positive.");
+
+    using Element            = T;
+    using Chunk              = Grid<T>;
+    using ReferenceType      = typename Chunk::ReferenceType;
+    using ConstReferenceType = typename Chunk::ConstReferenceType;
+    using Vector             = Vector2<int>;
+    using Size               = Size2<int>;
+    using Snapshot           = GridSnapshot<T, kt_chunk_size>;
+
+    static constexpr const int k_chunk_size = kt_chunk_size;
+
+    SnapshotGrid() {}
+
+    /** @throws std::invalid_argument if either dimension is negative */
+    SnapshotGrid(int width, int height, const Element & = Element{});
+
+    /** Copies all elements of a grid, to the same positions. */
+    explicit SnapshotGrid(const Grid<T> &);
+
+    int width() const noexcept { return m_size.width; }
+
+    int height() const noexcept { return m_size.height; }
+
+    Size size2() const noexcept { return m_size; }
+
+    bool has_position(int x, int y) const noexcept
+        { return x >= 0 && y >= 0 && x < width() && y < height(); }
+
+    bool has_position(const Vector & r) const noexcept
+        { return has_position(r.x, r.y); }
+
+    /** @returns element at the given position, first copying its chunk if
+     *           any snapshot shares it
+     *  @throws std::out_of_range if position is outside of the grid
+     */
+    ReferenceType operator () (int x, int y);
+
+    ReferenceType operator () (const Vector & r)
+        { return (*this)(r.x, r.y); }
+
+    /** @throws std::out_of_range if position is outside of the grid */
+    ConstReferenceType operator () (int x, int y) const;
+
+    ConstReferenceType operator () (const Vector & r) const
+        { return (*this)(r.x, r.y); }
+
+    /** @returns element at the given position, which must be inside the
+     *           grid (this is only asserted); its chunk is copied first if
+     *           any snapshot shares it
+     */
+    ReferenceType element_unchecked(int x, int y) {
+        assert(has_position(x, y));
+        return writable_chunk(x / kt_chunk_size, y / kt_chunk_size)
+            .element_unchecked(x % kt_chunk_size, y % kt_chunk_size);
+    }
+
+    /** @copydoc SnapshotGrid::element_unchecked(int,int) */
+    ConstReferenceType element_unchecked(int x, int y) const noexcept {
+        assert(has_position(x, y));
+        return chunk_at(x / kt_chunk_size, y / kt_chunk_size)
+            .element_unchecked(x % kt_chunk_size, y % kt_chunk_size);
+    }
+
+    /** @returns an immutable copy of this grid, sharing all of its chunks */
+    Snapshot snapshot() const;
+
+    /** @returns number of chunks shared with at least one snapshot */
+    std::size_t shared_chunk_count() const noexcept;
+
+    /** @returns a copy of every element, in a Grid */
+    Grid<T> to_grid() const { return snapshot().to_grid(); }
+
+    void swap(SnapshotGrid &) noexcept;
+
+private:
+    using ChunkPointer = std::shared_ptr<Chunk>;
+
+    static int chunks_for(int length) noexcept
+        { return (length + kt_chunk_size - 1) / kt_chunk_size; }
+
+    const Chunk & chunk_at(int chunk_x, int chunk_y) const noexcept
+        { return *m_chunks[std::size_t(chunk_x + chunk_y*m_chunks_across)]; }
+
+    Chunk & writable_chunk(int chunk_x, int chunk_y);
+
+    std::out_of_range make_out_of_range_error(const char * caller) const;
+
+    std::vector<ChunkPointer> m_chunks;
+    Size m_size;
+    int m_chunks_across = 0;
+};
+
+// ----------------------------------------------------------------------------
+
+#ifndef DOXYGEN_SHOULD_SKIP_THIS
+
+template <typename T, int kt_chunk_size>
+typename GridSnapshot<T, kt_chunk_size>::ConstReferenceType
+    GridSnapshot<T, kt_chunk_size>::operator () (int x, int y) const
+{
+    if (!has_position(x, y)) {
+        throw std::out_of_range("GridSnapshot::operator(): requested "
+                                "position is out of range, size: width "
+                                + std::to_string(width()) + " height "
+                                + std::to_string(height()));
+    }
+    return element_unchecked(x, y);
+}
+
+template <typename T, int kt_chunk_size>
+template <typename Func>
+void GridSnapshot<T, kt_chunk_size>::for_each_chunk(Func && f) const {
+    for (std::size_t i = 0; i != m_chunks.size(); ++i) {
+        Vector origin{int(i % std::size_t(m_chunks_across))*kt_chunk_size,
+                      int(i / std::size_t(m_chunks_across))*kt_chunk_size};
+        f(origin, static_cast<const Chunk &>(*m_chunks[i]));
+    }
+}
+
+template <typename T, int kt_chunk_size>
+Grid<T> GridSnapshot<T, kt_chunk_size>::to_grid() const {
+    Grid<T> rv;
+    rv.set_size(width(), height());
+    for_each_chunk([&rv] (const Vector & origin, const Chunk & chunk) {
+        for (int y = 0; y != chunk.height(); ++y) {
+            for (int x = 0; x != chunk.width(); ++x) {
+                rv.element_unchecked(origin.x + x, origin.y + y) =
+                    chunk.element_unchecked(x, y);
+            }
+        }
+    });
+    return rv;
+}
+
+// ----------------------------------------------------------------------------
+
+template <typename T, int kt_chunk_size>
+SnapshotGrid<T, kt_chunk_size>::SnapshotGrid
+    (int width_, int height_, const Element & el)
+{
+    if (width_ < 0 || height_ < 0) {
+        throw std::invalid_argument("SnapshotGrid::SnapshotGrid: both "
+                                    "dimensions must be non-negative "
+                                    "integers.");
+    }
+    m_size = Size{width_, height_};
+    m_chunks_across = chunks_for(width_);
+    const int chunks_down = chunks_for(height_);
+    m_chunks.reserve(std::size_t(m_chunks_across)*std::size_t(chunks_down));
+    for (int cy = 0; cy != chunks_down; ++cy) {
+        for (int cx = 0; cx != m_chunks_across; ++cx) {
+            auto chunk = std::make_shared<Chunk>();
+            chunk->set_size(std::min(kt_chunk_size, width_  - cx*kt_chunk_size),
+                            std::min(kt_chunk_size, height_ - cy*kt_chunk_size),
+                            el);
+            m_chunks.emplace_back(std::move(chunk));
+        }
+    }
+}
+
+template <typename T, int kt_chunk_size>
+SnapshotGrid<T, kt_chunk_size>::SnapshotGrid(const Grid<T> & grid):
+    SnapshotGrid(grid.width(), grid.height())
+{
+    for (int y = 0; y != height(); ++y) {
+        for (int x = 0; x != width(); ++x)
+            { element_unchecked(x, y) = grid.element_unchecked(x, y); }
+    }
+}
+
+template <typename T, int kt_chunk_size>
+typename SnapshotGrid<T, kt_chunk_size>::ReferenceType
+    SnapshotGrid<T, kt_chunk_size>::operator () (int x, int y)
+{
+    if (!has_position(x, y)) throw make_out_of_range_error("operator()");
+    return element_unchecked(x, y);
+}
+
+template <typename T, int kt_chunk_size>
+typename SnapshotGrid<T, kt_chunk_size>::ConstReferenceType
+    SnapshotGrid<T, kt_chunk_size>::operator () (int x, int y) const
+{
+    if (!has_position(x, y)) throw make_out_of_range_error("operator()");
+    return element_unchecked(x, y);
+}
+
+template <typename T, int kt_chunk_size>
+typename SnapshotGrid<T, kt_chunk_size>::Snapshot
+    SnapshotGrid<T, kt_chunk_size>::snapshot() const
+{
+    return Snapshot{std::vector<std::shared_ptr<const Chunk>>
+                        {m_chunks.begin(), m_chunks.end()},
+                    m_size, m_chunks_across};
+}
+
+template <typename T, int kt_chunk_size>
+std::size_t SnapshotGrid<T, kt_chunk_size>::shared_chunk_count() const noexcept {
+    return std::size_t(std::count_if(m_chunks.begin(), m_chunks.end(),
+        [] (const ChunkPointer & ptr) { return ptr.use_count() > 1; }));
+}
+
+template <typename T, int kt_chunk_size>
+void SnapshotGrid<T, kt_chunk_size>::swap(SnapshotGrid & rhs) noexcept {
+    m_chunks.swap(rhs.m_chunks);
+    std::swap(m_size, rhs.m_size);
+    std::swap(m_chunks_across, rhs.m_chunks_across);
+}
+
+template <typename T, int kt_chunk_size>
+/* private */ typename SnapshotGrid<T, kt_chunk_size>::Chunk &
+    SnapshotGrid<T, kt_chunk_size>::writable_chunk(int chunk_x, int chunk_y)
+{
+    auto & ptr = m_chunks[std::size_t(chunk_x + chunk_y*m_chunks_across)];
+    // Only this grid makes new owners of its chunks, so a count of one
+    // cannot rise again from another thread. The fence pairs with the
+    // release of the last snapshot's reference, so that its reads happen
+    // before any writes made here.
+    if (ptr.use_count() == 1) {
+        std::atomic_thread_fence(std::memory_order_acquire);
+    } else {
+        ptr = std::make_shared<Chunk>(*ptr);
+    }
+    return *ptr;
+}
+
+template <typename T, int kt_chunk_size>
+/* private */ std::out_of_range SnapshotGrid<T, kt_chunk_size>::
+    make_out_of_range_error(const char * caller) const
+{
+    return std::out_of_range("SnapshotGrid::" + std::string(caller) + ": "
+                             "requested position is out of range, size: width "
+                             + std::to_string(width()) + " height "
+                             + std::to_string(height()));
+}
+
+#endif // ifndef DOXYGEN_SHOULD_SKIP_THIS
+
+} // end of cul namespace
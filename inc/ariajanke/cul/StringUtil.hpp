@@ -30,8 +30,11 @@
 #include <utility>
 #include <functional>
 #include <limits>
+#include <iterator>
+#include <vector>
 
 #include <ariajanke/cul/Util.hpp>
+#include <ariajanke/cul/detail/string-util-helpers.hpp>
 
 namespace cul {
 
@@ -111,6 +114,34 @@ void for_split(const ContainerType & cont, Func && f);
 template <auto is_tchar, typename IterType>
 void trim(IterType & beg, IterType & end);
 
+/** @brief A seperator (or trim character) classifier, which is true for any
+ *         of the given characters.
+ */
+template <char... kt_chars>
+constexpr bool is_any_of(char c) noexcept
+    { return detail::ByteSetSearch<kt_chars...>::contains(c); }
+
+/** @brief Behaves exactly like for_split<is_any_of<kt_seperators...>>, for
+ *         contiguous characters only.
+ *  Seperators are searched for 16 or 32 bytes at a time, where SSE2 or AVX2
+ *  is available; which makes splitting long texts far faster.
+ */
+template <char... kt_seperators, typename Func>
+void for_split_any_of(const char * beg, const char * end, Func && f);
+
+/** @brief Container version of for_split_any_of, for any container with
+ *         contiguous characters (like std::string and std::string_view).
+ */
+template <char... kt_seperators, typename ContainerType, typename Func>
+void for_split_any_of(const ContainerType & cont, Func && f);
+
+/** @brief Behaves exactly like trim<is_any_of<kt_chars...>>, for contiguous
+ *         characters only, searching many bytes at a time as
+ *         for_split_any_of does.
+ */
+template <char... kt_chars>
+void trim_any_of(const char *& beg, const char *& end);
+
 /** @brief Converts a string to a number, assuming that it's negative for 
  *         signed types. (Useful for integers)
  *  @note this will assume the string has been stripped of its sign, as such
@@ -123,6 +154,9 @@ void trim(IterType & beg, IterType & end);
  *  @param k_base numeric base of conversion, numeric characters that fall 
  *         outside of this base will cause the conversion to fail
  *  @returns true if conversion succeeds, false otherwise
+ *  @note float and double in base 10 are correctly rounded, and may have an
+ *        exponent (e.g. "1.5e-3"), a value too large to be finite fails
+ *        conversion (this is a linked feature)
  */
 template <typename IterType, typename RealType>
 typename EnableStrToNum<IterType, RealType>::type
@@ -171,6 +205,49 @@ typename EnableStrToNum<decltype(std::begin(ContType())), RealType>::type
     (const ContType & cont, RealType & out, const int k_base = 10) noexcept
 { return string_to_number(std::begin(cont), std::end(cont), out, k_base); }
 
+/** @brief Result of parse_numbers: how many numbers were written, and where
+ *         parsing stopped.
+ */
+struct ParseNumbersResult final {
+    std::size_t count = 0;
+    /** beginning of the first token which could not be converted (or had no
+     *  room left to be written), or the end of the text if all were written
+     */
+    const char * error_position = nullptr;
+};
+
+/** @brief Converts each number, in text delimited by any of the given
+ *         seperators, writing them to an output iterator.
+ *  Splitting (as for_split_any_of), trimming whitespace (space, tab, return
+ *  carriage and newline) from each token, and conversion (as
+ *  string_to_number in base 10) are all done in one pass. Parsing stops at
+ *  the first token which fails conversion.
+ *  @note like for_split, runs of seperators produce no empty tokens; so
+ *        multiline text only needs '\n' among its seperators
+ *  @tparam T numeric type to convert each token to
+ */
+template <typename T, char... kt_seperators, typename OutputIterator>
+ParseNumbersResult parse_numbers
+    (const char * beg, const char * end, OutputIterator out);
+
+/** @brief Bounded version of parse_numbers, writing no further than out_end.
+ *  A token found with no room left to write it, is treated as an error
+ *  (e.g. filling a grid row:
+ *  parse_numbers<int, ','>(beg, end, row.begin(), row.end()); where the
+ *  count should then equal the row's size).
+ */
+template <typename T, char... kt_seperators, typename OutputIterator>
+ParseNumbersResult parse_numbers
+    (const char * beg, const char * end, OutputIterator out,
+     OutputIterator out_end);
+
+/** @brief Container version of parse_numbers, for any container with
+ *         contiguous characters (like std::string and std::string_view).
+ */
+template <typename T, char... kt_seperators, typename ContainerType,
+          typename OutputIterator>
+ParseNumbersResult parse_numbers(const ContainerType & cont, OutputIterator out);
+
 /** @brief Wraps text as if it were monowidth by a set number of characters.
  *  @note Like all features in this library, this was added because it is used
  *        by multiple projects.
@@ -202,6 +279,102 @@ void wrap_string_as_monowidth
     (IterType beg, IterType end, int max_chars,
      HandleSequenceFunc && handle_seq);
 
+/** @brief Wraps a growing text (like a log or console's scrollback) as
+ *         wrap_string_as_monowidth does, one paragraph (newline seperated
+ *         line) at a time, which need only be wrapped as they're visited.
+ *
+ *  Text is appended in chunks of any size. Each paragraph keeps the breaks
+ *  it was last wrapped with; so when the width changes, only paragraphs that
+ *  are visited afterward (e.g. those on screen, plus some lookahead) are
+ *  wrapped again, rather than the whole text.
+ *  @note whitespace characters are breaking (as for the four parameter
+ *        overload of wrap_string_as_monowidth), newlines are not part of any
+ *        wrapped line
+ */
+class IncrementalMonowidthWrapper final {
+public:
+    /** A wrapped line, by its paragraph and line within that paragraph. */
+    struct Position final {
+        Position() {}
+        Position(std::size_t paragraph_, int line_):
+            paragraph(paragraph_), line(line_) {}
+
+        std::size_t paragraph = 0;
+        int line = 0;
+    };
+
+    /** @throws std::invalid_argument if max_chars is not positive */
+    explicit IncrementalMonowidthWrapper(int max_chars_);
+
+    /** Appends a chunk of text, which may end or begin mid-paragraph. */
+    void append(const char * beg, const char * end);
+
+    void append(const std::string & str)
+        { append(str.data(), str.data() + str.size()); }
+
+    /** Changes the width lines are wrapped to, no paragraph is wrapped until
+     *  it is next visited.
+     *  @throws std::invalid_argument if max_chars is not positive
+     */
+    void set_max_chars(int max_chars_);
+
+    int max_chars() const noexcept { return m_max_chars; }
+
+    /** @returns number of paragraphs, which is always at least one (the last
+     *           being empty, if the text ends with a newline)
+     */
+    std::size_t paragraph_count() const noexcept { return m_paragraphs.size(); }
+
+    /** @returns number of lines the given paragraph wraps to (wrapping it
+     *           if needed)
+     *  @throws std::out_of_range if there is no such paragraph
+     */
+    int line_count_of(std::size_t paragraph);
+
+    /** @returns position line_delta lines (which may be negative) away, kept
+     *           within the text; every paragraph passed over is wrapped
+     *  @note a position's line is clamped to its paragraph, as it may have
+     *        fewer lines after a width change
+     */
+    Position advance(Position pos, int line_delta);
+
+    /** Calls f for each of up to line_count lines, starting from the given
+     *  position; only the paragraphs these lines are in are wrapped.
+     *  @param f must take the form: void(const char * beg, const char * end)
+     *           and may return a flow control signal (as for_split)
+     *  @returns position after the last line visited, or the paragraph count
+     *           (as the paragraph) if the end of the text was reached
+     */
+    template <typename Func>
+    Position for_each_line(Position from, int line_count, Func && f);
+
+    /** @returns all text appended so far */
+    const std::string & text() const noexcept { return m_text; }
+
+private:
+    struct Paragraph final {
+        std::size_t begin = 0;
+        // one past the last character (newlines excluded)
+        std::size_t end = 0;
+        // max_chars that line_ends was found for, zero if never wrapped
+        int wrapped_at = 0;
+        // offsets (from begin) where each line ends, save the last
+        std::vector<std::size_t> line_ends;
+    };
+
+    const Paragraph & wrapped_paragraph(std::size_t paragraph);
+
+    Position clamp_position(Position pos);
+
+    std::pair<const char *, const char *> line_at(Position pos);
+
+    static void verify_max_chars(int max_chars_, const char * caller);
+
+    std::string m_text;
+    std::vector<Paragraph> m_paragraphs = std::vector<Paragraph>(1);
+    int m_max_chars;
+};
+
 /** @brief Finds the end of a constant expression string.
  *  @note  A constexpr utility meant to replace uses of "strlen".
  */
@@ -263,6 +436,40 @@ void trim(IterType & beg, IterType & end) {
 
 // ----------------------------------------------------------------------------
 
+template <char... kt_seperators, typename Func>
+void for_split_any_of(const char * beg, const char * end, Func && f) {
+    using namespace fc_signal;
+    using Search = detail::ByteSetSearch<kt_seperators...>;
+    while (true) {
+        const char * last = Search::find_first_not_of(beg, end);
+        if (last == end) return;
+        const char * itr = Search::find_first_of(last, end);
+        if (itr == end) {
+            // last call ignores any possible return value
+            (void)f(last, end);
+            return;
+        }
+        if (adapt_to_flow_control_signal(std::move(f), last, itr) == k_break)
+            return;
+        beg = itr;
+    }
+}
+
+template <char... kt_seperators, typename ContainerType, typename Func>
+void for_split_any_of(const ContainerType & cont, Func && f) {
+    const char * beg = std::data(cont);
+    for_split_any_of<kt_seperators...>(beg, beg + std::size(cont), std::move(f));
+}
+
+template <char... kt_chars>
+void trim_any_of(const char *& beg, const char *& end) {
+    using Search = detail::ByteSetSearch<kt_chars...>;
+    beg = Search::find_first_not_of(beg, end);
+    end = Search::find_end_of_last_not_of(beg, end);
+}
+
+// ----------------------------------------------------------------------------
+
 template <typename IterType, typename RealType>
 typename EnableStrToNum<IterType, RealType>::type
 /* bool */ string_to_number_assume_negative
@@ -277,6 +484,32 @@ typename EnableStrToNum<IterType, RealType>::type
 #       endif
     }
 
+    if constexpr (detail::k_has_float_fast_path<RealType>) {
+        if (k_base == 10) {
+            RealType magnitude;
+            if (!detail::read_decimal_float(begin, end, magnitude))
+                { return false; }
+            out = -magnitude;
+            return true;
+        }
+    }
+
+    if constexpr (detail::k_has_integer_fast_path<IterType, RealType>) {
+        if ((k_base == 10 || k_base == 16) && begin != end) {
+            // contiguous chars only, a dot is left to the general case below
+            const char * beg_ptr = &*begin;
+            std::uint64_t magnitude = 0;
+            switch (detail::read_integer_magnitude
+                (beg_ptr, beg_ptr + (end - begin), k_base, magnitude))
+            {
+            case detail::IntegerReadResult::not_a_number: return false;
+            case detail::IntegerReadResult::has_dot: break;
+            case detail::IntegerReadResult::read:
+                return detail::integer_magnitude_to_number(magnitude, out);
+            }
+        }
+    }
+
     using CharType = typename std::remove_reference<decltype(*begin)>::type;
     static constexpr bool k_is_signed = std::is_signed<RealType>::value;
     static constexpr bool k_is_integer = !std::is_floating_point<RealType>::value;
@@ -413,6 +646,64 @@ typename EnableStrToNum<IterType, RealType>::type
 
 // ----------------------------------------------------------------------------
 
+class ParseNumbersPriv {
+public:
+    template <typename T, char... kt_seperators, typename OutputIterator,
+              typename HasRoomFunc>
+    static ParseNumbersResult parse_numbers
+        (const char * beg, const char * end, OutputIterator out,
+         HasRoomFunc && has_room)
+    {
+        using Seperators = detail::ByteSetSearch<kt_seperators...>;
+        using Whitespace = detail::ByteSetSearch<' ', '\t', '\r', '\n'>;
+        using Skipped    = detail::ByteSetSearch<kt_seperators..., ' ', '\t', '\r', '\n'>;
+        ParseNumbersResult rv;
+        while (true) {
+            beg = Skipped::find_first_not_of(beg, end);
+            if (beg == end) break;
+            const char * token_end  = Seperators::find_first_of(beg, end);
+            const char * number_end = Whitespace::find_end_of_last_not_of(beg, token_end);
+            T number;
+            if (!has_room(out) || !string_to_number(beg, number_end, number)) {
+                rv.error_position = beg;
+                return rv;
+            }
+            *out++ = number;
+            ++rv.count;
+            beg = token_end;
+        }
+        rv.error_position = end;
+        return rv;
+    }
+};
+
+template <typename T, char... kt_seperators, typename OutputIterator>
+ParseNumbersResult parse_numbers
+    (const char * beg, const char * end, OutputIterator out)
+{
+    return ParseNumbersPriv::parse_numbers<T, kt_seperators...>
+        (beg, end, std::move(out), [] (const OutputIterator &) { return true; });
+}
+
+template <typename T, char... kt_seperators, typename OutputIterator>
+ParseNumbersResult parse_numbers
+    (const char * beg, const char * end, OutputIterator out,
+     OutputIterator out_end)
+{
+    return ParseNumbersPriv::parse_numbers<T, kt_seperators...>
+        (beg, end, std::move(out),
+         [&out_end] (const OutputIterator & itr) { return itr != out_end; });
+}
+
+template <typename T, char... kt_seperators, typename ContainerType,
+          typename OutputIterator>
+ParseNumbersResult parse_numbers(const ContainerType & cont, OutputIterator out) {
+    const char * beg = std::data(cont);
+    return parse_numbers<T, kt_seperators...>(beg, beg + std::size(cont), std::move(out));
+}
+
+// ----------------------------------------------------------------------------
+
 class WrapStringAsMonowidthPriv {
 public:
     template <typename IterType, typename HandleSequenceFunc, typename IsBreakingFunc>
@@ -484,6 +775,28 @@ void wrap_string_as_monowidth
                                 c == CharType('\t') || c == CharType('\r'); });
 }
 
+// ----------------------------------------------------------------------------
+
+template <typename Func>
+IncrementalMonowidthWrapper::Position
+    IncrementalMonowidthWrapper::for_each_line
+    (Position from, int line_count, Func && f)
+{
+    using namespace fc_signal;
+    if (from.paragraph >= m_paragraphs.size()) return Position{m_paragraphs.size(), 0};
+    Position pos = clamp_position(from);
+    for (; line_count > 0; --line_count) {
+        auto line = line_at(pos);
+        if (++pos.line == line_count_of(pos.paragraph)) {
+            pos = Position{pos.paragraph + 1, 0};
+        }
+        if (adapt_to_flow_control_signal(f, line.first, line.second) == k_break)
+            { break; }
+        if (pos.paragraph == m_paragraphs.size()) break;
+    }
+    return pos;
+}
+
 #endif // ifndef DOXYGEN_SHOULD_SKIP_THIS
 
 } // end of cul namespace
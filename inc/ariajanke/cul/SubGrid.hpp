@@ -64,6 +64,8 @@ public:
     using ConstIterator   = SubGridIteratorImpl<true, T>;
     using Vector          = typename Grid<T>::Vector;
     using Size            = typename Grid<T>::Size;
+    using Row             = GridRow<std::conditional_t<k_is_const_t, const T, T>>;
+    using ConstRow        = GridRow<const T>;
 
     static constexpr const bool k_is_const = k_is_const_t;
 
@@ -128,6 +130,33 @@ public:
 
     ConstReference operator () (int x, int y) const { return element(x, y); }
 
+    /** @returns element at the given position, which must be inside the
+     *           sub grid (this is only asserted, nothing is thrown)
+     */
+    template <bool k_is_const_ = k_is_const_t>
+    typename std::enable_if_t<!k_is_const_, Reference>
+        element_unchecked(int x, int y) noexcept
+    {
+        assert(has_position(x, y));
+        return m_parent->element_unchecked(x + m_offset.x, y + m_offset.y);
+    }
+
+    /** @copydoc SubGridImpl::element_unchecked(int,int) */
+    ConstReference element_unchecked(int x, int y) const noexcept {
+        assert(has_position(x, y));
+        return m_parent->element_unchecked(x + m_offset.x, y + m_offset.y);
+    }
+
+    /** @returns the part of row y inside this sub grid, which is contiguous
+     *           (so copies may be done with std::copy or memcpy)
+     *  @throws if y is not a row of the sub grid
+     */
+    template <bool k_is_const_ = k_is_const_t>
+    typename std::enable_if_t<!k_is_const_, Row> row(int y);
+
+    /** @copydoc SubGridImpl::row(int) */
+    ConstRow row(int y) const;
+
     /** @returns total number of elements on the sub grid.
      *  @note not to be confused as returning a data structure describing both
      *        width and height
@@ -196,7 +225,7 @@ private:
         element(int x, int y)
     {
         verify_position_ok(x, y);
-        return (*m_parent)(x + m_offset.x, y + m_offset.y);
+        return m_parent->element_unchecked(x + m_offset.x, y + m_offset.y);
     }
 
     ConstReference element(int x, int y) const;
@@ -501,13 +530,23 @@ public:
 
     SubGridIteratorImpl & operator = (SubGridIteratorImpl &&) = delete;
 
-    SubGridIteratorImpl & operator ++ () { return move_position(1); }
+    /** Moves by pointer arithmetic, only jumping at the ends of rows. */
+    SubGridIteratorImpl & operator ++ ();
 
-    SubGridIteratorImpl operator ++ (int) { return move_post(1); }
+    SubGridIteratorImpl operator ++ (int) {
+        auto t = *this;
+        ++(*this);
+        return t;
+    }
 
-    SubGridIteratorImpl & operator -- () { return move_position(-1); }
+    /** @copydoc SubGridIteratorImpl::operator++() */
+    SubGridIteratorImpl & operator -- ();
 
-    SubGridIteratorImpl operator -- (int) { return move_post(-1); }
+    SubGridIteratorImpl operator -- (int) {
+        auto t = *this;
+        --(*this);
+        return t;
+    }
 
     Pointer operator -> () const noexcept { return m_ptr; }
 
@@ -702,12 +741,32 @@ typename SubGridImpl<k_is_const_t, T>::ConstIterator
     return ConstIterator(m_parent, end_ptr(), m_width, 0);
 }
 
+template <bool k_is_const_t, typename T>
+template <bool k_is_const_>
+typename std::enable_if_t<!k_is_const_, typename SubGridImpl<k_is_const_t, T>::Row>
+    SubGridImpl<k_is_const_t, T>::row(int y)
+{
+    verify_position_ok(0, y);
+    return Row{&m_parent->element_unchecked(m_offset.x, y + m_offset.y),
+               std::size_t(m_width)};
+}
+
+template <bool k_is_const_t, typename T>
+typename SubGridImpl<k_is_const_t, T>::ConstRow
+    SubGridImpl<k_is_const_t, T>::row(int y) const
+{
+    verify_position_ok(0, y);
+    return ConstRow{&m_parent->element_unchecked(m_offset.x, y + m_offset.y),
+                    std::size_t(m_width)};
+}
+
 template <bool k_is_const_t, typename T>
 typename SubGridImpl<k_is_const_t, T>::ConstReference
     SubGridImpl<k_is_const_t, T>::element(int x, int y) const
 {
+    // positions inside the sub grid are always inside the parent
     verify_position_ok(x, y);
-    return (*m_parent)(x + m_offset.x, y + m_offset.y);
+    return m_parent->element_unchecked(x + m_offset.x, y + m_offset.y);
 }
 
 template <bool k_is_const_t, typename T>
@@ -800,6 +859,38 @@ SubGridIteratorImpl<k_is_const_t, T>::SubGridIteratorImpl
     m_row_jump(rhs.m_row_jump)
 {}
 
+template <bool k_is_const_t, typename T>
+SubGridIteratorImpl<k_is_const_t, T> &
+    SubGridIteratorImpl<k_is_const_t, T>::operator ++ ()
+{
+    if (m_row_size == k_no_size)
+        { verify_can_move_position("operator++"); }
+    if (++m_row_pos != m_row_size) {
+        ++m_ptr;
+    } else {
+        // from the end of one row, to the start of the next
+        m_ptr += m_row_jump - m_row_size + 1;
+        m_row_pos = 0;
+    }
+    return *this;
+}
+
+template <bool k_is_const_t, typename T>
+SubGridIteratorImpl<k_is_const_t, T> &
+    SubGridIteratorImpl<k_is_const_t, T>::operator -- ()
+{
+    if (m_row_size == k_no_size)
+        { verify_can_move_position("operator--"); }
+    if (m_row_pos != 0) {
+        --m_ptr;
+        --m_row_pos;
+    } else {
+        m_ptr -= m_row_jump - m_row_size + 1;
+        m_row_pos = m_row_size - 1;
+    }
+    return *this;
+}
+
 template <bool k_is_const_t, typename T>
 /* private */ bool SubGridIteratorImpl<k_is_const_t, T>::is_same
     (const SubGridIteratorImpl & rhs) const noexcept
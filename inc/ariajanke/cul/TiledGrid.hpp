@@ -0,0 +1,391 @@
+/****************************************************************************
+
+    MIT License
+
+    Copyright (c) 2021 Aria Janke
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+
+*****************************************************************************/
+
+
+#pragma once
+
+#include <ariajanke/cul/Grid.hpp>
+
+namespace cul {
+
+/** One square tile of a TiledGrid (clipped at the grid's right and bottom
+ *  edges). A tile's rows are contiguous, and its elements are all close
+ *  together in memory.
+ *
+ *  Positions given to a tile are relative to its origin.
+ */
+template <typename T>
+class GridTile final {
+public:
+    using Element   = std::remove_const_t<T>;
+    using Reference = T &;
+    using Vector    = Vector2<int>;
+    using Size      = Size2<int>;
+
+    GridTile() {}
+
+    /** Constructor specific for TiledGrid, use its tile functions instead.
+     *  @param data first element of the tile
+     *  @param stride distance between the starts of two rows
+     */
+    GridTile(T * data, int stride, Vector origin_, Size size_):
+        m_data(data), m_stride(stride), m_origin(origin_), m_size(size_) {}
+
+    /** @returns position of this tile's first element in the grid */
+    Vector origin() const noexcept { return m_origin; }
+
+    int width() const noexcept { return m_size.width; }
+
+    int height() const noexcept { return m_size.height; }
+
+    Size size2() const noexcept { return m_size; }
+
+    bool has_position(int x, int y) const noexcept
+        { return x >= 0 && y >= 0 && x < width() && y < height(); }
+
+    bool has_position(const Vector & r) const noexcept
+        { return has_position(r.x, r.y); }
+
+    /** @returns element at a position relative to the tile's origin, which
+     *           must be inside the tile (this is only asserted)
+     */
+    Reference operator () (int x, int y) const noexcept {
+        assert(has_position(x, y));
+        return m_data[x + y*m_stride];
+    }
+
+    Reference operator () (const Vector & r) const noexcept
+        { return (*this)(r.x, r.y); }
+
+    /** @returns row y of this tile (y must be inside the tile) */
+    GridRow<T> row(int y) const noexcept {
+        assert(y >= 0 && y < height());
+        return GridRow<T>{m_data + y*m_stride, std::size_t(width())};
+    }
+
+private:
+    T * m_data = nullptr;
+    int m_stride = 0;
+    Vector m_origin;
+    Size m_size;
+};
+
+/** A two dimensional container, with the same element access as Grid, but
+ *  which keeps elements in square tiles, one after another. Neighborhoods
+ *  (and columns) of elements then stay close together in memory, so that
+ *  stencil passes over large grids stay in cache.
+ *
+ *  Elements are default constructed to fill out tiles at the edges.
+ *
+ *  @note bool elements are not supported, as tile rows must be contiguous
+ *        (BitGrid is a better fit for those)
+ *  @tparam kt_tile_size width and height of each tile in elements, a power
+ *          of two
+ */
+template <typename T, int kt_tile_size = 16>
+class TiledGrid final {
+public:
+    static_assert(kt_tile_size > 0 && (kt_tile_size & (kt_tile_size - 1)) == 0,
+                  "Tile size must be a power of two.");
+    static_assert(!std::is_same_v<T, bool>,
+                  "TiledGrid does not support bool elements, as tile rows must "
+                  "be contiguous (consider BitGrid instead).");
+
+    using Element            = T;
+    using ReferenceType      = typename std::vector<T>::reference;
+    using ConstReferenceType = typename std::vector<T>::const_reference;
+    using IndexType          = int;
+    using Vector             = Vector2<IndexType>;
+    using Size               = Size2<IndexType>;
+    using Tile               = GridTile<T>;
+    using ConstTile          = GridTile<const T>;
+
+    static constexpr const int k_tile_size = kt_tile_size;
+
+    TiledGrid() {}
+
+    /** Copies all elements of a grid, to the same positions. */
+    explicit TiledGrid(const Grid<T> &);
+
+    int width() const noexcept { return m_size.width; }
+
+    int height() const noexcept { return m_size.height; }
+
+    Size size2() const noexcept { return m_size; }
+
+    /** @returns total number of (non-padding) elements */
+    std::size_t size() const noexcept
+        { return std::size_t(m_size.width)*std::size_t(m_size.height); }
+
+    bool is_empty() const noexcept { return size() == 0; }
+
+    /** @brief Sets grid size in number of elements
+     *
+     *  Unlike Grid, elements keep their positions, those outside of the new
+     *  size are lost, and new positions are filled with the given element.
+     */
+    void set_size(int width, int height, const Element & = Element{});
+
+    void set_size(const Size & size, const Element & el = Element{})
+        { set_size(size.width, size.height, el); }
+
+    /** @returns true if position is inside the grid */
+    bool has_position(int x, int y) const noexcept
+        { return x >= 0 && y >= 0 && x < width() && y < height(); }
+
+    /** @returns true if position is inside the grid */
+    bool has_position(const Vector & r) const noexcept
+        { return has_position(r.x, r.y); }
+
+    /** Advances the given vector to the next grid position, in the same
+     *  (row by row) order as Grid. Prefer for_each_tile where order does
+     *  not matter.
+     */
+    Vector next(const Vector &) const noexcept;
+
+    /** @returns the "one past the end" position */
+    Vector end_position() const noexcept { return Vector(0, height()); }
+
+    ReferenceType operator () (const Vector & r)
+        { return (*this)(r.x, r.y); }
+
+    ConstReferenceType operator () (const Vector & r) const
+        { return (*this)(r.x, r.y); }
+
+    ReferenceType operator () (int x, int y);
+
+    ConstReferenceType operator () (int x, int y) const;
+
+    /** @returns element at the given position, which must be inside the
+     *           grid (this is only asserted)
+     */
+    ReferenceType element_unchecked(int x, int y) noexcept {
+        assert(has_position(x, y));
+        return m_elements[to_index(x, y)];
+    }
+
+    /** @copydoc TiledGrid::element_unchecked(int,int) */
+    ConstReferenceType element_unchecked(int x, int y) const noexcept {
+        assert(has_position(x, y));
+        return m_elements[to_index(x, y)];
+    }
+
+    /** @returns number of tiles across and down */
+    Size tile_count2() const noexcept
+        { return Size{m_tiles_across, tiles_for(height())}; }
+
+    /** @returns tile at the given tile position (not element position)
+     *  @throws if there is no such tile
+     */
+    Tile tile(int tile_x, int tile_y);
+
+    /** @copydoc TiledGrid::tile(int,int) */
+    ConstTile tile(int tile_x, int tile_y) const;
+
+    /** Calls f with every tile, in memory order. */
+    template <typename Func>
+    void for_each_tile(Func && f);
+
+    /** @copydoc TiledGrid::for_each_tile(Func&&) */
+    template <typename Func>
+    void for_each_tile(Func && f) const;
+
+    /** @returns a grid with all the same elements, in the same positions */
+    Grid<T> to_grid() const;
+
+    void swap(TiledGrid &) noexcept;
+
+private:
+    static constexpr const int k_tile_shift = []() {
+        int rv = 0;
+        while ((1 << rv) != kt_tile_size) { ++rv; }
+        return rv;
+    } ();
+    static constexpr const int k_tile_mask = kt_tile_size - 1;
+    static constexpr const int k_tile_area = kt_tile_size*kt_tile_size;
+
+    static int tiles_for(int length) noexcept
+        { return (length + k_tile_mask) >> k_tile_shift; }
+
+    std::size_t to_index(int x, int y) const noexcept {
+        auto tile_index = std::size_t((y >> k_tile_shift)*m_tiles_across + (x >> k_tile_shift));
+        return   tile_index*k_tile_area
+               + std::size_t(((y & k_tile_mask) << k_tile_shift) + (x & k_tile_mask));
+    }
+
+    template <typename TileType, typename GridType>
+    static TileType make_tile(GridType &, int tile_x, int tile_y);
+
+    std::out_of_range make_out_of_range_error(const char * caller) const;
+
+    std::vector<T> m_elements;
+    Size m_size;
+    int m_tiles_across = 0;
+};
+
+// ----------------------------------------------------------------------------
+
+#ifndef DOXYGEN_SHOULD_SKIP_THIS
+
+template <typename T, int kt_tile_size>
+TiledGrid<T, kt_tile_size>::TiledGrid(const Grid<T> & grid) {
+    set_size(grid.size2());
+    for (int y = 0; y != height(); ++y) {
+        for (int x = 0; x != width(); ++x)
+            { element_unchecked(x, y) = grid.element_unchecked(x, y); }
+    }
+}
+
+template <typename T, int kt_tile_size>
+void TiledGrid<T, kt_tile_size>::set_size
+    (int width_, int height_, const Element & el)
+{
+    if (width_ < 0 || height_ < 0) {
+        throw std::invalid_argument("TiledGrid::set_size: both dimensions "
+                                    "must be non-negative integers.");
+    }
+    TiledGrid temp;
+    temp.m_tiles_across = tiles_for(width_);
+    temp.m_size = Size{width_, height_};
+    temp.m_elements.resize
+        (std::size_t(temp.m_tiles_across)*std::size_t(tiles_for(height_))*k_tile_area,
+         el);
+    const auto kept_width  = std::min(width (), width_ );
+    const auto kept_height = std::min(height(), height_);
+    for (int y = 0; y != kept_height; ++y) {
+        for (int x = 0; x != kept_width; ++x)
+            { temp.element_unchecked(x, y) = std::move(element_unchecked(x, y)); }
+    }
+    swap(temp);
+}
+
+template <typename T, int kt_tile_size>
+typename TiledGrid<T, kt_tile_size>::Vector
+    TiledGrid<T, kt_tile_size>::next(const Vector & r) const noexcept
+{
+    auto pos = r;
+    if (++pos.x == width()) {
+        pos.x = 0;
+        ++pos.y;
+    }
+    return pos;
+}
+
+template <typename T, int kt_tile_size>
+typename TiledGrid<T, kt_tile_size>::ReferenceType
+    TiledGrid<T, kt_tile_size>::operator () (int x, int y)
+{
+    if (!has_position(x, y)) throw make_out_of_range_error("operator()");
+    return m_elements[to_index(x, y)];
+}
+
+template <typename T, int kt_tile_size>
+typename TiledGrid<T, kt_tile_size>::ConstReferenceType
+    TiledGrid<T, kt_tile_size>::operator () (int x, int y) const
+{
+    if (!has_position(x, y)) throw make_out_of_range_error("operator()");
+    return m_elements[to_index(x, y)];
+}
+
+template <typename T, int kt_tile_size>
+typename TiledGrid<T, kt_tile_size>::Tile
+    TiledGrid<T, kt_tile_size>::tile(int tile_x, int tile_y)
+{ return make_tile<Tile>(*this, tile_x, tile_y); }
+
+template <typename T, int kt_tile_size>
+typename TiledGrid<T, kt_tile_size>::ConstTile
+    TiledGrid<T, kt_tile_size>::tile(int tile_x, int tile_y) const
+{ return make_tile<ConstTile>(*this, tile_x, tile_y); }
+
+template <typename T, int kt_tile_size>
+template <typename Func>
+void TiledGrid<T, kt_tile_size>::for_each_tile(Func && f) {
+    const auto count = tile_count2();
+    for (int ty = 0; ty != count.height; ++ty) {
+        for (int tx = 0; tx != count.width; ++tx)
+            { f(tile(tx, ty)); }
+    }
+}
+
+template <typename T, int kt_tile_size>
+template <typename Func>
+void TiledGrid<T, kt_tile_size>::for_each_tile(Func && f) const {
+    const auto count = tile_count2();
+    for (int ty = 0; ty != count.height; ++ty) {
+        for (int tx = 0; tx != count.width; ++tx)
+            { f(tile(tx, ty)); }
+    }
+}
+
+template <typename T, int kt_tile_size>
+Grid<T> TiledGrid<T, kt_tile_size>::to_grid() const {
+    Grid<T> rv;
+    rv.set_size(width(), height());
+    for_each_tile([&rv] (const ConstTile & tile) {
+        for (int y = 0; y != tile.height(); ++y) {
+            auto row = tile.row(y);
+            std::copy(row.begin(), row.end(),
+                      &rv.element_unchecked(tile.origin() + Vector(0, y)));
+        }
+    });
+    return rv;
+}
+
+template <typename T, int kt_tile_size>
+void TiledGrid<T, kt_tile_size>::swap(TiledGrid & rhs) noexcept {
+    m_elements.swap(rhs.m_elements);
+    std::swap(m_size, rhs.m_size);
+    std::swap(m_tiles_across, rhs.m_tiles_across);
+}
+
+template <typename T, int kt_tile_size>
+template <typename TileType, typename GridType>
+/* private static */ TileType TiledGrid<T, kt_tile_size>::make_tile
+    (GridType & grid, int tile_x, int tile_y)
+{
+    const auto count = grid.tile_count2();
+    if (tile_x < 0 || tile_y < 0 || tile_x >= count.width || tile_y >= count.height)
+        { throw grid.make_out_of_range_error("tile"); }
+    Vector origin{tile_x*kt_tile_size, tile_y*kt_tile_size};
+    Size size{std::min(kt_tile_size, grid.width () - origin.x),
+              std::min(kt_tile_size, grid.height() - origin.y)};
+    return TileType{&grid.m_elements[grid.to_index(origin.x, origin.y)],
+                    kt_tile_size, origin, size};
+}
+
+template <typename T, int kt_tile_size>
+/* private */ std::out_of_range TiledGrid<T, kt_tile_size>::
+    make_out_of_range_error(const char * caller) const
+{
+    return std::out_of_range("TiledGrid::" + std::string(caller) + ": "
+                             "requested position is out of range, size: width "
+                             + std::to_string(width()) + " height "
+                             + std::to_string(height()));
+}
+
+#endif // ifndef DOXYGEN_SHOULD_SKIP_THIS
+
+} // end of cul namespace
@@ -0,0 +1,214 @@
+/****************************************************************************
+
+    MIT License
+
+    Copyright (c) 2023 Aria Janke
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+
+*****************************************************************************/
+
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+
+#if defined(__AVX2__) || defined(__SSE2__)
+#   include <immintrin.h>
+#endif
+
+#ifdef MACRO_PLATFORM_LINUX
+#   include <sys/mman.h>
+#endif
+
+namespace cul {
+
+namespace detail {
+
+/** A set of bits, one per slot in a control byte group, bit zero being the
+ *  first slot of the group.
+ */
+class HashMapControlMask final {
+public:
+    using BitsType = std::uint32_t;
+
+    constexpr explicit HashMapControlMask(BitsType bits_): m_bits(bits_) {}
+
+    constexpr bool has_any() const noexcept { return m_bits != 0; }
+
+    /** @returns offset of the first set bit, has_any must be true */
+    int lowest() const noexcept;
+
+    constexpr HashMapControlMask without_lowest() const noexcept
+        { return HashMapControlMask{m_bits & (m_bits - 1)}; }
+
+    /** @returns only those bits that come before the first set bit of
+     *           the other mask (all bits if other has none)
+     */
+    constexpr HashMapControlMask before_lowest_of
+        (const HashMapControlMask & other) const noexcept
+    {
+        return other.has_any() ?
+            HashMapControlMask{m_bits & ((other.m_bits & -other.m_bits) - 1)} :
+            *this;
+    }
+
+private:
+    BitsType m_bits;
+};
+
+/** A group of consecutive control bytes, loaded all at once so that every
+ *  slot in the group maybe matched against a tag in just a few
+ *  instructions.
+ *
+ *  Control bytes are either "empty" (high bit set) or seven bits taken from
+ *  the hash of the key stored in that slot.
+ */
+class HashMapControlGroup final {
+public:
+#   if defined(__AVX2__)
+    static constexpr const std::size_t k_width = 32;
+#   else
+    static constexpr const std::size_t k_width = 16;
+#   endif
+
+    static constexpr const std::uint8_t k_empty = 0x80;
+
+    /** @returns the control tag to use for a given (full) hash
+     *  @note the hash is remixed, as many hashes for integers are the
+     *        identity function, whose high bits are almost always zero
+     */
+    static constexpr std::uint8_t tag_for(std::size_t hash) noexcept {
+        return std::uint8_t
+            ((std::uint64_t(hash)*0x9E3779B97F4A7C15ull) >> 57);
+    }
+
+    /** @param controls must point to at least k_width readable bytes */
+    explicit HashMapControlGroup(const std::uint8_t * controls):
+        m_controls(controls) {}
+
+    HashMapControlMask match(std::uint8_t tag) const noexcept;
+
+    HashMapControlMask match_empty() const noexcept
+        { return match(k_empty); }
+
+    HashMapControlMask match_full() const noexcept;
+
+private:
+    const std::uint8_t * m_controls;
+};
+
+/** Hints that the given address will soon be read. Does nothing where no
+ *  prefetch intrinsic is available.
+ */
+inline void prefetch_for_read(const void * address) noexcept {
+#   if defined(__GNUC__)
+    __builtin_prefetch(address, 0, 3);
+#   elif defined(__SSE2__)
+    _mm_prefetch(reinterpret_cast<const char *>(address), _MM_HINT_T0);
+#   else
+    (void)address;
+#   endif
+}
+
+/** Unit in which bucket blocks are allocated, so that any allocator (which
+ *  only knows its value type's alignment) gives suitably aligned memory.
+ */
+struct alignas(64) HashMapBlockChunk final {
+    std::byte bytes[64];
+};
+
+/** Size (and alignment) of a transparent huge page on common platforms. */
+constexpr const std::size_t k_huge_page_size = std::size_t(2) << 20;
+
+/** Asks the operating system to back the given (huge page aligned) range
+ *  with huge pages. Only does anything on Linux, and failure is harmless.
+ */
+inline void advise_huge_pages(void * address, std::size_t size) noexcept {
+#   if defined(MACRO_PLATFORM_LINUX) && defined(MADV_HUGEPAGE)
+    (void)madvise(address, size, MADV_HUGEPAGE);
+#   else
+    (void)address;
+    (void)size;
+#   endif
+}
+
+// ----------------------------------------------------------------------------
+
+inline int HashMapControlMask::lowest() const noexcept {
+#   if defined(__GNUC__)
+    return __builtin_ctz(m_bits);
+#   else
+    int rv = 0;
+    for (auto bits = m_bits; !(bits & 1); bits >>= 1)
+        { ++rv; }
+    return rv;
+#   endif
+}
+
+inline HashMapControlMask HashMapControlGroup::match
+    (std::uint8_t tag) const noexcept
+{
+#   if defined(__AVX2__)
+    auto group = _mm256_loadu_si256
+        (reinterpret_cast<const __m256i *>(m_controls));
+    auto eq = _mm256_cmpeq_epi8(group, _mm256_set1_epi8(char(tag)));
+    return HashMapControlMask{HashMapControlMask::BitsType
+        (_mm256_movemask_epi8(eq))};
+#   elif defined(__SSE2__)
+    auto group = _mm_loadu_si128
+        (reinterpret_cast<const __m128i *>(m_controls));
+    auto eq = _mm_cmpeq_epi8(group, _mm_set1_epi8(char(tag)));
+    return HashMapControlMask{HashMapControlMask::BitsType
+        (_mm_movemask_epi8(eq))};
+#   else
+    HashMapControlMask::BitsType bits = 0;
+    for (std::size_t i = 0; i != k_width; ++i) {
+        if (m_controls[i] == tag)
+            { bits |= HashMapControlMask::BitsType(1) << i; }
+    }
+    return HashMapControlMask{bits};
+#   endif
+}
+
+inline HashMapControlMask HashMapControlGroup::match_full() const noexcept {
+    // full slots are exactly those without the high bit set
+#   if defined(__AVX2__)
+    auto group = _mm256_loadu_si256
+        (reinterpret_cast<const __m256i *>(m_controls));
+    return HashMapControlMask{~HashMapControlMask::BitsType
+        (_mm256_movemask_epi8(group))};
+#   elif defined(__SSE2__)
+    auto group = _mm_loadu_si128
+        (reinterpret_cast<const __m128i *>(m_controls));
+    return HashMapControlMask{~HashMapControlMask::BitsType
+        (_mm_movemask_epi8(group)) & 0xFFFFu};
+#   else
+    HashMapControlMask::BitsType bits = 0;
+    for (std::size_t i = 0; i != k_width; ++i) {
+        if (!(m_controls[i] & k_empty))
+            { bits |= HashMapControlMask::BitsType(1) << i; }
+    }
+    return HashMapControlMask{bits};
+#   endif
+}
+
+} // end of detail namespace -> into ::cul
+
+} // end of cul namespace
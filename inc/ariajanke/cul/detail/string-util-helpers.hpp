@@ -0,0 +1,758 @@
+/****************************************************************************
+
+    MIT License
+
+    Copyright (c) 2023 Aria Janke
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+
+*****************************************************************************/
+
+
+#pragma once
+
+#include <algorithm>
+#include <cassert>
+#include <cfloat>
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+#include <limits>
+#include <string>
+#include <type_traits>
+
+#if defined(__AVX2__) || defined(__SSE2__)
+#   include <immintrin.h>
+#endif
+
+namespace cul {
+
+namespace detail {
+
+/** Finds bytes in (or not in) a small constant set, a block of bytes at a
+ *  time where SSE2 or AVX2 is available.
+ */
+template <char... kt_chars>
+class ByteSetSearch final {
+public:
+    static_assert(sizeof...(kt_chars) > 0, "Byte set must not be empty.");
+
+    static constexpr bool contains(char c) noexcept
+        { return ((c == kt_chars) || ...); }
+
+    /** @returns first byte in the set, or end */
+    static const char * find_first_of
+        (const char * beg, const char * end) noexcept
+    { return find_first<true>(beg, end); }
+
+    /** @returns first byte not in the set, or end */
+    static const char * find_first_not_of
+        (const char * beg, const char * end) noexcept
+    { return find_first<false>(beg, end); }
+
+    /** @returns one past the last byte not in the set, or beg */
+    static const char * find_end_of_last_not_of
+        (const char * beg, const char * end) noexcept;
+
+private:
+    using Mask = std::uint32_t;
+
+#   if defined(__AVX2__)
+    static constexpr const std::ptrdiff_t k_block_size = 32;
+    static constexpr const Mask k_full_mask = ~Mask(0);
+
+    static Mask member_mask(const char * block) noexcept {
+        auto bytes = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(block));
+        auto hits = _mm256_setzero_si256();
+        ((hits = _mm256_or_si256
+            (hits, _mm256_cmpeq_epi8(bytes, _mm256_set1_epi8(kt_chars)))), ...);
+        return Mask(_mm256_movemask_epi8(hits));
+    }
+#   elif defined(__SSE2__)
+    static constexpr const std::ptrdiff_t k_block_size = 16;
+    static constexpr const Mask k_full_mask = 0xFFFF;
+
+    static Mask member_mask(const char * block) noexcept {
+        auto bytes = _mm_loadu_si128(reinterpret_cast<const __m128i *>(block));
+        auto hits = _mm_setzero_si128();
+        ((hits = _mm_or_si128
+            (hits, _mm_cmpeq_epi8(bytes, _mm_set1_epi8(kt_chars)))), ...);
+        return Mask(_mm_movemask_epi8(hits));
+    }
+#   else
+    // no blocks, every byte is tested on its own
+    static constexpr const std::ptrdiff_t k_block_size = 0;
+    static constexpr const Mask k_full_mask = 0;
+
+    static Mask member_mask(const char *) noexcept { return 0; }
+#   endif
+
+    static int lowest_bit(Mask mask) noexcept;
+
+    static int highest_bit(Mask mask) noexcept;
+
+    template <bool kt_find_members>
+    static const char * find_first(const char * beg, const char * end) noexcept;
+};
+
+// ----------------------------------------------------------------------------
+
+template <char... kt_chars>
+/* static */ const char * ByteSetSearch<kt_chars...>::find_end_of_last_not_of
+    (const char * beg, const char * end) noexcept
+{
+    if constexpr (k_block_size != 0) {
+        while (end - beg >= k_block_size) {
+            auto others = ~member_mask(end - k_block_size) & k_full_mask;
+            if (others) return end - k_block_size + highest_bit(others) + 1;
+            end -= k_block_size;
+        }
+    }
+    while (end != beg && contains(*(end - 1)))
+        { --end; }
+    return end;
+}
+
+template <char... kt_chars>
+/* private static */ int ByteSetSearch<kt_chars...>::lowest_bit
+    (Mask mask) noexcept
+{
+#   if defined(__GNUC__)
+    return __builtin_ctz(mask);
+#   else
+    int rv = 0;
+    for (; !(mask & 1); mask >>= 1)
+        { ++rv; }
+    return rv;
+#   endif
+}
+
+template <char... kt_chars>
+/* private static */ int ByteSetSearch<kt_chars...>::highest_bit
+    (Mask mask) noexcept
+{
+#   if defined(__GNUC__)
+    return 31 - __builtin_clz(mask);
+#   else
+    int rv = 31;
+    for (; !(mask & (Mask(1) << 31)); mask <<= 1)
+        { --rv; }
+    return rv;
+#   endif
+}
+
+template <char... kt_chars>
+template <bool kt_find_members>
+/* private static */ const char * ByteSetSearch<kt_chars...>::find_first
+    (const char * beg, const char * end) noexcept
+{
+    if constexpr (k_block_size != 0) {
+        while (end - beg >= k_block_size) {
+            auto mask = member_mask(beg);
+            if (!kt_find_members) mask = ~mask & k_full_mask;
+            if (mask) return beg + lowest_bit(mask);
+            beg += k_block_size;
+        }
+    }
+    while (beg != end && contains(*beg) != kt_find_members)
+        { ++beg; }
+    return beg;
+}
+
+// ----------------------------------------------------------------------------
+
+enum class IntegerReadResult { read, not_a_number, has_dot };
+
+constexpr const bool k_is_little_endian =
+#   if defined(__BYTE_ORDER__) && defined(__ORDER_LITTLE_ENDIAN__)
+    __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__;
+#   else
+    false;
+#   endif
+
+/** @returns true if all eight bytes of a word are decimal digits */
+inline bool are_eight_decimal_digits(std::uint64_t word) noexcept {
+    // high nibbles must all be 3, and adding 6 must not carry out of any low
+    // nibble (as it would for ':' onwards)
+    return    (word & 0xF0F0F0F0F0F0F0F0ull) == 0x3030303030303030ull
+           && ((word + 0x0606060606060606ull) & 0xF0F0F0F0F0F0F0F0ull)
+              == 0x3030303030303030ull;
+}
+
+/** @returns value of eight decimal digits, loaded (little endian) into a
+ *           word, the first digit being the most significant
+ */
+inline std::uint32_t eight_decimal_digits_value(std::uint64_t word) noexcept {
+    // digits are paired, then paired pairs, then the two halves combined;
+    // each step is one multiply spanning every lane
+    constexpr const std::uint64_t k_mask = 0x000000FF000000FFull;
+    constexpr const std::uint64_t k_mul1 = 100 + (1000000ull << 32);
+    constexpr const std::uint64_t k_mul2 = 1 + (10000ull << 32);
+    word -= 0x3030303030303030ull;
+    word = (word*10) + (word >> 8);
+    return std::uint32_t(
+        (((word & k_mask)*k_mul1) + (((word >> 16) & k_mask)*k_mul2)) >> 32);
+}
+
+/** @returns value of a hexadecimal digit, or a value greater than 15 if it
+ *           is not one
+ */
+inline unsigned hexadecimal_digit_value(char c) noexcept {
+    auto u = unsigned(static_cast<unsigned char>(c));
+    if (u - '0' < 10) return u - '0';
+    u |= 0x20; // to lower case
+    if (u - 'a' < 6) return u - 'a' + 10;
+    return 16;
+}
+
+/** Reads an unsigned base 10 or 16 integer, with no sign or prefix, from
+ *  contiguous characters. Decimal digits are read eight at a time, where
+ *  words are little endian, and overflow is checked once per eight digits.
+ *
+ *  @returns has_dot if a dot is found (which is then left for the caller),
+ *           not_a_number if any other character is not a digit, or if the
+ *           magnitude does not fit in 64 bits
+ */
+inline IntegerReadResult read_integer_magnitude
+    (const char * beg, const char * end, int base, std::uint64_t & magnitude) noexcept
+{
+    static constexpr const std::uint64_t k_max = ~std::uint64_t(0);
+    std::uint64_t value = 0;
+    auto finish_with = [start = beg, end] (IntegerReadResult result) {
+        // a dot anywhere takes precedence, as the caller rereads it all
+        return std::find(start, end, '.') == end ? result : IntegerReadResult::has_dot;
+    };
+    if (base == 10) {
+        if constexpr (k_is_little_endian) {
+            while (end - beg >= 8) {
+                std::uint64_t word;
+                std::memcpy(&word, beg, sizeof(word));
+                if (!are_eight_decimal_digits(word)) break;
+                auto chunk = eight_decimal_digits_value(word);
+                if (value > (k_max - chunk) / 100000000ull)
+                    { return finish_with(IntegerReadResult::not_a_number); }
+                value = value*100000000ull + chunk;
+                beg += 8;
+            }
+        }
+        for (; beg != end; ++beg) {
+            auto digit = unsigned(static_cast<unsigned char>(*beg)) - '0';
+            if (digit > 9) return finish_with(IntegerReadResult::not_a_number);
+            if (value > (k_max - digit) / 10)
+                { return finish_with(IntegerReadResult::not_a_number); }
+            value = value*10 + digit;
+        }
+    } else {
+        assert(base == 16);
+        while (beg != end) {
+            // up to eight digits are gathered, before checking for overflow
+            auto chunk_end = beg + std::min(std::ptrdiff_t(8), end - beg);
+            const int digit_count = int(chunk_end - beg);
+            std::uint64_t chunk = 0;
+            unsigned bad = 0;
+            for (; beg != chunk_end; ++beg) {
+                auto digit = hexadecimal_digit_value(*beg);
+                bad |= digit;
+                chunk = (chunk << 4) | (digit & 0xF);
+            }
+            if (bad > 15 || (value >> (64 - digit_count*4)))
+                { return finish_with(IntegerReadResult::not_a_number); }
+            value = (value << (digit_count*4)) | chunk;
+        }
+    }
+    magnitude = value;
+    return IntegerReadResult::read;
+}
+
+/** Iterators over contiguous chars, which may be read many at a time. */
+template <typename IterType>
+constexpr const bool k_is_contiguous_char_iterator =
+       std::is_same_v<IterType, const char *>
+    || std::is_same_v<IterType, char *>
+    || std::is_same_v<IterType, std::string::const_iterator>
+    || std::is_same_v<IterType, std::string::iterator>;
+
+/** Iterators which read_integer_magnitude may read from, with integer types
+ *  (other than bool) it may convert to.
+ */
+template <typename IterType, typename RealType>
+constexpr const bool k_has_integer_fast_path =
+       std::is_integral_v<RealType> && !std::is_same_v<RealType, bool>
+    && sizeof(RealType) <= sizeof(std::uint64_t)
+    && k_is_contiguous_char_iterator<IterType>;
+
+/** Writes a magnitude as string_to_number_assume_negative does: negated for
+ *  signed types.
+ *  @returns false if the magnitude is out of range
+ */
+template <typename RealType>
+bool integer_magnitude_to_number(std::uint64_t magnitude, RealType & out) noexcept {
+    if constexpr (std::is_signed_v<RealType>) {
+        using Unsigned = std::make_unsigned_t<RealType>;
+        const auto k_max_magnitude =
+            std::uint64_t(Unsigned(std::numeric_limits<RealType>::max())) + 1;
+        if (magnitude > k_max_magnitude) return false;
+        // (negating the most negative value's magnitude as is would overflow)
+        out = magnitude == 0 ? RealType(0) : RealType(-RealType(magnitude - 1) - 1);
+    } else {
+        if (magnitude > std::uint64_t(std::numeric_limits<RealType>::max()))
+            { return false; }
+        out = RealType(magnitude);
+    }
+    return true;
+}
+
+// ----------------------------------------------------------------------------
+
+/** Powers of five, from 5^-342 to 5^308, each as its most significant 128
+ *  bits (high word first). Used by eisel_lemire.
+ */
+extern const std::uint64_t k_powers_of_five_128[651*2];
+
+enum class DecimalFloatTextResult { read, out_of_range, malformed };
+
+/** Reads a decimal float's text, (e.g. "1.5e-3") written out in full, with a
+ *  correctly rounded result. This is the (slow) fallback for the very rare
+ *  numbers eisel_lemire can not settle from nineteen digits.
+ *
+ *  The text must be no longer than k_max_decimal_float_text_length. Where
+ *  std::from_chars is unavailable, strtod/strtof are used, and these need
+ *  the "C" locale's decimal point (the global locale must not change it).
+ *
+ *  @returns out_of_range if the value is too large (or too small) to be
+ *           represented, in which case out is left unchanged
+ */
+/* linked */ DecimalFloatTextResult read_decimal_float_text
+    (const char * beg, const char * end, double & out) noexcept;
+
+/* linked */ DecimalFloatTextResult read_decimal_float_text
+    (const char * beg, const char * end, float & out) noexcept;
+
+// digits, a sticky digit, 'e', sign, exponent digits
+constexpr const std::size_t k_max_decimal_float_text_length = 769 + 1 + 1 + 1 + 20;
+
+template <typename RealType>
+struct BinaryFloatFormat final {};
+
+template <>
+struct BinaryFloatFormat<double> final {
+    using Bits = std::uint64_t;
+    static constexpr const int k_mantissa_bits              =   52;
+    static constexpr const int k_minimum_exponent           = -1023;
+    static constexpr const int k_infinite_power             = 0x7FF;
+    static constexpr const int k_smallest_power_of_ten      = -342;
+    static constexpr const int k_largest_power_of_ten       =  308;
+    static constexpr const int k_min_exponent_round_to_even =   -4;
+    static constexpr const int k_max_exponent_round_to_even =   23;
+    static constexpr const int k_max_exact_power_of_ten     =   22;
+};
+
+template <>
+struct BinaryFloatFormat<float> final {
+    using Bits = std::uint32_t;
+    static constexpr const int k_mantissa_bits              =   23;
+    static constexpr const int k_minimum_exponent           = -127;
+    static constexpr const int k_infinite_power             = 0xFF;
+    static constexpr const int k_smallest_power_of_ten      =  -65;
+    static constexpr const int k_largest_power_of_ten       =   38;
+    static constexpr const int k_min_exponent_round_to_even =  -17;
+    static constexpr const int k_max_exponent_round_to_even =   10;
+    static constexpr const int k_max_exact_power_of_ten     =   10;
+};
+
+/** Floating point types read_decimal_float may convert to, which must be
+ *  IEEE 754 binary32 or binary64.
+ */
+template <typename RealType>
+constexpr const bool k_has_float_fast_path =
+       (std::is_same_v<RealType, float> || std::is_same_v<RealType, double>)
+    && std::numeric_limits<RealType>::is_iec559;
+
+/** A float as its mantissa bits (without the implicit one) and biased
+ *  exponent, e.g. as the output of eisel_lemire
+ */
+struct AdjustedMantissa final {
+    std::uint64_t mantissa = 0;
+    int power2 = 0;
+};
+
+inline bool operator == (const AdjustedMantissa & lhs, const AdjustedMantissa & rhs)
+    { return lhs.mantissa == rhs.mantissa && lhs.power2 == rhs.power2; }
+
+inline bool operator != (const AdjustedMantissa & lhs, const AdjustedMantissa & rhs)
+    { return !(lhs == rhs); }
+
+struct UInt128Parts final {
+    std::uint64_t high = 0;
+    std::uint64_t low  = 0;
+};
+
+inline UInt128Parts multiply_full(std::uint64_t a, std::uint64_t b) noexcept {
+    UInt128Parts rv;
+#   if defined(__SIZEOF_INT128__)
+    __extension__ typedef unsigned __int128 UInt128;
+    auto product = UInt128(a)*b;
+    rv.high = std::uint64_t(product >> 64);
+    rv.low  = std::uint64_t(product);
+#   else
+    static constexpr const std::uint64_t k_low_half = 0xFFFFFFFFull;
+    auto a_lo = a & k_low_half, a_hi = a >> 32;
+    auto b_lo = b & k_low_half, b_hi = b >> 32;
+    auto lo_lo = a_lo*b_lo, lo_hi = a_lo*b_hi, hi_lo = a_hi*b_lo;
+    auto mid = (lo_lo >> 32) + (lo_hi & k_low_half) + (hi_lo & k_low_half);
+    rv.low  = (mid << 32) | (lo_lo & k_low_half);
+    rv.high = a_hi*b_hi + (lo_hi >> 32) + (hi_lo >> 32) + (mid >> 32);
+#   endif
+    return rv;
+}
+
+inline int count_leading_zeros(std::uint64_t word) noexcept {
+    assert(word != 0);
+#   if defined(__GNUC__)
+    return __builtin_clzll(word);
+#   else
+    int count = 0;
+    for (; !(word & (std::uint64_t(1) << 63)); word <<= 1) ++count;
+    return count;
+#   endif
+}
+
+/** Eisel-Lemire: converts w*10^q to a float's mantissa and exponent, by
+ *  multiplying a normalized w by a 128 bit approximation of 5^q. With w
+ *  exact, the result is always correctly rounded.
+ *
+ *  @note the exponent of an infinite or zero result is set to the format's
+ *        infinite power or zero respectively
+ */
+template <typename RealType>
+AdjustedMantissa eisel_lemire(std::int64_t q, std::uint64_t w) noexcept {
+    using Format = BinaryFloatFormat<RealType>;
+    static constexpr const int k_mantissa_bits = Format::k_mantissa_bits;
+    static constexpr const int k_smallest_power_of_five = -342;
+    // enough bits to be certain of rounding
+    static constexpr const std::uint64_t k_precision_mask =
+        ~std::uint64_t(0) >> (k_mantissa_bits + 3);
+
+    AdjustedMantissa answer;
+    if (w == 0 || q < Format::k_smallest_power_of_ten) return answer;
+    if (q > Format::k_largest_power_of_ten) {
+        answer.power2 = Format::k_infinite_power;
+        return answer;
+    }
+    const int leading_zeros = count_leading_zeros(w);
+    w <<= leading_zeros;
+
+    const auto index = std::size_t(2*(q - k_smallest_power_of_five));
+    auto product = multiply_full(w, k_powers_of_five_128[index]);
+    if ((product.high & k_precision_mask) == k_precision_mask) {
+        // the lower 64 bits of the power may still carry into what we need
+        auto second = multiply_full(w, k_powers_of_five_128[index + 1]);
+        product.low += second.high;
+        if (second.high > product.low) ++product.high;
+    }
+
+    const int upper_bit = int(product.high >> 63);
+    const int shift = upper_bit + 64 - k_mantissa_bits - 3;
+    // floor(log2(10^q)) + 63, for q in [-342, 308]
+    const int power_of_two = ((int(q)*(152170 + 65536)) >> 16) + 63;
+    answer.mantissa = product.high >> shift;
+    answer.power2   =   power_of_two + upper_bit - leading_zeros
+                      - Format::k_minimum_exponent;
+    if (answer.power2 <= 0) {
+        // subnormal (or zero)
+        if (-answer.power2 + 1 >= 64) return AdjustedMantissa{};
+        answer.mantissa >>= -answer.power2 + 1;
+        answer.mantissa += (answer.mantissa & 1);
+        answer.mantissa >>= 1;
+        // rounding may have carried into the smallest normal exponent
+        answer.power2 =
+            answer.mantissa < (std::uint64_t(1) << k_mantissa_bits) ? 0 : 1;
+        return answer;
+    }
+    // exactly halfway between two floats: round to even (only possible for a
+    // small range of exponents)
+    if (   product.low <= 1
+        && q >= Format::k_min_exponent_round_to_even
+        && q <= Format::k_max_exponent_round_to_even
+        && (answer.mantissa & 3) == 1
+        && (answer.mantissa << shift) == product.high)
+    { answer.mantissa &= ~std::uint64_t(1); }
+
+    answer.mantissa += (answer.mantissa & 1);
+    answer.mantissa >>= 1;
+    if (answer.mantissa >= (std::uint64_t(2) << k_mantissa_bits)) {
+        answer.mantissa = std::uint64_t(1) << k_mantissa_bits;
+        ++answer.power2;
+    }
+    answer.mantissa &= ~(std::uint64_t(1) << k_mantissa_bits);
+    if (answer.power2 >= Format::k_infinite_power) {
+        answer.power2   = Format::k_infinite_power;
+        answer.mantissa = 0;
+    }
+    return answer;
+}
+
+template <typename RealType>
+RealType adjusted_mantissa_to_float(const AdjustedMantissa & adjusted) noexcept {
+    using Format = BinaryFloatFormat<RealType>;
+    using Bits = typename Format::Bits;
+    static_assert(sizeof(Bits) == sizeof(RealType));
+    auto bits =   Bits(adjusted.mantissa)
+                | (Bits(adjusted.power2) << Format::k_mantissa_bits);
+    RealType rv;
+    std::memcpy(&rv, &bits, sizeof(rv));
+    return rv;
+}
+
+/** A decimal float's significant digits, up to some limit, and the power of
+ *  ten they're scaled by.
+ */
+struct DecimalFloatParts final {
+    std::int64_t exponent = 0;
+    int digit_count = 0;
+    // true if any nonzero digits beyond the limit were dropped
+    bool truncated = false;
+};
+
+/** Reads what remains of a decimal float: nothing, or an e exponent, which
+ *  is added to exponent.
+ *
+ *  @returns false if the text is malformed
+ */
+template <typename IterType>
+bool read_decimal_exponent(IterType beg, IterType end, std::int64_t & exponent) noexcept {
+    using CharType = std::remove_cv_t<std::remove_reference_t<decltype(*beg)>>;
+    // exponents beyond this are zero or infinity for any float
+    static constexpr const std::int64_t k_exponent_limit = 100000;
+    if (beg == end) return true;
+    if (*beg != CharType('e') && *beg != CharType('E')) return false;
+    ++beg;
+    bool is_negative = false;
+    if (beg != end && (*beg == CharType('-') || *beg == CharType('+'))) {
+        is_negative = *beg == CharType('-');
+        ++beg;
+    }
+    if (beg == end) return false;
+    std::int64_t written = 0;
+    for (; beg != end; ++beg) {
+        auto digit = unsigned(*beg) - unsigned('0');
+        if (digit > 9) return false;
+        written = std::min(written*10 + digit, k_exponent_limit);
+    }
+    exponent += is_negative ? -written : written;
+    return true;
+}
+
+/** Reads an unsigned decimal float, digits with an optional dot and then an
+ *  optional e exponent (e.g. "12.5e-3"). Each significant digit (up to
+ *  max_digits) is passed to on_digit, leading zeros are skipped.
+ *
+ *  @returns false if the text is malformed, or has no mantissa digits
+ */
+template <typename IterType, typename OnDigitFunc>
+bool read_decimal_float_parts
+    (IterType beg, IterType end, int max_digits, DecimalFloatParts & parts,
+     OnDigitFunc && on_digit)
+{
+    using CharType = std::remove_cv_t<std::remove_reference_t<decltype(*beg)>>;
+    auto digit_value = [] (CharType c) { return unsigned(c) - unsigned('0'); };
+
+    DecimalFloatParts rv;
+    bool has_digits = false;
+    bool in_fraction = false;
+    for (; beg != end; ++beg) {
+        if (*beg == CharType('.')) {
+            if (in_fraction) return false;
+            in_fraction = true;
+            continue;
+        }
+        auto digit = digit_value(*beg);
+        if (digit > 9) break;
+        has_digits = true;
+        if (rv.digit_count == 0 && digit == 0) {
+            // leading zero
+            if (in_fraction) --rv.exponent;
+        } else if (rv.digit_count < max_digits) {
+            on_digit(digit);
+            ++rv.digit_count;
+            if (in_fraction) --rv.exponent;
+        } else {
+            if (digit != 0) rv.truncated = true;
+            if (!in_fraction) ++rv.exponent;
+        }
+    }
+    if (!has_digits) return false;
+    if (!read_decimal_exponent(beg, end, rv.exponent)) return false;
+    parts = rv;
+    return true;
+}
+
+/** A quicker read_decimal_float_parts, which counts every digit (leading
+ *  zeros included) and reads eight fraction digits at a time from contiguous
+ *  chars. The significand is only correct if there are nineteen digits or
+ *  fewer.
+ *
+ *  @returns false if the text is malformed, or has no mantissa digits
+ */
+template <typename IterType>
+bool scan_decimal_float
+    (IterType beg, IterType end, std::uint64_t & significand,
+     DecimalFloatParts & parts) noexcept
+{
+    using CharType = std::remove_cv_t<std::remove_reference_t<decltype(*beg)>>;
+    auto digit_value = [] (CharType c) { return unsigned(c) - unsigned('0'); };
+
+    // (may wrap, with too many digits)
+    std::uint64_t value = 0;
+    int digit_count = 0;
+    std::int64_t exponent = 0;
+    for (; beg != end; ++beg) {
+        auto digit = digit_value(*beg);
+        if (digit > 9) break;
+        value = value*10 + digit;
+        ++digit_count;
+    }
+    if (beg != end && *beg == CharType('.')) {
+        ++beg;
+        const int integer_digit_count = digit_count;
+        if constexpr (k_is_contiguous_char_iterator<IterType> && k_is_little_endian) {
+            while (end - beg >= 8) {
+                std::uint64_t word;
+                std::memcpy(&word, &*beg, sizeof(word));
+                if (!are_eight_decimal_digits(word)) break;
+                value = value*100000000ull + eight_decimal_digits_value(word);
+                digit_count += 8;
+                beg += 8;
+            }
+        }
+        for (; beg != end; ++beg) {
+            auto digit = digit_value(*beg);
+            if (digit > 9) break;
+            value = value*10 + digit;
+            ++digit_count;
+        }
+        exponent = -(digit_count - integer_digit_count);
+    }
+    if (digit_count == 0) return false;
+    if (!read_decimal_exponent(beg, end, exponent)) return false;
+    significand = value;
+    parts.exponent = exponent;
+    parts.digit_count = digit_count;
+    parts.truncated = false;
+    return true;
+}
+
+/** Reads an unsigned decimal float (see read_decimal_float_parts), with a
+ *  correctly rounded result. Most numbers are handled by an exact float
+ *  operation or eisel_lemire; only numbers with more than nineteen digits,
+ *  very near a halfway point, are read in full by read_decimal_float_text.
+ *
+ *  @returns false if the text is malformed, or the value is too large to be
+ *           finite
+ */
+template <typename IterType, typename RealType>
+bool read_decimal_float(IterType beg, IterType end, RealType & out) noexcept {
+    using Format = BinaryFloatFormat<RealType>;
+    static constexpr const int k_max_digits = 19;
+    // exact float operations give correctly rounded results, but only if
+    // they are not carried out with extra precision
+#   if defined(FLT_EVAL_METHOD) && FLT_EVAL_METHOD == 0
+    static constexpr const bool k_has_exact_operations = true;
+#   else
+    static constexpr const bool k_has_exact_operations = false;
+#   endif
+    static constexpr const RealType k_exact_powers_of_ten[] = {
+        1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+        1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+    };
+    static constexpr const std::uint64_t k_max_exact_mantissa =
+        std::uint64_t(2) << Format::k_mantissa_bits;
+
+    DecimalFloatParts parts;
+    std::uint64_t significand = 0;
+    if (!scan_decimal_float(beg, end, significand, parts)) return false;
+    if (parts.digit_count > k_max_digits) {
+        // too many digits (or leading zeros) to have been read as is
+        significand = 0;
+        read_decimal_float_parts(beg, end, k_max_digits, parts,
+            [&significand] (unsigned digit) { significand = significand*10 + digit; });
+    }
+
+    if (significand == 0) {
+        out = RealType(0);
+        return true;
+    }
+    if (   k_has_exact_operations && !parts.truncated
+        && significand <= k_max_exact_mantissa
+        && parts.exponent >= -Format::k_max_exact_power_of_ten
+        && parts.exponent <=  Format::k_max_exact_power_of_ten)
+    {
+        // both operands are exact, so one rounding is all that happens
+        auto value = RealType(significand);
+        if (parts.exponent < 0) value /= k_exact_powers_of_ten[-parts.exponent];
+        else                    value *= k_exact_powers_of_ten[ parts.exponent];
+        out = value;
+        return true;
+    }
+
+    auto adjusted = eisel_lemire<RealType>(parts.exponent, significand);
+    if (   parts.truncated
+        && adjusted != eisel_lemire<RealType>(parts.exponent, significand + 1))
+    {
+        // the dropped digits decide it, so all of them must be read
+        static constexpr const int k_max_text_digits = 769;
+        char text[k_max_decimal_float_text_length];
+        char * text_end = text;
+        if (!read_decimal_float_parts(beg, end, k_max_text_digits, parts,
+            [&text_end] (unsigned digit) { *text_end++ = char('0' + digit); }))
+        { return false; }
+        // any nonzero digit past the limit, places the value past a halfway
+        // point, which these digits are enough to express
+        if (parts.truncated) {
+            *text_end++ = '1';
+            --parts.exponent;
+        }
+        *text_end++ = 'e';
+        if (parts.exponent < 0) *text_end++ = '-';
+        auto exponent = std::uint64_t(parts.exponent < 0 ? -parts.exponent : parts.exponent);
+        auto exponent_beg = text_end;
+        do {
+            *text_end++ = char('0' + exponent % 10);
+            exponent /= 10;
+        } while (exponent);
+        std::reverse(exponent_beg, text_end);
+        switch (read_decimal_float_text(text, text_end, out)) {
+        case DecimalFloatTextResult::read: return true;
+        case DecimalFloatTextResult::malformed: return false;
+        case DecimalFloatTextResult::out_of_range: break;
+        }
+        // too small underflows to zero (as with eisel_lemire), with the
+        // value either subnormal or zero, it can not be too large
+        if (adjusted.power2 != 0) return false;
+        out = RealType(0);
+        return true;
+    }
+    if (adjusted.power2 == Format::k_infinite_power) return false;
+    out = adjusted_mantissa_to_float<RealType>(adjusted);
+    return true;
+}
+
+} // end of detail namespace -> into ::cul
+
+} // end of cul namespace
@@ -47,6 +47,8 @@ QMAKE_LFLAGS   += -std=c++17
 SOURCES += \
     #../src/BitmapFont.cpp              \
     #../src/CurrentWorkingDirectory.cpp \
+    #../src/GridFile.cpp                \
+    #../src/StringUtil.cpp              \
     \ # SFML Utilities
     #../src/sf-DrawText.cpp             \
     #../src/sf-DrawRectangle.cpp        \
@@ -67,10 +69,19 @@ HEADERS += \
     ../inc/ariajanke/cul/TypeList.hpp                \
     ../inc/ariajanke/cul/TypeSet.hpp                 \
     ../inc/ariajanke/cul/StringUtil.hpp              \
+    ../inc/ariajanke/cul/detail/string-util-helpers.hpp \
     ../inc/ariajanke/cul/TestSuite.hpp               \
     ../inc/ariajanke/cul/Grid.hpp                    \
     ../inc/ariajanke/cul/ParseOptions.hpp            \
     ../inc/ariajanke/cul/SubGrid.hpp                 \
+    ../inc/ariajanke/cul/TiledGrid.hpp               \
+    ../inc/ariajanke/cul/GridAlgorithms.hpp          \
+    ../inc/ariajanke/cul/ChunkedGrid.hpp             \
+    ../inc/ariajanke/cul/GridFile.hpp                \
+    ../inc/ariajanke/cul/SnapshotGrid.hpp            \
+    ../inc/ariajanke/cul/CompressedGrid.hpp          \
+    ../inc/ariajanke/cul/BitGrid.hpp                 \
+    ../inc/ariajanke/cul/ParallelGrid.hpp            \
     ../inc/ariajanke/cul/Vector2.hpp                 \
     ../inc/ariajanke/cul/BezierCurves.hpp            \
     ../inc/ariajanke/cul/BezierCurvesDetails.hpp     \
@@ -86,6 +97,9 @@ HEADERS += \
     ../inc/ariajanke/cul/detail/either-helpers.hpp   \
     ../inc/ariajanke/cul/EitherFold.hpp              \
     ../inc/ariajanke/cul/HashMap.hpp                 \
+    ../inc/ariajanke/cul/detail/hash-map-helpers.hpp \
+    ../inc/ariajanke/cul/ConcurrentHashMap.hpp       \
+    ../inc/ariajanke/cul/HashSet.hpp                 \
     \ # SFML Utilities
     ../inc/ariajanke/cul/sf/DrawText.hpp             \
     ../inc/ariajanke/cul/sf/DrawRectangle.hpp        \
@@ -0,0 +1,251 @@
+/****************************************************************************
+
+    MIT License
+
+    Copyright (c) 2021 Aria Janke
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+
+*****************************************************************************/
+
+
+#include <ariajanke/cul/GridFile.hpp>
+
+#if defined(MACRO_PLATFORM_LINUX)
+#   include <fcntl.h>
+#   include <sys/mman.h>
+#   include <sys/stat.h>
+#   include <unistd.h>
+#endif
+
+#include <array>
+#include <cstring>
+#include <fstream>
+#include <limits>
+#include <new>
+#include <stdexcept>
+#include <utility>
+
+namespace {
+
+using Error = std::runtime_error;
+using cul::GridFileHeader;
+using HeaderBytes = std::array<char, GridFileHeader::k_data_offset>;
+
+constexpr const char k_magic[] = "cul-grid";
+constexpr const std::size_t k_magic_length = sizeof(k_magic) - 1;
+constexpr const std::uint32_t k_byte_order_mark = 0x01020304;
+
+// field offsets, after the magic string
+constexpr const std::size_t k_byte_order_offset   = k_magic_length;
+constexpr const std::size_t k_version_offset      = k_byte_order_offset + 4;
+constexpr const std::size_t k_element_size_offset = k_version_offset + 4;
+constexpr const std::size_t k_width_offset        = k_element_size_offset + 4;
+constexpr const std::size_t k_height_offset       = k_width_offset + 4;
+
+template <typename T>
+void write_field(HeaderBytes & bytes, std::size_t offset, T value)
+    { std::memcpy(bytes.data() + offset, &value, sizeof(T)); }
+
+template <typename T>
+T read_field(const char * bytes, std::size_t offset) {
+    T rv;
+    std::memcpy(&rv, bytes + offset, sizeof(T));
+    return rv;
+}
+
+} // end of <anonymous> namespace
+
+namespace cul {
+
+namespace detail {
+
+void throw_grid_file_error(const char * caller, const std::string & what)
+    { throw Error{std::string{caller} + ": " + what}; }
+
+bool verify_grid_file_length
+    (const char * caller, std::istream & in, const GridFileHeader & header)
+{
+    const auto here = in.tellg();
+    if (here == std::istream::pos_type(-1)) return false;
+    in.seekg(0, std::ios::end);
+    const auto end = in.tellg();
+    in.clear();
+    in.seekg(here);
+    if (!in)
+        { throw_grid_file_error(caller, "cannot return to the first row."); }
+    if (end == std::istream::pos_type(-1)) return false;
+    if (std::size_t(end - here) < header.data_size())
+        { throw_grid_file_error(caller, "file ends before its last row."); }
+    return true;
+}
+
+} // end of detail namespace -> into ::cul
+
+void write_grid_file_header(std::ostream & out, const GridFileHeader & header) {
+    HeaderBytes bytes{};
+    std::memcpy(bytes.data(), k_magic, k_magic_length);
+    write_field(bytes, k_byte_order_offset  , k_byte_order_mark  );
+    write_field(bytes, k_version_offset     , header.version     );
+    write_field(bytes, k_element_size_offset, header.element_size);
+    write_field(bytes, k_width_offset       , header.width       );
+    write_field(bytes, k_height_offset      , header.height      );
+    out.write(bytes.data(), std::streamsize(bytes.size()));
+    if (!out) {
+        detail::throw_grid_file_error
+            ("write_grid_file_header", "failed to write header.");
+    }
+}
+
+GridFileHeader read_grid_file_header(const void * bytes_, std::size_t length) {
+    static constexpr const char * k_caller = "read_grid_file_header";
+    const auto * bytes = reinterpret_cast<const char *>(bytes_);
+    if (   length < GridFileHeader::k_data_offset
+        || std::memcmp(bytes, k_magic, k_magic_length) != 0)
+    {
+        detail::throw_grid_file_error(k_caller, "not a grid file.");
+    }
+    if (read_field<std::uint32_t>(bytes, k_byte_order_offset) != k_byte_order_mark) {
+        detail::throw_grid_file_error
+            (k_caller, "grid file was written with another byte order.");
+    }
+    GridFileHeader rv;
+    rv.version      = read_field<std::uint32_t>(bytes, k_version_offset     );
+    rv.element_size = read_field<std::uint32_t>(bytes, k_element_size_offset);
+    rv.width        = read_field<std::int32_t >(bytes, k_width_offset       );
+    rv.height       = read_field<std::int32_t >(bytes, k_height_offset      );
+    if (rv.version != GridFileHeader::k_current_version) {
+        detail::throw_grid_file_error
+            (k_caller, "unsupported grid file version "
+             + std::to_string(rv.version) + ".");
+    }
+    if (rv.width < 0 || rv.height < 0 || rv.element_size == 0)
+        { detail::throw_grid_file_error(k_caller, "grid file header is corrupt."); }
+    // data_size must not wrap, or a tiny file could pass for a huge grid
+    static constexpr const auto k_max_size = std::numeric_limits<std::size_t>::max();
+    if (   rv.height != 0
+        && std::size_t(rv.width) > k_max_size / rv.element_size / std::size_t(rv.height))
+    {
+        detail::throw_grid_file_error
+            (k_caller, "grid file header describes more data than can be addressed.");
+    }
+    // grids count their elements with ints
+    static constexpr const auto k_max_count = std::numeric_limits<int>::max();
+    if (rv.height != 0 && rv.width > k_max_count / rv.height) {
+        detail::throw_grid_file_error
+            (k_caller, "grid file header describes more elements than a grid can hold.");
+    }
+    return rv;
+}
+
+GridFileHeader read_grid_file_header(std::istream & in) {
+    HeaderBytes bytes{};
+    in.read(bytes.data(), std::streamsize(bytes.size()));
+    if (!in) detail::throw_grid_file_error("read_grid_file_header", "not a grid file.");
+    return read_grid_file_header(bytes.data(), bytes.size());
+}
+
+// ----------------------------------------------------------------------------
+
+MappedGridFile::MappedGridFile(const std::string & filename) {
+    static constexpr const char * k_caller = "MappedGridFile";
+#   if defined(MACRO_PLATFORM_LINUX)
+    //
+    //                       LINUX IMPLEMENTATION
+    //
+    int fd = ::open(filename.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd == -1)
+        { detail::throw_grid_file_error(k_caller, "cannot open " + filename); }
+    struct stat info;
+    if (::fstat(fd, &info) != 0) {
+        ::close(fd);
+        detail::throw_grid_file_error(k_caller, "cannot stat " + filename);
+    }
+    const auto length = std::size_t(info.st_size);
+    void * mapping = length == 0 ? MAP_FAILED :
+        ::mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+    // the mapping stays valid without its descriptor
+    ::close(fd);
+    if (mapping == MAP_FAILED)
+        { detail::throw_grid_file_error(k_caller, "cannot map " + filename); }
+    m_mapping = mapping;
+    m_length  = length;
+#   else
+    //
+    //                      OTHER PLATFORMS
+    //
+    std::ifstream in{filename, std::ios::binary | std::ios::ate};
+    if (!in)
+        { detail::throw_grid_file_error(k_caller, "cannot open " + filename); }
+    const auto length = std::size_t(in.tellg());
+    in.seekg(0);
+    m_mapping = ::operator new
+        (length, std::align_val_t{GridFileHeader::k_data_offset});
+    m_length = length;
+    if (!in.read(reinterpret_cast<char *>(m_mapping), std::streamsize(length))) {
+        release();
+        detail::throw_grid_file_error(k_caller, "cannot read " + filename);
+    }
+#   endif
+    try {
+        m_header = read_grid_file_header(m_mapping, m_length);
+        if (m_length - GridFileHeader::k_data_offset < m_header.data_size())
+            { detail::throw_grid_file_error(k_caller, "file ends before its last row."); }
+    } catch (...) {
+        release();
+        throw;
+    }
+}
+
+MappedGridFile::MappedGridFile(MappedGridFile && rhs) noexcept
+    { swap(rhs); }
+
+MappedGridFile::~MappedGridFile() { release(); }
+
+MappedGridFile & MappedGridFile::operator = (MappedGridFile && rhs) noexcept {
+    if (this != &rhs) {
+        MappedGridFile temp{std::move(rhs)};
+        swap(temp);
+    }
+    return *this;
+}
+
+const void * MappedGridFile::data() const noexcept {
+    if (!m_mapping) return nullptr;
+    return reinterpret_cast<const char *>(m_mapping) + GridFileHeader::k_data_offset;
+}
+
+void MappedGridFile::swap(MappedGridFile & rhs) noexcept {
+    std::swap(m_mapping, rhs.m_mapping);
+    std::swap(m_length , rhs.m_length );
+    std::swap(m_header , rhs.m_header );
+}
+
+/* private */ void MappedGridFile::release() noexcept {
+    if (!m_mapping) return;
+#   if defined(MACRO_PLATFORM_LINUX)
+    ::munmap(m_mapping, m_length);
+#   else
+    ::operator delete(m_mapping, std::align_val_t{GridFileHeader::k_data_offset});
+#   endif
+    m_mapping = nullptr;
+    m_length = 0;
+}
+
+} // end of cul namespace
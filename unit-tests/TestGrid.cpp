@@ -26,12 +26,26 @@
 
 #include <ariajanke/cul/Grid.hpp>
 #include <ariajanke/cul/SubGrid.hpp>
+#include <ariajanke/cul/TiledGrid.hpp>
+#include <ariajanke/cul/GridAlgorithms.hpp>
+#include <ariajanke/cul/ChunkedGrid.hpp>
+#include <ariajanke/cul/GridFile.hpp>
+#include <ariajanke/cul/SnapshotGrid.hpp>
+#include <ariajanke/cul/CompressedGrid.hpp>
+#include <ariajanke/cul/BitGrid.hpp>
 #include <ariajanke/cul/TestSuite.hpp>
 
 #include <ariajanke/cul/TypeList.hpp>
 
 #include <iostream>
 #include <algorithm>
+#include <atomic>
+#include <fstream>
+#include <mutex>
+#include <numeric>
+#include <sstream>
+#include <string>
+#include <thread>
 
 #include <cassert>
 
@@ -44,15 +58,33 @@ using ts::TestSuite;
 using VectorI = cul::Vector2<int>;
 
 void test_grid();
+void test_grid_rows();
+void test_tiled_grid();
 void test_make_sub_grid();
 void test_sub_grid_iterator();
+void test_sub_grid_rows();
+void test_grid_algorithms();
+void test_chunked_grid();
+void test_grid_file();
+void test_snapshot_grid();
+void test_compressed_grid();
+void test_packed_grid();
 
 } // end of <anonymous> namespace
 
 int main() {
     test_grid();
+    test_grid_rows();
+    test_tiled_grid();
     test_make_sub_grid();
     test_sub_grid_iterator();
+    test_sub_grid_rows();
+    test_grid_algorithms();
+    test_chunked_grid();
+    test_grid_file();
+    test_snapshot_grid();
+    test_compressed_grid();
+    test_packed_grid();
     return 0;
 }
 
@@ -77,6 +109,16 @@ void test_grid() {
         g.set_size(2, 3, 10);
         return ts::test(g(1, 1) == 10);
     });
+    mark(tsuite).test([] {
+        Grid<char> g;
+        // element count must fit an int, even if each dimension does
+        try {
+            g.set_size(65536, 65537);
+        } catch (std::invalid_argument &) {
+            return ts::test(g.size() == 0);
+        }
+        return ts::test(false);
+    });
     mark(tsuite).test([] {
         Grid<int> g;
         g.set_size(2, 3, 10);
@@ -164,6 +206,114 @@ void test_grid() {
     });
 }
 
+void test_grid_rows() {
+    TestSuite suite;
+    suite.hide_successes();
+    suite.start_series("Grid rows and unchecked access");
+    mark(suite).test([] {
+        Grid<int> g { { 1, 2, 3 }, { 4, 5, 6 } };
+        return ts::test(   g.element_unchecked(2, 1) == 6
+                        && g.element_unchecked(VectorI{1, 0}) == 2);
+    });
+    mark(suite).test([] {
+        Grid<int> g { { 1, 2, 3 }, { 4, 5, 6 } };
+        auto row = g.row(1);
+        return ts::test(   row.size() == 3 && row[0] == 4 && row[2] == 6
+                        && row.data() == &g(0, 1));
+    });
+    mark(suite).test([] {
+        Grid<int> g;
+        g.set_size(4, 3, 1);
+        for (auto & el : g.row(2))
+            { el = 7; }
+        return ts::test(   g(0, 2) == 7 && g(3, 2) == 7
+                        && g(3, 1) == 1);
+    });
+    mark(suite).test([] {
+        const Grid<int> g { { 1, 2 }, { 3, 4 } };
+        Grid<int>::ConstRow row = g.row(0);
+        int sum = 0;
+        for (auto el : row)
+            { sum += el; }
+        return ts::test(sum == 3);
+    });
+    mark(suite).test([] {
+        Grid<int> g { { 1, 2 }, { 3, 4 } };
+        try {
+            (void)g.row(2);
+        } catch (std::exception &) {
+            return ts::test(true);
+        }
+        return ts::test(false);
+    });
+}
+
+void test_tiled_grid() {
+    TestSuite suite;
+    suite.hide_successes();
+    suite.start_series("TiledGrid");
+    // an awkward size, so that edge tiles are clipped
+    static auto make_numbered = [] {
+        TiledGrid<int, 4> g;
+        g.set_size(10, 7);
+        for (VectorI r; r != g.end_position(); r = g.next(r))
+            { g(r) = r.x + r.y*100; }
+        return g;
+    };
+    mark(suite).test([] {
+        auto g = make_numbered();
+        for (VectorI r; r != g.end_position(); r = g.next(r)) {
+            if (g(r) != r.x + r.y*100) return ts::test(false);
+        }
+        return ts::test(g.size2() == Size2{10, 7} && g.size() == 70);
+    });
+    mark(suite).test([] {
+        auto g = make_numbered();
+        return ts::test(   g.tile_count2() == Size2{3, 2}
+                        && g.tile(2, 1).size2() == Size2{2, 3}
+                        && g.tile(2, 1).origin() == VectorI(8, 4)
+                        && g.tile(2, 1)(1, 2) == 9 + 6*100);
+    });
+    mark(suite).test([] {
+        auto g = make_numbered();
+        int visited = 0;
+        bool all_match = true;
+        g.for_each_tile([&] (const TiledGrid<int, 4>::Tile & tile) {
+            for (int y = 0; y != tile.height(); ++y) {
+                auto row = tile.row(y);
+                for (std::size_t x = 0; x != row.size(); ++x) {
+                    auto r = tile.origin() + VectorI(int(x), y);
+                    all_match = all_match && row[x] == r.x + r.y*100;
+                    ++visited;
+                }
+            }
+        });
+        return ts::test(visited == 70 && all_match);
+    });
+    mark(suite).test([] {
+        auto g = make_numbered();
+        g.set_size(5, 9, -1);
+        return ts::test(   g(4, 6) == 4 + 600 && g(4, 8) == -1
+                        && g(0, 7) == -1 && !g.has_position(5, 0));
+    });
+    mark(suite).test([] {
+        auto g = make_numbered();
+        auto grid = g.to_grid();
+        TiledGrid<int, 4> back{grid};
+        return ts::test(   grid(9, 6) == 609 && grid.size2() == g.size2()
+                        && back(3, 5) == 503);
+    });
+    mark(suite).test([] {
+        auto g = make_numbered();
+        try {
+            (void)g(10, 0);
+        } catch (std::out_of_range &) {
+            return ts::test(true);
+        }
+        return ts::test(false);
+    });
+}
+
 void test_make_sub_grid() {
     using SizeG = Grid<int>::Size;
     using RectG = Rectangle<Grid<int>::IndexType>;
@@ -505,4 +655,682 @@ void test_sub_grid_iterator() {
     });
 }
 
+void test_sub_grid_rows() {
+    TestSuite suite;
+    suite.hide_successes();
+    suite.start_series("sub grid rows");
+    mark(suite).test([] {
+        Grid<int> p {
+            { 0, 1, 2, 3 },
+            { 4, 5, 6, 7 },
+            { 8, 9, 10, 11 }
+        };
+        auto subg = make_sub_grid(p, VectorI(1, 1), 2, 2);
+        auto row = subg.row(1);
+        return ts::test(   row.size() == 2 && row[0] == 9 && row[1] == 10
+                        && row.data() == &p(1, 2));
+    });
+    mark(suite).test([] {
+        Grid<int> p;
+        p.set_size(5, 5, 0);
+        auto subg = make_sub_grid(p, VectorI(1, 2), 3, 2);
+        for (int y = 0; y != subg.height(); ++y) {
+            auto row = subg.row(y);
+            std::fill(row.begin(), row.end(), 1);
+        }
+        return ts::test(   std::count(p.begin(), p.end(), 1) == 6
+                        && p(3, 3) == 1 && p(4, 3) == 0);
+    });
+    mark(suite).test([] {
+        const Grid<int> p { { 1, 2 }, { 3, 4 } };
+        auto subg = make_sub_grid(p, VectorI(1, 0), 1, 2);
+        return ts::test(subg.row(1)[0] == 4 && subg.element_unchecked(0, 0) == 2);
+    });
+    mark(suite).test([] {
+        Grid<int> p;
+        p.set_size(3, 3, 0);
+        auto subg = make_sub_grid(p, VectorI(1, 1));
+        try {
+            (void)subg.row(2);
+        } catch (std::out_of_range &) {
+            return ts::test(true);
+        }
+        return ts::test(false);
+    });
+    // walking forwards then backwards over row ends returns to the start
+    mark(suite).test([] {
+        Grid<int> p;
+        p.set_size(6, 6, 0);
+        auto subg = make_sub_grid(p, VectorI(1, 1), 3, 3);
+        int i = 0;
+        for (auto & el : subg)
+            { el = ++i; }
+        auto itr = subg.end();
+        for (int j = 0; j != 9; ++j)
+            { --itr; }
+        return ts::test(   itr == subg.begin() && *itr == 1
+                        && p(3, 3) == 9 && p(1, 2) == 4 && p(4, 1) == 0);
+    });
+}
+
+void test_grid_algorithms() {
+    TestSuite suite;
+    suite.hide_successes();
+    suite.start_series("grid algorithms");
+    mark(suite).test([] {
+        const Grid<int> src { { 1, 2 }, { 3, 4 } };
+        Grid<int> dst;
+        dst.set_size(4, 3, 0);
+        copy_sub_grid(src, make_sub_grid(dst, VectorI(1, 1), 2, 2));
+        return ts::test(   dst(1, 1) == 1 && dst(2, 2) == 4 && dst(0, 0) == 0
+                        && std::count(dst.begin(), dst.end(), 0) == 8);
+    });
+    mark(suite).test([] {
+        Grid<int> a;
+        a.set_size(2, 2, 0);
+        Grid<int> b;
+        b.set_size(3, 2, 0);
+        try {
+            copy_sub_grid(a, b);
+        } catch (std::invalid_argument &) {
+            return ts::test(true);
+        }
+        return ts::test(false);
+    });
+    // overlapping regions, destination after source (down and right)
+    mark(suite).test([] {
+        Grid<int> g {
+            { 0, 1, 2, 3 },
+            { 4, 5, 6, 7 },
+            { 8, 9, 10, 11 }
+        };
+        copy_sub_grid(make_sub_grid(g, VectorI(0, 0), 3, 2),
+                      make_sub_grid(g, VectorI(1, 1), 3, 2));
+        const Grid<int> expected {
+            { 0, 1, 2, 3 },
+            { 4, 0, 1, 2 },
+            { 8, 4, 5, 6 }
+        };
+        return ts::test(std::equal(g.begin(), g.end(), expected.begin()));
+    });
+    // overlapping regions, destination before source, non-trivial elements
+    mark(suite).test([] {
+        Grid<std::string> g {
+            { "a", "b", "c" },
+            { "d", "e", "f" }
+        };
+        copy_sub_grid(make_sub_grid(g, VectorI(1, 0), 2, 2),
+                      make_sub_grid(g, VectorI(0, 0), 2, 2));
+        return ts::test(   g(0, 0) == "b" && g(1, 0) == "c" && g(2, 0) == "c"
+                        && g(0, 1) == "e" && g(1, 1) == "f");
+    });
+    mark(suite).test([] {
+        Grid<int> g;
+        g.set_size(4, 4, 0);
+        fill(make_sub_grid(g, VectorI(1, 1), 2, 3), 7);
+        return ts::test(   std::count(g.begin(), g.end(), 7) == 6
+                        && g(2, 3) == 7 && g(3, 3) == 0);
+    });
+    mark(suite).test([] {
+        const Grid<int> src { { 1, 2, 3 }, { 4, 5, 6 } };
+        Grid<std::string> dst;
+        dst.set_size(3, 2);
+        transform_into(src, dst, [](int i) { return std::to_string(i*2); });
+        return ts::test(dst(0, 0) == "2" && dst(2, 1) == "12");
+    });
+    mark(suite).test([] {
+        const Grid<int> src { { 1, 2, 3 }, { 4, 5, 6 } };
+        auto h = flip_horizontal(src);
+        auto v = flip_vertical(src);
+        return ts::test(   h(0, 0) == 3 && h(2, 1) == 4
+                        && v(0, 0) == 4 && v(2, 1) == 3);
+    });
+    mark(suite).test([] {
+        const Grid<int> src { { 1, 2, 3 }, { 4, 5, 6 } };
+        // 4 1
+        // 5 2
+        // 6 3
+        auto cw = rotate_90_clockwise(src);
+        // 3 6
+        // 2 5
+        // 1 4
+        auto ccw = rotate_90_counterclockwise(src);
+        return ts::test(   cw.width() == 2 && cw.height() == 3
+                        && cw(0, 0) == 4 && cw(1, 0) == 1 && cw(0, 2) == 6
+                        && ccw(0, 0) == 3 && ccw(1, 0) == 6 && ccw(1, 2) == 4);
+    });
+    mark(suite).test([] {
+        Grid<int> g { { 0, 1, 2, 3 }, { 4, 5, 6, 7 } };
+        auto subg = make_sub_grid(g, VectorI(1, 0), 2, 2);
+        auto r = rotate_90_clockwise(rotate_90_clockwise(subg));
+        return ts::test(r(0, 0) == 6 && r(1, 1) == 1);
+    });
+}
+
+void test_chunked_grid() {
+    TestSuite suite;
+    suite.hide_successes();
+    suite.start_series("ChunkedGrid");
+    mark(suite).test([] {
+        const ChunkedGrid<int, 8> g{-1};
+        return ts::test(g(100, -100) == -1 && g.chunk_count() == 0);
+    });
+    mark(suite).test([] {
+        ChunkedGrid<int, 8> g;
+        g(3, 3) = 1;
+        g(7, 7) = 2;
+        g(8, 0) = 3;
+        const auto & cg = g;
+        return ts::test(   g.chunk_count() == 2 && cg(3, 3) == 1
+                        && cg(7, 7) == 2 && cg(8, 0) == 3 && cg(0, 0) == 0);
+    });
+    // negative positions belong to their own chunks
+    mark(suite).test([] {
+        using Grid8 = ChunkedGrid<int, 8>;
+        ChunkedGrid<int, 8> g;
+        g(-1, -1) = 5;
+        g(-8, 0) = 6;
+        g(-9, 0) = 7;
+        return ts::test(   g.chunk_count() == 3
+                        && Grid8::chunk_position_of(VectorI(-1, -1)) == VectorI(-1, -1)
+                        && Grid8::chunk_position_of(VectorI(-8, 7)) == VectorI(-1, 0)
+                        && Grid8::chunk_position_of(VectorI(-9, 8)) == VectorI(-2, 1)
+                        && g.find_chunk(VectorI(-1, -1))->element_unchecked(7, 7) == 5
+                        && g.find_chunk(VectorI(-2, 0))->element_unchecked(7, 0) == 7);
+    });
+    // references stay valid as more chunks are added
+    mark(suite).test([] {
+        ChunkedGrid<int, 4> g;
+        int & first = g(0, 0);
+        for (int i = 1; i != 200; ++i)
+            { g(i*4, -i*4) = i; }
+        first = 42;
+        return ts::test(std::as_const(g)(0, 0) == 42 && g.chunk_count() == 200);
+    });
+    mark(suite).test([] {
+        ChunkedGrid<int, 4> g;
+        auto view = g.make_sub_grid(VectorI(-2, -2), 5, 5);
+        for (int y = 0; y != view.height(); ++y) {
+            for (int x = 0; x != view.width(); ++x)
+                { view(x, y) = x + y*5; }
+        }
+        auto copy = std::as_const(g).make_sub_grid(VectorI(-3, -3), 7, 7).to_grid();
+        return ts::test(   g.chunk_count() == 4 && g(-2, -2) == 0
+                        && g(2, 2) == 24 && copy(0, 0) == 0 && copy(1, 1) == 0
+                        && copy(3, 4) == 17 && copy(5, 5) == 24 && copy(6, 6) == 0);
+    });
+    mark(suite).test([] {
+        ChunkedGrid<int, 4> g;
+        auto view = g.make_sub_grid(VectorI(0, 0), 4, 4);
+        try {
+            (void)view(4, 0);
+        } catch (std::out_of_range &) {
+            return ts::test(g.chunk_count() == 0);
+        }
+        return ts::test(false);
+    });
+    mark(suite).test([] {
+        ChunkedGrid<int, 4> g;
+        g(1, 1) = 1;
+        g(-1, 1) = 2;
+        auto copy = g;
+        copy(1, 1) = 3;
+        g.erase_chunk(VectorI(-1, 0));
+        int sum = 0;
+        copy.for_each_chunk([&sum] (const VectorI &, const Grid<int> & chunk)
+            { sum += std::accumulate(chunk.begin(), chunk.end(), 0); });
+        return ts::test(   g(1, 1) == 1 && g.chunk_count() == 1
+                        && copy.chunk_count() == 2 && sum == 5);
+    });
+}
+
+void test_grid_file() {
+    static constexpr const char * k_filename = ".test-grid-file.bin";
+    struct Cell { std::uint16_t tile; std::uint8_t flags; };
+    TestSuite suite;
+    suite.hide_successes();
+    suite.start_series("grid files");
+    mark(suite).test([] {
+        Grid<int> grid { { 1, 2, 3 }, { 4, 5, 6 } };
+        std::stringstream stream;
+        save_grid(stream, grid);
+        auto loaded = load_grid<int>(stream);
+        return ts::test(   loaded.width() == 3 && loaded.height() == 2
+                        && std::equal(grid.begin(), grid.end(), loaded.begin()));
+    });
+    mark(suite).test([] {
+        Grid<int> grid { { 1, 2 } };
+        std::stringstream stream;
+        save_grid(stream, grid);
+        try {
+            (void)load_grid<std::int16_t>(stream);
+        } catch (std::runtime_error &) {
+            return ts::test(true);
+        }
+        return ts::test(false);
+    });
+    mark(suite).test([] {
+        std::stringstream stream{"not a grid file, but long enough to hold "
+                                 "a whole header in any case"};
+        try {
+            (void)load_grid<int>(stream);
+        } catch (std::runtime_error &) {
+            return ts::test(true);
+        }
+        return ts::test(false);
+    });
+    mark(suite).test([] {
+        Grid<Cell> grid;
+        grid.set_size(37, 11);
+        for (int y = 0; y != grid.height(); ++y) {
+            for (int x = 0; x != grid.width(); ++x)
+                { grid(x, y) = Cell{std::uint16_t(x*100 + y), std::uint8_t(x ^ y)}; }
+        }
+        save_grid(k_filename, grid);
+        MappedGrid<Cell> mapped{k_filename};
+        bool all_equal = true;
+        for (int y = 0; y != grid.height(); ++y) {
+            for (int x = 0; x != grid.width(); ++x) {
+                all_equal =    all_equal && mapped(x, y).tile == grid(x, y).tile
+                            && mapped.row(y)[std::size_t(x)].flags == grid(x, y).flags;
+            }
+        }
+        auto copy = mapped.to_grid();
+        std::remove(k_filename);
+        return ts::test(   all_equal && mapped.size2() == grid.size2()
+                        && copy(36, 10).tile == 3610);
+    });
+    mark(suite).test([] {
+        save_grid(k_filename, Grid<int>{ { 1, 2 }, { 3, 4 } });
+        MappedGrid<int> mapped{k_filename};
+        std::remove(k_filename);
+        // mapping outlives the file's name
+        try {
+            (void)mapped(2, 0);
+        } catch (std::out_of_range &) {
+            return ts::test(mapped(1, 1) == 4);
+        }
+        return ts::test(false);
+    });
+    mark(suite).test([] {
+        try {
+            MappedGrid<int> mapped{".no-such-grid-file.bin"};
+        } catch (std::runtime_error &) {
+            return ts::test(true);
+        }
+        return ts::test(false);
+    });
+    // a header whose data size wraps to zero, must not pass for a huge grid
+    mark(suite).test([] {
+        struct Wide { char bytes[16]; };
+        GridFileHeader header;
+        header.element_size = sizeof(Wide);
+        header.width = header.height = 1 << 30;
+        std::stringstream stream;
+        write_grid_file_header(stream, header);
+        {
+        std::ofstream file{k_filename, std::ios::binary};
+        write_grid_file_header(file, header);
+        }
+        int failures = 0;
+        try {
+            MappedGrid<Wide> mapped{k_filename};
+        } catch (std::runtime_error &) {
+            ++failures;
+        }
+        std::remove(k_filename);
+        try {
+            (void)load_grid<Wide>(stream);
+        } catch (std::runtime_error &) {
+            ++failures;
+        }
+        return ts::test(failures == 2);
+    });
+    // dimensions whose element count overflows an int, with only one row
+    // of data following
+    mark(suite).test([] {
+        GridFileHeader header;
+        header.element_size = 1;
+        header.width  = 65536;
+        header.height = 65537;
+        std::stringstream stream;
+        write_grid_file_header(stream, header);
+        stream << std::string(65536, 'a');
+        {
+        std::ofstream file{k_filename, std::ios::binary};
+        file << stream.str();
+        }
+        int failures = 0;
+        try {
+            MappedGrid<char> mapped{k_filename};
+        } catch (std::runtime_error &) {
+            ++failures;
+        }
+        std::remove(k_filename);
+        try {
+            (void)load_grid<char>(stream);
+        } catch (std::runtime_error &) {
+            ++failures;
+        }
+        return ts::test(failures == 2);
+    });
+    // a seekable stream too short for its header is rejected before any
+    // rows are read (a gigabyte grid, with just one row present)
+    mark(suite).test([] {
+        GridFileHeader header;
+        header.element_size = 1;
+        header.width = header.height = 1 << 15;
+        std::stringstream stream;
+        write_grid_file_header(stream, header);
+        stream << std::string(1 << 15, 'a');
+        try {
+            (void)load_grid<char>(stream);
+        } catch (std::runtime_error &) {
+            return ts::test(true);
+        }
+        return ts::test(false);
+    });
+    // streams that cannot seek, have their grids grown as rows arrive
+    mark(suite).test([] {
+        class UnseekableBuffer final : public std::stringbuf {
+        public:
+            using std::stringbuf::stringbuf;
+        private:
+            pos_type seekoff(off_type, std::ios::seekdir, std::ios::openmode) override
+                { return pos_type(off_type(-1)); }
+            pos_type seekpos(pos_type, std::ios::openmode) override
+                { return pos_type(off_type(-1)); }
+        };
+        std::stringstream saved;
+        save_grid(saved, Grid<int>{ { 1, 2, 3 }, { 4, 5, 6 } });
+        UnseekableBuffer whole_buffer{saved.str()};
+        std::istream whole{&whole_buffer};
+        auto grid = load_grid<int>(whole);
+
+        GridFileHeader header;
+        header.element_size = 1;
+        header.width = header.height = 1 << 15;
+        std::stringstream truncated;
+        write_grid_file_header(truncated, header);
+        truncated << std::string(1 << 15, 'a');
+        UnseekableBuffer truncated_buffer{truncated.str()};
+        std::istream truncated_in{&truncated_buffer};
+        try {
+            (void)load_grid<char>(truncated_in);
+        } catch (std::runtime_error &) {
+            return ts::test(   grid.width() == 3 && grid.height() == 2
+                            && grid(2, 1) == 6);
+        }
+        return ts::test(false);
+    });
+}
+
+void test_snapshot_grid() {
+    TestSuite suite;
+    suite.hide_successes();
+    suite.start_series("SnapshotGrid");
+    mark(suite).test([] {
+        SnapshotGrid<int, 4> grid{10, 6, 1};
+        grid(9, 5) = 2;
+        const auto & cgrid = grid;
+        return ts::test(   cgrid(0, 0) == 1 && cgrid(9, 5) == 2
+                        && grid.shared_chunk_count() == 0);
+    });
+    mark(suite).test([] {
+        SnapshotGrid<int, 4> grid{10, 6};
+        auto snapshot = grid.snapshot();
+        grid(1, 1) = 5;
+        grid(9, 5) = 6;
+        // 3x2 chunks, two of them copied by the writes
+        return ts::test(   snapshot(1, 1) == 0 && snapshot(9, 5) == 0
+                        && grid(1, 1) == 5 && grid.shared_chunk_count() == 4);
+    });
+    mark(suite).test([] {
+        SnapshotGrid<int, 4> grid{5, 5};
+        grid(4, 4) = 1;
+        auto first = grid.snapshot();
+        grid(4, 4) = 2;
+        auto second = grid.snapshot();
+        grid(4, 4) = 3;
+        return ts::test(first(4, 4) == 1 && second(4, 4) == 2 && grid(4, 4) == 3);
+    });
+    // once snapshots are gone, chunks are written in place again
+    mark(suite).test([] {
+        SnapshotGrid<int, 4> grid{8, 8};
+        int * before = &grid(0, 0);
+        {
+            auto snapshot = grid.snapshot();
+            (void)snapshot;
+        }
+        grid(0, 0) = 1;
+        // (read through const, so that reading does not write)
+        const auto & cgrid = grid;
+        return ts::test(before == &cgrid(0, 0) && grid.shared_chunk_count() == 0);
+    });
+    // a simulation thread writes and publishes snapshots, while a render
+    // thread reads (and lets go of) them; no snapshot may see a later write
+    mark(suite).test([] {
+        static constexpr const int k_generations = 300;
+        using Snapshot = SnapshotGrid<int, 4>::Snapshot;
+        SnapshotGrid<int, 4> grid{16, 16};
+        std::mutex mutex;
+        Snapshot published;
+        std::atomic_bool done = false;
+        std::atomic_bool all_consistent = true;
+        std::thread reader{[&] {
+            int last_generation = 0;
+            while (!done) {
+                Snapshot snapshot;
+                {
+                std::lock_guard lock{mutex};
+                snapshot = published;
+                }
+                if (snapshot.width() == 0) continue;
+                const int generation = snapshot(0, 0);
+                for (int y = 0; y != snapshot.height(); ++y) {
+                    for (int x = 0; x != snapshot.width(); ++x) {
+                        if (snapshot(x, y) != generation) all_consistent = false;
+                    }
+                }
+                if (generation < last_generation) all_consistent = false;
+                last_generation = generation;
+            }
+        }};
+        for (int generation = 1; generation != k_generations + 1; ++generation) {
+            for (int y = 0; y != grid.height(); ++y) {
+                for (int x = 0; x != grid.width(); ++x)
+                    { grid(x, y) = generation; }
+            }
+            auto snapshot = grid.snapshot();
+            std::lock_guard lock{mutex};
+            published = std::move(snapshot);
+        }
+        done = true;
+        reader.join();
+        return ts::test(all_consistent && grid(15, 15) == k_generations);
+    });
+    mark(suite).test([] {
+        Grid<int> source { { 1, 2, 3 }, { 4, 5, 6 }, { 7, 8, 9 } };
+        SnapshotGrid<int, 2> grid{source};
+        auto copy = grid.snapshot().to_grid();
+        return ts::test(std::equal(source.begin(), source.end(), copy.begin()));
+    });
+    mark(suite).test([] {
+        SnapshotGrid<int, 2> grid{3, 3};
+        auto snapshot = grid.snapshot();
+        try {
+            (void)snapshot(3, 0);
+        } catch (std::out_of_range &) {
+            return ts::test(true);
+        }
+        return ts::test(false);
+    });
+}
+
+void test_compressed_grid() {
+    using Encoding = CompressedGrid<int>::Encoding;
+    TestSuite suite;
+    suite.hide_successes();
+    suite.start_series("CompressedGrid");
+    // mostly long runs, of many distinct values
+    mark(suite).test([] {
+        Grid<int> grid;
+        grid.set_size(300, 4, 0);
+        for (int x = 0; x != 300; ++x)
+            { grid(x, 1) = x; }
+        std::fill(&grid(100, 2), &grid(200, 2), 7);
+        CompressedGrid<int> compressed{grid};
+        bool all_equal = true;
+        for (int y = 0; y != grid.height(); ++y) {
+            for (int x = 0; x != grid.width(); ++x)
+                { all_equal = all_equal && compressed(x, y) == grid(x, y); }
+        }
+        return ts::test(   all_equal && compressed.encoding() == Encoding::run_length
+                        && compressed.storage_size() < grid.size()*sizeof(int));
+    });
+    // few values, but no long runs
+    mark(suite).test([] {
+        Grid<int> grid;
+        grid.set_size(33, 9);
+        for (int y = 0; y != grid.height(); ++y) {
+            for (int x = 0; x != grid.width(); ++x)
+                { grid(x, y) = (x*7 + y*3) % 3 - 5; }
+        }
+        CompressedGrid<int> compressed{grid};
+        auto copy = compressed.to_grid();
+        return ts::test(   compressed.encoding() == Encoding::palette
+                        && std::equal(grid.begin(), grid.end(), copy.begin())
+                        && compressed(32, 8) == grid(32, 8));
+    });
+    mark(suite).test([] {
+        Grid<int> grid { { 4, 4, 4 }, { 4, 4, 4 } };
+        CompressedGrid<int> compressed{grid, Encoding::palette};
+        return ts::test(compressed(2, 1) == 4 && compressed.storage_size() == sizeof(int));
+    });
+    mark(suite).test([] {
+        Grid<int> grid { { 1, 1, 2, 2, 2, 3 } };
+        bool rows_match = true;
+        std::vector<VectorI> runs;
+        for (auto encoding : { Encoding::run_length, Encoding::palette }) {
+            CompressedGrid<int> compressed{grid, encoding};
+            auto row = compressed.row(0);
+            rows_match =    rows_match && row.size() == 6
+                         && std::equal(row.begin(), row.end(), grid.begin());
+            compressed.for_each_run(0, [&runs] (int beg, int end, int)
+                { runs.emplace_back(beg, end); });
+        }
+        return ts::test(   rows_match && runs.size() == 6
+                        && runs[1] == VectorI(2, 5) && runs[4] == VectorI(2, 5));
+    });
+    mark(suite).test([] {
+        Grid<int> grid;
+        grid.set_size(30, 30);
+        std::iota(grid.begin(), grid.end(), 0);
+        try {
+            CompressedGrid<int> compressed{grid, Encoding::palette};
+        } catch (std::invalid_argument &) {
+            return ts::test(true);
+        }
+        return ts::test(false);
+    });
+    mark(suite).test([] {
+        Grid<bool> grid;
+        grid.set_size(10, 2, false);
+        grid(3, 1) = true;
+        CompressedGrid<bool> compressed{grid};
+        try {
+            (void)compressed(10, 0);
+        } catch (std::out_of_range &) {
+            return ts::test(compressed(3, 1) && !compressed(4, 1));
+        }
+        return ts::test(false);
+    });
+}
+
+void test_packed_grid() {
+    TestSuite suite;
+    suite.hide_successes();
+    suite.start_series("BitGrid and PackedGrid");
+    mark(suite).test([] {
+        BitGrid grid{70, 3};
+        grid(0, 0) = 1;
+        grid(69, 1) = 1;
+        grid(64, 2) = 1;
+        grid(64, 2) = 0;
+        const auto & cgrid = grid;
+        return ts::test(   cgrid(69, 1) == 1 && cgrid(64, 2) == 0
+                        && grid.popcount() == 2 && grid.words_per_row() == 2);
+    });
+    mark(suite).test([] {
+        BitGrid a{100, 2};
+        BitGrid b{100, 2};
+        a(3, 0) = 1; a(99, 1) = 1; a(50, 1) = 1;
+        b(3, 0) = 1; b(98, 1) = 1; b(50, 1) = 1;
+        auto both = a & b;
+        auto either = a | b;
+        auto one = a ^ b;
+        return ts::test(   both.popcount() == 2 && either.popcount() == 4
+                        && one.popcount() == 2 && one(99, 1) && one(98, 1));
+    });
+    // unused bits at each row's end stay clear
+    mark(suite).test([] {
+        BitGrid grid{5, 2};
+        auto inverted = ~grid;
+        return ts::test(inverted.popcount() == 10 && (~inverted).popcount() == 0);
+    });
+    mark(suite).test([] {
+        BitGrid grid{130, 3};
+        grid(129, 0) = 1;
+        grid(64, 2) = 1;
+        auto first  = grid.find_first_set();
+        auto second = grid.find_first_set(VectorI(first.x + 1, first.y));
+        auto third  = grid.find_first_set(VectorI(second.x + 1, second.y));
+        return ts::test(   first == VectorI(129, 0) && second == VectorI(64, 2)
+                        && third == grid.end_position());
+    });
+    mark(suite).test([] {
+        BitGrid grid{100, 3};
+        grid(0, 0) = 1;
+        grid(63, 1) = 1;
+        grid(99, 1) = 1;
+        auto right = grid.shifted(1, 0);
+        auto left  = grid.shifted(-64, 1);
+        auto down  = grid.shifted(0, 2);
+        return ts::test(   right(1, 0) && right(64, 1) && right.popcount() == 2
+                        && left(35, 0) == 0 && left(35, 2) && left.popcount() == 1
+                        && down(0, 2) && down.popcount() == 1);
+    });
+    mark(suite).test([] {
+        BitGrid a{2, 2};
+        BitGrid b{3, 2};
+        try {
+            a |= b;
+        } catch (std::invalid_argument &) {
+            return ts::test(true);
+        }
+        return ts::test(false);
+    });
+    mark(suite).test([] {
+        enum class Pixel { clear, dim, bright, white };
+        Grid<Pixel> source {
+            { Pixel::white, Pixel::clear },
+            { Pixel::dim  , Pixel::bright }
+        };
+        auto packed = PackedGrid<2>::from_grid(source);
+        auto back = packed.to_grid<Pixel>();
+        return ts::test(   packed(0, 0) == 3 && packed(1, 1) == 2
+                        && std::equal(source.begin(), source.end(), back.begin()));
+    });
+    mark(suite).test([] {
+        PackedGrid<4> grid{20, 2, 9};
+        grid(17, 1) = 0;
+        auto moved = grid.shifted(3, 0);
+        auto first_clear = (~grid).find_first_set();
+        return ts::test(   grid(19, 0) == 9 && moved(2, 0) == 0 && moved(3, 0) == 9
+                        && moved(19, 1) == 9 && moved(18, 1) == 9 && moved(17, 1) == 9
+                        && moved(16, 1) == 9 && first_clear == VectorI(0, 0)
+                        && grid.find_first_set(VectorI(17, 1)) == VectorI(18, 1));
+    });
+}
+
 } // end of <anonymous> namespace
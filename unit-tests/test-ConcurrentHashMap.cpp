@@ -0,0 +1,167 @@
+/****************************************************************************
+
+    MIT License
+
+    Copyright (c) 2023 Aria Janke
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+
+*****************************************************************************/
+
+
+#include <ariajanke/cul/TreeTestSuite.hpp>
+#include <ariajanke/cul/ConcurrentHashMap.hpp>
+
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+using namespace cul;
+using namespace tree_ts;
+
+#define mark_it mark_source_position(__LINE__, __FILE__).it
+
+constexpr const std::size_t k_empty_key = 0;
+constexpr const std::size_t k_thread_count = 4;
+constexpr const std::size_t k_keys_per_thread = 2000;
+
+using IntConcurrentHashMap = ConcurrentHashMap<std::size_t, int>;
+
+// runs a function on several threads at once, each given its index
+template <typename Func>
+void run_on_threads(Func && f) {
+    std::vector<std::thread> threads;
+    for (std::size_t i = 0; i != k_thread_count; ++i)
+        { threads.emplace_back([&f, i] { f(i); }); }
+    for (auto & thread : threads)
+        { thread.join(); }
+}
+
+} // end of <anonymous> namespace
+
+auto x = [] {
+
+describe("ConcurrentHashMap")([] {
+    IntConcurrentHashMap chmap{k_empty_key};
+    mark_it("finds nothing when empty", [&] {
+        return test_that(!chmap.find(std::size_t(1)).has_value());
+    }).
+    mark_it("finds an inserted element", [&] {
+        chmap.insert_or_assign(std::size_t(1), 10);
+        return test_that(chmap.find(std::size_t(1)) == 10);
+    }).
+    mark_it("insert_or_assign, assigns over an existing element", [&] {
+        bool first = chmap.insert_or_assign(std::size_t(1), 10);
+        bool second = chmap.insert_or_assign(std::size_t(1), 20);
+        return test_that(   first && !second && chmap.size() == 1
+                         && chmap.find(std::size_t(1)) == 20);
+    }).
+    mark_it("erase removes only the given element", [&] {
+        chmap.insert_or_assign(std::size_t(1), 10);
+        chmap.insert_or_assign(std::size_t(2), 20);
+        bool erased = chmap.erase(std::size_t(1));
+        bool erased_again = chmap.erase(std::size_t(1));
+        return test_that(   erased && !erased_again
+                         && !chmap.find(std::size_t(1)).has_value()
+                         && chmap.find(std::size_t(2)) == 20);
+    }).
+    mark_it("visit may change an element in place", [&] {
+        chmap.insert_or_assign(std::size_t(1), 10);
+        bool visited = chmap.visit(std::size_t(1), [] (int & el) { el += 5; });
+        return test_that(visited && chmap.find(std::size_t(1)) == 15);
+    }).
+    mark_it("spreads elements over many shards", [&] {
+        for (std::size_t i = 1; i != 1001; ++i)
+            { chmap.insert_or_assign(i, int(i)); }
+        std::size_t used_shards = 0;
+        std::size_t total = 0;
+        chmap.for_each_shard([&] (const IntConcurrentHashMap::ShardMap & map) {
+            used_shards += map.is_empty() ? 0 : 1;
+            total += map.size();
+        });
+        return test_that(   used_shards == IntConcurrentHashMap::k_shard_count
+                         && total == 1000);
+    }).
+    mark_it("clear removes all elements", [&] {
+        for (std::size_t i = 1; i != 101; ++i)
+            { chmap.insert_or_assign(i, int(i)); }
+        chmap.clear();
+        return test_that(chmap.size() == 0);
+    });
+});
+
+describe("ConcurrentHashMap, used by many threads")([] {
+    IntConcurrentHashMap chmap{k_empty_key};
+    mark_it("keeps every element inserted by every thread", [&] {
+        run_on_threads([&chmap] (std::size_t thread_index) {
+            auto first = 1 + thread_index*k_keys_per_thread;
+            for (auto i = first; i != first + k_keys_per_thread; ++i)
+                { chmap.insert_or_assign(i, int(i)); }
+        });
+        bool all_found = true;
+        for (std::size_t i = 1; i != 1 + k_thread_count*k_keys_per_thread; ++i)
+            { all_found = all_found && chmap.find(i) == int(i); }
+        return test_that(   all_found
+                         && chmap.size() == k_thread_count*k_keys_per_thread);
+    }).
+    mark_it("counts correctly, with threads updating shared keys", [&] {
+        for (std::size_t i = 1; i != 65; ++i)
+            { chmap.insert_or_assign(i, 0); }
+        run_on_threads([&chmap] (std::size_t) {
+            for (std::size_t n = 0; n != k_keys_per_thread; ++n)
+                { chmap.visit(1 + n % 64, [] (int & el) { ++el; }); }
+        });
+        int total = 0;
+        chmap.for_each_shard([&total] (const IntConcurrentHashMap::ShardMap & map) {
+            for (auto pair : map)
+                { total += pair.second; }
+        });
+        return test_that(total == int(k_thread_count*k_keys_per_thread));
+    }).
+    mark_it("readers see each key either missing or whole, while others "
+            "insert and erase", [&]
+    {
+        // writers insert then erase their own keys, readers check that
+        // anything found has the value written for it
+        std::vector<int> bad_reads(k_thread_count, 0);
+        run_on_threads([&chmap, &bad_reads] (std::size_t thread_index) {
+            for (std::size_t n = 0; n != k_keys_per_thread; ++n) {
+                auto key = 1 + n % 256;
+                if (thread_index % 2 == 0) {
+                    chmap.insert_or_assign(key, int(key));
+                    chmap.erase(key);
+                } else if (auto found = chmap.find(key)) {
+                    bad_reads[thread_index] += *found == int(key) ? 0 : 1;
+                }
+            }
+        });
+        int total_bad = 0;
+        for (auto bad : bad_reads)
+            { total_bad += bad; }
+        return test_that(total_bad == 0 && chmap.size() == 0);
+    });
+});
+
+return [] {};
+
+} ();
+
+int main() { return cul::tree_ts::run_tests(); }
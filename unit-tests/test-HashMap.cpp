@@ -27,8 +27,14 @@
 #include <ariajanke/cul/TreeTestSuite.hpp>
 #include <ariajanke/cul/HashMap.hpp>
 
+#include <map>
 #include <memory>
+#include <memory_resource>
+#include <random>
 #include <set>
+#include <string>
+#include <string_view>
+#include <vector>
 
 namespace {
 
@@ -57,14 +63,97 @@ using SharedPtr = std::shared_ptr<T>;
 
 using std::make_shared, std::make_unique;
 
+template <typename PolicyT, typename KeyT, typename ElementT>
+using PolicyHashMap = HashMap
+    <KeyT, ElementT, std::hash<KeyT>, std::equal_to<void>,
+     std::allocator<std::byte>, PolicyT>;
+
+struct DenseTestPolicy final : public HashMapDefaultPolicy {
+    using MaxLoadFactor = std::ratio<7, 8>;
+    using MinLoadFactor = std::ratio<1, 8>;
+};
+
+struct RobinHoodControlBytesTestPolicy final : public HashMapRobinHoodPolicy {
+    static constexpr const bool k_use_control_bytes = true;
+};
+
+struct AllOptionsTestPolicy final : public HashMapRobinHoodPolicy {
+    static constexpr const bool k_use_control_bytes = true;
+    static constexpr const bool k_store_hashes = true;
+};
+
+struct IncrementalTestPolicy final : public HashMapDefaultPolicy {
+    static constexpr const std::size_t k_incremental_rehash_step = 1;
+};
+
+struct IncrementalAllOptionsTestPolicy final : public HashMapRobinHoodPolicy {
+    static constexpr const bool k_use_control_bytes = true;
+    static constexpr const bool k_store_hashes = true;
+    static constexpr const std::size_t k_incremental_rehash_step = 2;
+};
+
+// counts every call, so tests may check when keys are (re)hashed
+struct CountingHash final {
+    static int call_count;
+
+    std::size_t operator () (std::size_t key) const {
+        ++call_count;
+        return std::hash<std::size_t>{}(key);
+    }
+};
+
+/* static */ int CountingHash::call_count = 0;
+
+// an arena which keeps track of what's still allocated from it
+class CountingResource final : public std::pmr::memory_resource {
+public:
+    int allocation_count() const { return m_allocation_count; }
+
+    std::size_t bytes_in_use() const { return m_bytes_in_use; }
+
+private:
+    void * do_allocate(std::size_t bytes, std::size_t alignment) final {
+        ++m_allocation_count;
+        m_bytes_in_use += bytes;
+        return m_arena.allocate(bytes, alignment);
+    }
+
+    void do_deallocate(void *, std::size_t bytes, std::size_t) final
+        { m_bytes_in_use -= bytes; }
+
+    bool do_is_equal(const std::pmr::memory_resource & rhs) const noexcept final
+        { return this == &rhs; }
+
+    std::pmr::monotonic_buffer_resource m_arena;
+    int m_allocation_count = 0;
+    std::size_t m_bytes_in_use = 0;
+};
+
+struct HugePagesTestPolicy final : public HashMapControlBytesPolicy {
+    static constexpr const bool k_align_for_huge_pages = true;
+};
+
+struct EmptyElement {};
+
+// empty elements take no room in buckets
+static_assert(sizeof(HashMapBucketDefinitions
+    <std::size_t, EmptyElement, std::allocator<std::size_t>,
+     std::equal_to<void>>::Bucket) == sizeof(std::size_t),
+    "Buckets for empty element types must be no larger than their keys");
+
+std::string with_policy(const char * description, const char * policy_name)
+    { return std::string{description} + " (" + policy_name + ")"; }
+
 struct A final {
 public:
     static const int & instance_count() { return s_instance_count; }
 
     static const int & copy_count() { return s_copy_count; }
 
+    static const int & move_count() { return s_move_count; }
+
     static void reset_counts()
-        { s_instance_count = s_copy_count = 0; }
+        { s_instance_count = s_copy_count = s_move_count = 0; }
 
     A() { ++s_instance_count; }
 
@@ -73,7 +162,10 @@ public:
         ++s_instance_count;
     }
 
-    A(A && a_): m_id(a_.m_id) { ++s_instance_count; }
+    A(A && a_): m_id(a_.m_id) {
+        ++s_move_count;
+        ++s_instance_count;
+    }
 
     A & operator = (const A & a_) {
         ++s_copy_count;
@@ -95,6 +187,7 @@ private:
     static int s_id_counter;
     static int s_instance_count;
     static int s_copy_count;
+    static int s_move_count;
     int m_id = s_id_counter++;
 };
 
@@ -103,31 +196,392 @@ class B final {};
 /* private static */ int A::s_id_counter = 0;
 /* private static */ int A::s_instance_count = 0;
 /* private static */ int A::s_copy_count = 0;
+/* private static */ int A::s_move_count = 0;
+
+template <typename PolicyT>
+void describe_hash_map(const char * policy_name);
 
 } // end of <anonymous> namespace
 
 auto x = [] {
+    describe_hash_map<HashMapDefaultPolicy>("default policy");
+    describe_hash_map<HashMapControlBytesPolicy>("control bytes");
+    describe_hash_map<DenseTestPolicy>("7/8 load factor");
+    describe_hash_map<HashMapRobinHoodPolicy>("robin hood");
+    describe_hash_map<RobinHoodControlBytesTestPolicy>
+        ("robin hood, control bytes");
+    describe_hash_map<HashMapStoredHashesPolicy>("stored hashes");
+    describe_hash_map<AllOptionsTestPolicy>("all options");
+    describe_hash_map<IncrementalTestPolicy>("incremental rehash");
+    describe_hash_map<IncrementalAllOptionsTestPolicy>
+        ("incremental rehash, all options");
 
-static constexpr const std::size_t empty_key = 0;
-static constexpr const std::size_t a_key = 1;
-static constexpr const std::size_t b_key = 2;
-static constexpr const std::size_t c_key = 3;
-static constexpr const std::size_t d_key = b_key + 8;
+describe("HashMap load factors")([] {
+    static constexpr const std::size_t k_empty_key = 0;
+    PolicyHashMap<DenseTestPolicy, std::size_t, int> hmap{k_empty_key};
+    HashMap<std::size_t, int> default_hmap{k_empty_key};
+    auto insert_and_erase = [](auto & hmap_) {
+        for (std::size_t i = 1; i != 101; ++i)
+            { hmap_.insert(i, int(i)); }
+        for (std::size_t i = 1; i != 96; ++i)
+            { hmap_.erase(hmap_.find(i)); }
+    };
+    auto all_remain = [](const auto & hmap_) {
+        for (std::size_t i = 96; i != 101; ++i) {
+            auto itr = hmap_.find(i);
+            if (itr == hmap_.end() || itr->second != int(i))
+                { return false; }
+        }
+        return true;
+    };
+    mark_it("reserve uses the maximum load factor", [&] {
+        hmap.reserve(7);
+        return test_that(hmap.bucket_count() == 8 && hmap.capacity() == 7);
+    }).
+    mark_it("shrink_to_fit reduces bucket count, keeping elements", [&] {
+        insert_and_erase(hmap);
+        auto old_bucket_count = hmap.bucket_count();
+        hmap.shrink_to_fit();
+        return test_that(   hmap.bucket_count() < old_bucket_count
+                         && hmap.size() == 5 && all_remain(hmap));
+    }).
+    mark_it("shrink_to_fit on an empty map releases all buckets", [&] {
+        hmap.reserve(100);
+        hmap.shrink_to_fit();
+        return test_that(hmap.bucket_count() == 0);
+    }).
+    mark_it("under minimum load factor, an insertion shrinks the map", [&] {
+        insert_and_erase(hmap);
+        auto old_bucket_count = hmap.bucket_count();
+        hmap.insert(1000, 1000);
+        return test_that(   hmap.bucket_count() < old_bucket_count
+                         && all_remain(hmap) && hmap.find(1000) != hmap.end());
+    }).
+    mark_it("default policy, does not shrink on its own", [&] {
+        insert_and_erase(default_hmap);
+        auto old_bucket_count = default_hmap.bucket_count();
+        default_hmap.insert(1000, 1000);
+        return test_that(default_hmap.bucket_count() == old_bucket_count);
+    });
+});
 
+describe("HashMap probe lengths")([] {
+    static constexpr const std::size_t k_empty_key = 0;
+    // std::hash is the identity for integers here, so multiples of the
+    // bucket count all want bucket zero
+    HashMap<std::size_t, int> hmap{k_empty_key};
+    PolicyHashMap<HashMapRobinHoodPolicy, std::size_t, int>
+        robin_hood_hmap{k_empty_key};
+    auto insert_random = [](auto & hmap_) {
+        std::mt19937 rng{0x5EED};
+        std::uniform_int_distribution<std::size_t> dist{1, 4096};
+        hmap_.reserve(200);
+        while (hmap_.size() != 200)
+            { hmap_.insert(dist(rng), 0); }
+    };
+    mark_it("empty map has zero probe lengths", [&] {
+        return test_that(   hmap.max_probe_length() == 0
+                         && hmap.average_probe_length() == 0.);
+    }).
+    mark_it("colliding keys have increasing probe lengths", [&] {
+        hmap.reserve(10);
+        auto n = hmap.bucket_count();
+        for (std::size_t i = 1; i != 4; ++i)
+            { hmap.insert(i*n, 0); }
+        return test_that(   hmap.max_probe_length() == 2
+                         && hmap.average_probe_length() == 1.);
+    }).
+    mark_it("erasing a colliding key shortens the others' probes", [&] {
+        hmap.reserve(10);
+        auto n = hmap.bucket_count();
+        for (std::size_t i = 1; i != 4; ++i)
+            { hmap.insert(i*n, 0); }
+        hmap.erase(hmap.find(n));
+        return test_that(   hmap.max_probe_length() == 1
+                         && hmap.find(2*n) != hmap.end()
+                         && hmap.find(3*n) != hmap.end());
+    }).
+    mark_it("histogram counts elements by probe length", [&] {
+        hmap.reserve(10);
+        auto n = hmap.bucket_count();
+        for (std::size_t i = 1; i != 4; ++i)
+            { hmap.insert(i*n, 0); }
+        hmap.insert(1 + n*4, 0);
+        // 1 + 4n wants bucket 1, taken by 2n
+        auto histogram = hmap.probe_length_histogram();
+        return test_that(histogram == std::vector<std::size_t>{1, 1, 2});
+    }).
+    mark_it("robin hood displaces elements closer to their ideal bucket", [&] {
+        robin_hood_hmap.reserve(10);
+        auto n = robin_hood_hmap.bucket_count();
+        // 1 is placed in bucket 1, then pushed back by 2n's arrival
+        robin_hood_hmap.insert(n, 0);
+        robin_hood_hmap.insert(1, 0);
+        robin_hood_hmap.insert(2*n, 0);
+        return test_that(   robin_hood_hmap.max_probe_length() == 1
+                         && robin_hood_hmap.find(1) != robin_hood_hmap.end()
+                         && robin_hood_hmap.find(2*n) != robin_hood_hmap.end());
+    }).
+    mark_it("robin hood has the same average, but no longer maximum, "
+            "probe length", [&]
+    {
+        PolicyHashMap<DenseTestPolicy, std::size_t, int> first_fit_hmap
+            {k_empty_key};
+        insert_random(first_fit_hmap);
+        insert_random(robin_hood_hmap);
+        if (first_fit_hmap.bucket_count() != robin_hood_hmap.bucket_count())
+            { return test_that(false); }
+        auto avg_diff =   first_fit_hmap.average_probe_length()
+                        - robin_hood_hmap.average_probe_length();
+        return test_that(   magnitude(avg_diff) < 1e-9
+                         &&    robin_hood_hmap.max_probe_length()
+                            <= first_fit_hmap.max_probe_length());
+    });
+});
+
+describe("HashMap stored hashes")([] {
+    static constexpr const std::size_t k_empty_key = 0;
+    using StoredHashMap = HashMap
+        <std::size_t, A, CountingHash, std::equal_to<void>,
+         std::allocator<std::byte>, HashMapStoredHashesPolicy>;
+    StoredHashMap hmap{k_empty_key};
+    for (std::size_t i = 1; i != 51; ++i)
+        { hmap.emplace(i); }
+    mark_it("rehashing does not call the hasher", [&] {
+        CountingHash::call_count = 0;
+        hmap.rehash(hmap.bucket_count()*4);
+        return test_that(CountingHash::call_count == 0);
+    }).
+    mark_it("rehashing moves each element exactly once", [&] {
+        A::reset_counts();
+        hmap.rehash(hmap.bucket_count()*4);
+        return test_that(A::move_count() == 50 && A::copy_count() == 0);
+    }).
+    mark_it("all elements are found after rehashing", [&] {
+        hmap.rehash(hmap.bucket_count()*4);
+        for (std::size_t i = 1; i != 51; ++i) {
+            if (hmap.find(i) == hmap.end())
+                { return test_that(false); }
+        }
+        return test_that(hmap.size() == 50);
+    }).
+    mark_it("shrinking does not call the hasher", [&] {
+        for (std::size_t i = 1; i != 46; ++i)
+            { hmap.erase(hmap.find(i)); }
+        CountingHash::call_count = 0;
+        hmap.shrink_to_fit();
+        return test_that(CountingHash::call_count == 0);
+    });
+});
+
+describe("HashMap incremental rehash")([] {
+    static constexpr const std::size_t k_empty_key = 0;
+    PolicyHashMap<IncrementalTestPolicy, std::size_t, int> hmap{k_empty_key};
+    // even keys fill every other bucket, so that each cluster is one
+    // element, and rehashing takes many insertions
+    auto key_of = [](std::size_t i) { return i*2; };
+    // inserts (at least a hundred elements) until the map has just started
+    // an incremental rehash
+    auto fill_until_rehashing = [key_of](auto & hmap_) {
+        std::size_t i = 1;
+        for (; (i <= 100 || !hmap_.is_rehashing()) && i != 1000; ++i)
+            { hmap_.insert(key_of(i), int(i)); }
+        return i - 1;
+    };
+    auto all_found = [key_of](const auto & hmap_, std::size_t last) {
+        for (std::size_t i = 1; i <= last; ++i) {
+            auto itr = hmap_.find(key_of(i));
+            if (itr == hmap_.end() || itr->second != int(i))
+                { return false; }
+        }
+        return true;
+    };
+    mark_it("growing starts an incremental rehash", [&] {
+        fill_until_rehashing(hmap);
+        return test_that(hmap.is_rehashing());
+    }).
+    mark_it("finds all elements while rehashing", [&] {
+        auto last = fill_until_rehashing(hmap);
+        return test_that(all_found(hmap, last));
+    }).
+    mark_it("iterates each element exactly once while rehashing", [&] {
+        auto last = fill_until_rehashing(hmap);
+        std::set<std::size_t> seen;
+        std::size_t count = 0;
+        for (auto pair : hmap) {
+            seen.insert(pair.first);
+            ++count;
+        }
+        return test_that(count == last && seen.size() == last);
+    }).
+    mark_it("does not insert a key still in the old buckets", [&] {
+        auto last = fill_until_rehashing(hmap);
+        std::size_t rejected = 0;
+        for (std::size_t i = 1; i <= last; ++i)
+            { rejected += hmap.insert(key_of(i), 0).success ? 0 : 1; }
+        return test_that(rejected == last && hmap.size() == last);
+    }).
+    mark_it("erasing while rehashing, leaves other elements", [&] {
+        auto last = fill_until_rehashing(hmap);
+        for (std::size_t i = 1; i <= last; i += 2)
+            { hmap.erase(hmap.find(key_of(i))); }
+        for (std::size_t i = 2; i <= last; i += 2) {
+            if (hmap.find(key_of(i)) == hmap.end())
+                { return test_that(false); }
+        }
+        return test_that(   hmap.find(key_of(1)) == hmap.end()
+                         && hmap.size() == last / 2);
+    }).
+    mark_it("later insertions finish rehashing", [&] {
+        auto last = fill_until_rehashing(hmap);
+        auto i = last + 1;
+        for (; hmap.is_rehashing(); ++i)
+            { hmap.insert(key_of(i), int(i)); }
+        return test_that(   i - last > 1 && all_found(hmap, i - 1)
+                         && hmap.size() == i - 1);
+    }).
+    mark_it("finish_rehash migrates all remaining elements", [&] {
+        auto last = fill_until_rehashing(hmap);
+        hmap.finish_rehash();
+        return test_that(!hmap.is_rehashing() && all_found(hmap, last));
+    });
+});
+
+describe("HashMap heterogeneous lookup")([] {
+    using namespace std::string_view_literals;
+    HashMap<std::string, int> hmap{""};
+    HashMap<std::string, int, TransparentStringHash> transparent_hmap{""};
+    const std::string long_key = "a fairly long key, well past any small buffer";
+    hmap.insert(long_key, 1);
+    transparent_hmap.insert(long_key, 1);
+    mark_it("finds std::string keys by std::string_view", [&] {
+        return test_that(   hmap.find(std::string_view{long_key}) != hmap.end()
+                         && hmap.find("missing"sv) == hmap.end());
+    }).
+    mark_it("transparent hash finds by std::string_view", [&] {
+        return test_that(   transparent_hmap.find(std::string_view{long_key})->second == 1
+                         && transparent_hmap.find("missing"sv) == transparent_hmap.end());
+    }).
+    mark_it("transparent hash finds by const char *", [&] {
+        return test_that(transparent_hmap.find(long_key.c_str()) != transparent_hmap.end());
+    }).
+    mark_it("transparent hash inserts by std::string_view, and rehashes", [&] {
+        transparent_hmap.insert("abc"sv, 3);
+        transparent_hmap.rehash(64);
+        return test_that(   transparent_hmap.find("abc"sv)->second == 3
+                         && transparent_hmap.find(long_key)->second == 1);
+    });
+});
+
+describe("HashMap bucket allocation")([] {
+    CountingResource resource;
+    auto fill = [](auto & hmap_, int count) {
+        for (int i = 1; i != count + 1; ++i)
+            { hmap_.insert(std::to_string(i), i); }
+    };
+    auto all_found = [](const auto & hmap_, int count) {
+        for (int i = 1; i != count + 1; ++i) {
+            auto itr = hmap_.find(std::to_string(i));
+            if (itr == hmap_.end() || itr->second != i)
+                return false;
+        }
+        return hmap_.size() == std::size_t(count);
+    };
+    mark_it("takes one allocation per bucket block", [&] {
+        pmr::HashMap<std::string, int> hmap{"", &resource};
+        hmap.reserve(100);
+        auto allocations = resource.allocation_count();
+        fill(hmap, 100);
+        return test_that(   allocations == 1
+                         && resource.allocation_count() == allocations);
+    }).
+    mark_it("grows using the same memory resource", [&] {
+        pmr::HashMap<std::string, int> hmap{"", &resource};
+        fill(hmap, 200);
+        return test_that(   resource.allocation_count() > 1
+                         && hmap.allocator().resource() == &resource
+                         && all_found(hmap, 200));
+    }).
+    mark_it("returns all memory to the resource", [&] {
+        {
+            pmr::HashMap<std::string, int, std::hash<std::string>,
+                         std::equal_to<void>, AllOptionsTestPolicy>
+                hmap{"", &resource};
+            fill(hmap, 300);
+            for (int i = 1; i != 301; i += 2)
+                { hmap.erase(hmap.find(std::to_string(i))); }
+            hmap.shrink_to_fit();
+        }
+        return test_that(resource.bytes_in_use() == 0);
+    }).
+    mark_it("copies keep every element, with control bytes", [&] {
+        pmr::HashMap<std::string, int, std::hash<std::string>,
+                     std::equal_to<void>, HashMapControlBytesPolicy>
+            hmap{"", &resource};
+        fill(hmap, 100);
+        auto copy = hmap;
+        hmap.clear();
+        return test_that(all_found(copy, 100) && hmap.is_empty());
+    }).
+    mark_it("huge page aligned maps hold many elements", [&] {
+        HashMap<int, int, std::hash<int>, std::equal_to<void>,
+                std::allocator<std::byte>, HugePagesTestPolicy> hmap{0};
+        // large enough that the bucket block is at least two megabytes
+        constexpr const int k_count = 200000;
+        hmap.reserve(k_count);
+        for (int i = 1; i != k_count + 1; ++i)
+            { hmap.insert(i, -i); }
+        for (int i = 1; i != k_count + 1; ++i) {
+            if (hmap.find(i)->second != -i)
+                { return test_that(false); }
+        }
+        return test_that(hmap.size() == std::size_t(k_count));
+    });
+});
+
+    return [] {};
+} ();
+
+int main() { return cul::tree_ts::run_tests(); }
+
+namespace {
+
+template <typename PolicyT>
 struct Emplace final {};
+template <typename PolicyT>
 struct Reserve final {};
+template <typename PolicyT>
 struct Find final {};
+template <typename PolicyT>
 struct Insert final {};
+template <typename PolicyT>
 struct Extract final {};
+template <typename PolicyT>
 struct Rehash final {};
+template <typename PolicyT>
 struct Iterators final {};
+template <typename PolicyT>
 struct Clear final {};
+template <typename PolicyT>
 struct Move final {};
+template <typename PolicyT>
+struct Churn final {};
+template <typename PolicyT>
+struct Batch final {};
+
+template <typename PolicyT>
+void describe_hash_map(const char * policy_name) {
+
+static constexpr const std::size_t empty_key = 0;
+static constexpr const std::size_t a_key = 1;
+static constexpr const std::size_t b_key = 2;
+static constexpr const std::size_t c_key = 3;
+static constexpr const std::size_t d_key = b_key + 8;
 
-describe<Reserve>("HashMap#reserve")([] {
+describe<Reserve<PolicyT>>(with_policy("HashMap#reserve", policy_name).c_str())([] {
     A::reset_counts();
     constexpr const static std::size_t k_empty_key = -1;
-    HashMap<std::size_t, A> hmap{k_empty_key};
+    PolicyHashMap<PolicyT, std::size_t, A> hmap{k_empty_key};
     mark_it("initial capacity is zero", [&] {
         return test_that(hmap.capacity() == 0);
     }).
@@ -150,9 +604,10 @@ describe<Reserve>("HashMap#reserve")([] {
     });
 });
 
-describe<Emplace>("HashMap#emplace").depends_on<Reserve>()([] {
+describe<Emplace<PolicyT>>(with_policy("HashMap#emplace", policy_name).c_str()).
+    template depends_on<Reserve<PolicyT>>()([] {
     A::reset_counts();
-    HashMap<SharedPtr<B>, A> hmap{nullptr};
+    PolicyHashMap<PolicyT, SharedPtr<B>, A> hmap{nullptr};
     hmap.reserve(3);
     auto somekey = make_shared<B>();
     hmap.emplace(SharedPtr<B>{somekey}, A{});
@@ -178,9 +633,10 @@ describe<Emplace>("HashMap#emplace").depends_on<Reserve>()([] {
     });
 });
 
-describe<Clear>("HashMap#clear").depends_on<Iterators>()([] {
+describe<Clear<PolicyT>>(with_policy("HashMap#clear", policy_name).c_str()).
+    template depends_on<Iterators<PolicyT>>()([] {
     A::reset_counts();
-    HashMap<SharedPtr<B>, A> hmap{nullptr};
+    PolicyHashMap<PolicyT, SharedPtr<B>, A> hmap{nullptr};
     hmap.reserve(3);
     hmap.emplace(make_shared<B>(), A{});
     hmap.emplace(make_shared<B>(), A{});
@@ -207,9 +663,10 @@ describe<Clear>("HashMap#clear").depends_on<Iterators>()([] {
     });
 });
 
-describe<Move>("HashMap move").depends_on<Iterators>()([] {
+describe<Move<PolicyT>>(with_policy("HashMap move", policy_name).c_str()).
+    template depends_on<Iterators<PolicyT>>()([] {
     A a, b, c;
-    HashMap<std::size_t, A> hmap{empty_key};
+    PolicyHashMap<PolicyT, std::size_t, A> hmap{empty_key};
     hmap.insert(a_key, a);
     hmap.insert(b_key, b);
     hmap.insert(c_key, c);
@@ -228,7 +685,7 @@ describe<Move>("HashMap move").depends_on<Iterators>()([] {
         return test_that(beg2->first == key);
     }).
     mark_it("copy assignment okay", [&] {
-        HashMap<std::size_t, A> hmap2{5};
+        PolicyHashMap<PolicyT, std::size_t, A> hmap2{5};
         hmap2.insert(0, A{});
         hmap2 = hmap;
         for (auto [key, el] : hmap) {
@@ -237,16 +694,17 @@ describe<Move>("HashMap move").depends_on<Iterators>()([] {
         return test_that(hmap2.size() == hmap.size() && keys.empty());
     }).
     mark_it("move assignment okay", [&] {
-        HashMap<std::size_t, A> hmap2{5};
+        PolicyHashMap<PolicyT, std::size_t, A> hmap2{5};
         hmap2.insert(0, A{});
         hmap2 = std::move(hmap);
         return test_that(hmap2.size() == 3);
     });
 });
 
-describe<Insert>("HashMap#insert").depends_on<Emplace>()([] {
+describe<Insert<PolicyT>>(with_policy("HashMap#insert", policy_name).c_str()).
+    template depends_on<Emplace<PolicyT>>()([] {
     mark_it("does not consume the key passed", [] {
-        HashMap<SharedPtr<B>, A> hmap{nullptr};
+        PolicyHashMap<PolicyT, SharedPtr<B>, A> hmap{nullptr};
         hmap.reserve(3);
         auto somekey = make_shared<B>();
         hmap.insert(somekey, A{});
@@ -254,9 +712,10 @@ describe<Insert>("HashMap#insert").depends_on<Emplace>()([] {
     });
 });
 
-describe<Find>("HashMap#find").depends_on<Emplace>()([] {
+describe<Find<PolicyT>>(with_policy("HashMap#find", policy_name).c_str()).
+    template depends_on<Emplace<PolicyT>>()([] {
     A::reset_counts();
-    HashMap<std::size_t, A> hmap{empty_key};
+    PolicyHashMap<PolicyT, std::size_t, A> hmap{empty_key};
     hmap.reserve(4);
     A a, b, c, d;
     hmap.insert(a_key, a);
@@ -274,7 +733,7 @@ describe<Find>("HashMap#find").depends_on<Emplace>()([] {
         return test_that(hmap.find(d_key)->second.id() == d.id());
     }).
     mark_it("find on empty hash map, returns end iterator", [] {
-        HashMap<std::size_t, A> hmap{empty_key};
+        PolicyHashMap<PolicyT, std::size_t, A> hmap{empty_key};
         return test_that(hmap.find(a_key) == hmap.end());
     }).
     mark_it("find on cleared hash map, returns end iterator", [&] {
@@ -283,9 +742,71 @@ describe<Find>("HashMap#find").depends_on<Emplace>()([] {
     });
 });
 
-describe<Extract>("HashMap#extract").depends_on<Find>()([] {
+describe<Batch<PolicyT>>(with_policy("HashMap batch operations", policy_name).c_str()).
+    template depends_on<Find<PolicyT>>()([] {
+    using IntHashMap = PolicyHashMap<PolicyT, std::size_t, int>;
+    IntHashMap hmap{empty_key};
+    // more than one stretch of keys, present and missing
+    std::vector<std::pair<std::size_t, int>> pairs;
+    for (std::size_t i = 1; i != 51; ++i)
+        { pairs.emplace_back(i*3, int(i)); }
+    // only even i up to fifty give present keys, so 25 of these
+    std::vector<std::size_t> keys;
+    for (std::size_t i = 1; i != 101; ++i)
+        { keys.push_back(i*3 - (i % 2)); }
+    mark_it("insert_batch inserts every pair", [&] {
+        auto inserted = hmap.insert_batch(pairs.begin(), pairs.end());
+        bool all_found = true;
+        for (auto & [key, el] : pairs) {
+            auto itr = hmap.find(key);
+            all_found = all_found && itr != hmap.end() && itr->second == el;
+        }
+        return test_that(inserted == 50 && hmap.size() == 50 && all_found);
+    }).
+    mark_it("insert_batch skips keys already present", [&] {
+        hmap.insert(3, 100);
+        auto inserted = hmap.insert_batch(pairs.begin(), pairs.end());
+        return test_that(inserted == 49 && hmap.find(3)->second == 100);
+    }).
+    mark_it("insert_batch with the empty key, throws", [&] {
+        std::pair<std::size_t, int> bad[] = { {1, 1}, {empty_key, 2} };
+        return expect_exception<std::invalid_argument>([&] {
+            hmap.insert_batch(std::begin(bad), std::end(bad));
+        });
+    }).
+    mark_it("find_batch gives the same iterators as find", [&] {
+        hmap.insert_batch(pairs.begin(), pairs.end());
+        std::vector<typename IntHashMap::Iterator> found;
+        hmap.find_batch(keys.begin(), keys.end(), std::back_inserter(found));
+        bool all_same = found.size() == keys.size();
+        for (std::size_t i = 0; all_same && i != keys.size(); ++i)
+            { all_same = found[i] == hmap.find(keys[i]); }
+        return test_that(all_same);
+    }).
+    mark_it("find_batch on a const map, gives const iterators", [&] {
+        hmap.insert_batch(pairs.begin(), pairs.end());
+        const auto & const_hmap = hmap;
+        std::vector<typename IntHashMap::ConstIterator> found;
+        const_hmap.find_batch(keys.begin(), keys.end(), std::back_inserter(found));
+        std::size_t found_count = 0;
+        for (auto & itr : found)
+            { found_count += itr == const_hmap.end() ? 0 : 1; }
+        return test_that(found_count == 25);
+    }).
+    mark_it("find_batch on an empty map, finds nothing", [&] {
+        std::vector<typename IntHashMap::Iterator> found;
+        hmap.find_batch(keys.begin(), keys.end(), std::back_inserter(found));
+        std::size_t found_count = 0;
+        for (auto & itr : found)
+            { found_count += itr == hmap.end() ? 0 : 1; }
+        return test_that(found.size() == keys.size() && found_count == 0);
+    });
+});
+
+describe<Extract<PolicyT>>(with_policy("HashMap#extract", policy_name).c_str()).
+    template depends_on<Find<PolicyT>>()([] {
     A::reset_counts();
-    HashMap<std::size_t, A> hmap{empty_key};
+    PolicyHashMap<PolicyT, std::size_t, A> hmap{empty_key};
     hmap.reserve(4);
     A a, b, c, d;
     hmap.insert(a_key, a);
@@ -338,9 +859,10 @@ describe<Extract>("HashMap#extract").depends_on<Find>()([] {
     });
 });
 
-describe<Rehash>("HashMap#rehash").depends_on<Emplace>()([] {
+describe<Rehash<PolicyT>>(with_policy("HashMap#rehash", policy_name).c_str()).
+    template depends_on<Emplace<PolicyT>>()([] {
     A::reset_counts();
-    HashMap<std::size_t, A> hmap{empty_key};
+    PolicyHashMap<PolicyT, std::size_t, A> hmap{empty_key};
     A a, b, c, d;
     auto add_elements = [&] {
         hmap.insert(a_key, a);
@@ -365,9 +887,10 @@ describe<Rehash>("HashMap#rehash").depends_on<Emplace>()([] {
     });
 });
 
-describe<Iterators>("HashMap iterators").depends_on<Emplace>()([] {
+describe<Iterators<PolicyT>>(with_policy("HashMap iterators", policy_name).c_str()).
+    template depends_on<Emplace<PolicyT>>()([] {
     A::reset_counts();
-    HashMap<SharedPtr<B>, A> hmap{nullptr};
+    PolicyHashMap<PolicyT, SharedPtr<B>, A> hmap{nullptr};
     const auto & cref_hmap = hmap;
     hmap.reserve(3);
     A a, b, c;
@@ -404,7 +927,7 @@ describe<Iterators>("HashMap iterators").depends_on<Emplace>()([] {
             "index", []
     {
         static constexpr const std::size_t empty_key = -1;
-        HashMap<std::size_t, A> hmap{empty_key};
+        PolicyHashMap<PolicyT, std::size_t, A> hmap{empty_key};
         hmap.reserve(4);
         A a, b, c, d;
         static constexpr const std::size_t a_key = 0;
@@ -423,7 +946,8 @@ describe<Iterators>("HashMap iterators").depends_on<Emplace>()([] {
         return test_that(ids.empty());
     }).
     mark_it("iterating pairs using for-range, are reference pairs", [&] {
-        using RefPair = HashMap<SharedPtr<B>, A>::Iterator::Reference;
+        using RefPair = typename PolicyHashMap<PolicyT, SharedPtr<B>, A>::
+            Iterator::Reference;
         A new_c;
         for (auto pair : hmap) {
             if (pair.second.id() == c.id()) {
@@ -437,7 +961,7 @@ describe<Iterators>("HashMap iterators").depends_on<Emplace>()([] {
         return test_that(itr != hmap.end());
     }).
     mark_it("begin returns a valid key (advances past empty)", [&] {
-        HashMap<std::size_t, A> hmap{empty_key};
+        PolicyHashMap<PolicyT, std::size_t, A> hmap{empty_key};
         hmap.insert(b_key, b);
         return test_that(hmap.begin()->first == b_key);
     }).
@@ -458,8 +982,61 @@ describe<Iterators>("HashMap iterators").depends_on<Emplace>()([] {
     );
 });
 
-return [] {};
+describe<Churn<PolicyT>>(with_policy("HashMap insert/erase churn", policy_name).c_str()).
+    template depends_on<Extract<PolicyT>>()([] {
+    // keys are spaced out so that many share an ideal bucket
+    static constexpr const std::size_t k_key_spacing = 64;
+    static constexpr const std::size_t k_key_count = 300;
+    PolicyHashMap<PolicyT, std::size_t, int> hmap{empty_key};
+    std::map<std::size_t, int> reference;
+    std::mt19937 rng{std::mt19937::default_seed};
+    std::uniform_int_distribution<std::size_t> key_dist{1, k_key_count};
+    for (int i = 0; i != 4000; ++i) {
+        auto key = key_dist(rng)*k_key_spacing;
+        auto itr = hmap.find(key);
+        if (itr == hmap.end()) {
+            hmap.insert(key, i);
+            reference[key] = i;
+        } else {
+            hmap.erase(itr);
+            reference.erase(key);
+        }
+    }
+    mark_it("has the same size as a reference container", [&] {
+        return test_that(hmap.size() == reference.size());
+    }).
+    mark_it("finds every element in the reference container", [&] {
+        for (auto [key, el] : reference) {
+            auto itr = hmap.find(key);
+            if (itr == hmap.end() || itr->second != el)
+                { return test_that(false); }
+        }
+        return test_that(true);
+    }).
+    mark_it("finds no element missing from the reference container", [&] {
+        for (std::size_t i = 1; i != k_key_count + 1; ++i) {
+            auto key = i*k_key_spacing;
+            bool in_reference = reference.find(key) != reference.end();
+            if (in_reference != (hmap.find(key) != hmap.end()))
+                { return test_that(false); }
+        }
+        return test_that(true);
+    }).
+    mark_it("iterates exactly the elements of the reference container", [&] {
+        std::map<std::size_t, int> iterated;
+        for (auto [key, el] : hmap)
+            { iterated[key] = el; }
+        return test_that(iterated == reference);
+    }).
+    mark_it("copies hold the same elements", [&] {
+        auto copy = hmap;
+        std::map<std::size_t, int> iterated;
+        for (auto [key, el] : copy)
+            { iterated[key] = el; }
+        return test_that(iterated == reference);
+    });
+});
 
-} ();
+}
 
-int main() { return cul::tree_ts::run_tests(); }
+} // end of <anonymous> namespace
@@ -0,0 +1,133 @@
+/****************************************************************************
+
+    MIT License
+
+    Copyright (c) 2023 Aria Janke
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+
+*****************************************************************************/
+
+
+#include <ariajanke/cul/TreeTestSuite.hpp>
+#include <ariajanke/cul/HashSet.hpp>
+
+#include <set>
+#include <string>
+#include <string_view>
+
+namespace {
+
+using namespace cul;
+using namespace tree_ts;
+
+#define mark_it mark_source_position(__LINE__, __FILE__).it
+
+constexpr const std::size_t k_empty_key = 0;
+
+using SizeHashSet = HashSet<std::size_t>;
+
+// a set's buckets hold only their keys
+static_assert(sizeof(HashMapBucketDefinitions
+    <std::size_t, detail::HashSetNoElement, std::allocator<std::size_t>,
+     std::equal_to<void>>::Bucket) == sizeof(std::size_t),
+    "HashSet buckets must be no larger than their keys");
+
+} // end of <anonymous> namespace
+
+auto x = [] {
+
+describe("HashSet")([] {
+    SizeHashSet set{k_empty_key};
+    mark_it("is empty to begin with", [&] {
+        return test_that(set.is_empty() && set.begin() == set.end());
+    }).
+    mark_it("contains an inserted key", [&] {
+        auto insertion = set.insert(std::size_t(5));
+        return test_that(   insertion.success && *insertion.position == 5
+                         && set.contains(std::size_t(5)) && set.size() == 1);
+    }).
+    mark_it("does not insert a key twice", [&] {
+        set.insert(std::size_t(5));
+        auto insertion = set.insert(std::size_t(5));
+        return test_that(!insertion.success && set.size() == 1);
+    }).
+    mark_it("inserting the empty key, throws", [&] {
+        return expect_exception<std::invalid_argument>([&] {
+            set.insert(k_empty_key);
+        });
+    }).
+    mark_it("erases by key", [&] {
+        set.insert(std::size_t(5));
+        set.insert(std::size_t(6));
+        bool erased = set.erase(std::size_t(5));
+        bool erased_again = set.erase(std::size_t(5));
+        return test_that(   erased && !erased_again
+                         && !set.contains(std::size_t(5))
+                         && set.contains(std::size_t(6)));
+    }).
+    mark_it("erases by iterator", [&] {
+        set.insert(std::size_t(5));
+        set.erase(set.find(std::size_t(5)));
+        return test_that(set.is_empty());
+    }).
+    mark_it("iterates each key exactly once", [&] {
+        std::set<std::size_t> expected;
+        for (std::size_t i = 1; i != 101; ++i) {
+            set.insert(i*7);
+            expected.insert(i*7);
+        }
+        std::set<std::size_t> seen;
+        std::size_t count = 0;
+        const auto & const_set = set;
+        for (auto key : const_set) {
+            seen.insert(key);
+            ++count;
+        }
+        return test_that(count == 100 && seen == expected);
+    });
+});
+
+describe("HashSet with string keys")([] {
+    HashSet<std::string, TransparentStringHash> set{""};
+    set.insert(std::string{"a fairly long key, well past any small buffer"});
+    set.insert(std::string{"short"});
+    mark_it("finds keys by std::string_view", [&] {
+        using namespace std::string_view_literals;
+        return test_that(   set.contains("short"sv)
+                         && !set.contains("missing"sv)
+                         && set.contains
+                            ("a fairly long key, well past any small buffer"sv));
+    }).
+    mark_it("finds keys by const char *", [&] {
+        return test_that(set.contains("short") && !set.contains("shor"));
+    }).
+    mark_it("inserts by std::string_view", [&] {
+        using namespace std::string_view_literals;
+        auto insertion = set.insert("new"sv);
+        return test_that(   insertion.success
+                         && *insertion.position == std::string{"new"});
+    });
+});
+
+return [] {};
+
+} ();
+
+int main() { return cul::tree_ts::run_tests(); }
@@ -0,0 +1,166 @@
+/****************************************************************************
+
+    MIT License
+
+    Copyright (c) 2021 Aria Janke
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+
+*****************************************************************************/
+
+
+#include <ariajanke/cul/TreeTestSuite.hpp>
+#include <ariajanke/cul/ParallelGrid.hpp>
+#include <ariajanke/cul/SubGrid.hpp>
+
+#include <algorithm>
+#include <stdexcept>
+
+namespace {
+
+using namespace cul;
+using namespace tree_ts;
+
+#define mark_it mark_source_position(__LINE__, __FILE__).it
+
+using VectorI = Vector2<int>;
+
+// small grains, so that even small grids are split across many tasks
+ParallelGridOptions small_grain_options(bool deterministic = false) {
+    ParallelGridOptions options;
+    options.grain = 1;
+    options.deterministic = deterministic;
+    return options;
+}
+
+Grid<int> make_numbered(int width, int height) {
+    Grid<int> grid;
+    grid.set_size(width, height, 0);
+    for (VectorI r; r != grid.end_position(); r = grid.next(r))
+        { grid(r) = r.x + r.y*1000; }
+    return grid;
+}
+
+} // end of <anonymous> namespace
+
+auto x = [] {
+
+describe("parallel_for_each_cell")([] {
+    mark_it("visits every cell of a grid with its position", [] {
+        Grid<int> grid;
+        grid.set_size(37, 53, -1);
+        parallel_for_each_cell(grid, [] (VectorI r, int & el)
+            { el = r.x + r.y*1000; }, small_grain_options());
+        auto expected = make_numbered(37, 53);
+        return test_that(std::equal(grid.begin(), grid.end(), expected.begin()));
+    }).
+    mark_it("accepts functions of the element alone", [] {
+        auto grid = make_numbered(20, 20);
+        parallel_for_each_cell(grid, [] (int & el) { el *= 2; });
+        return test_that(grid(3, 4) == 2*(3 + 4000));
+    }).
+    mark_it("only touches cells inside a sub grid", [] {
+        auto grid = make_numbered(10, 10);
+        parallel_for_each_cell(make_sub_grid(grid, VectorI{2, 3}, 4, 5),
+            [] (int & el) { el = -1; }, small_grain_options());
+        int changed = 0;
+        for (auto el : grid)
+            { changed += (el == -1) ? 1 : 0; }
+        return test_that(changed == 20 && grid(2, 3) == -1 && grid(5, 7) == -1
+                         && grid(6, 7) == 6 + 7000);
+    }).
+    mark_it("gives the same results in deterministic mode", [] {
+        Grid<int> grid;
+        grid.set_size(31, 17, 0);
+        parallel_for_each_cell(grid, [] (VectorI r, int & el)
+            { el = r.x*r.y; }, small_grain_options(true));
+        for (VectorI r; r != grid.end_position(); r = grid.next(r)) {
+            if (grid(r) != r.x*r.y) return test_that(false);
+        }
+        return test_that(true);
+    }).
+    mark_it("works on a single thread pool", [] {
+        GridThreadPool pool{1};
+        auto options = small_grain_options();
+        options.pool = &pool;
+        auto grid = make_numbered(8, 8);
+        parallel_for_each_cell(grid, [] (int & el) { ++el; }, options);
+        return test_that(pool.thread_count() == 1 && grid(7, 7) == 7 + 7000 + 1);
+    }).
+    mark_it("rethrows exceptions from the function", [] {
+        auto grid = make_numbered(16, 16);
+        return expect_exception<std::runtime_error>([&] {
+            parallel_for_each_cell(grid, [] (VectorI r, int &) {
+                if (r == VectorI{5, 9})
+                    { throw std::runtime_error{"test"}; }
+            }, small_grain_options());
+        });
+    }).
+    mark_it("runs nested calls without deadlocking", [] {
+        Grid<int> outer;
+        outer.set_size(4, 4, 0);
+        parallel_for_each_cell(outer, [] (int & el) {
+            auto inner = make_numbered(4, 4);
+            parallel_for_each_cell(inner, [] (int & inner_el) { inner_el = 1; },
+                                   small_grain_options());
+            for (auto inner_el : inner)
+                { el += inner_el; }
+        }, small_grain_options());
+        return test_that(outer(3, 3) == 16);
+    });
+});
+
+describe("parallel_transform")([] {
+    mark_it("writes f of each source cell into the destination", [] {
+        auto source = make_numbered(23, 19);
+        Grid<double> destination;
+        destination.set_size(23, 19, 0.);
+        parallel_transform(source, destination, [] (int el)
+            { return el*0.5; }, small_grain_options());
+        return test_that(destination(22, 18) == (22 + 18000)*0.5);
+    }).
+    mark_it("passes positions, between sub grids", [] {
+        auto source = make_numbered(10, 10);
+        Grid<int> destination;
+        destination.set_size(10, 10, 0);
+        parallel_transform(make_sub_grid(source, VectorI{5, 5}, 3, 3),
+                           make_sub_grid(destination, VectorI{0, 0}, 3, 3),
+                           [] (VectorI r, int el) { return el + r.x; });
+        return test_that(   destination(2, 1) == 7 + 6000 + 2
+                         && destination(3, 0) == 0);
+    }).
+    mark_it("may transform a grid in place", [] {
+        auto grid = make_numbered(12, 12);
+        parallel_transform(grid, grid, [] (int el) { return -el; },
+                           small_grain_options());
+        return test_that(grid(11, 11) == -(11 + 11000));
+    }).
+    mark_it("throws if sizes differ", [] {
+        auto source = make_numbered(3, 3);
+        auto destination = make_numbered(3, 4);
+        return expect_exception<std::invalid_argument>([&] {
+            parallel_transform(source, destination, [] (int el) { return el; });
+        });
+    });
+});
+
+    return [] {};
+} ();
+
+int main() { return cul::tree_ts::run_tests(); }
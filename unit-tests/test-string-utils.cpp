@@ -29,6 +29,8 @@
 #include <ariajanke/cul/TreeTestSuite.hpp>
 
 #include <cstring>
+#include <cmath>
+#include <vector>
 #include <cassert>
 
 #define mark_it mark_source_position(__LINE__, __FILE__).it
@@ -126,6 +128,48 @@ void add_for_split_tests() {
             return test_that(count == 0);
         });
     });
+    describe("for_split_any_of string helper")([] {
+        using Segments = std::vector<std::string>;
+        mark_it("gives the same segments as for_split, over long strings", [] {
+            std::string samp;
+            for (int i = 0; i != 500; ++i)
+                { samp += " a,\tbc  dddddddddddddddddddddddddddddddddddddddd,e"[(i*37) % 48]; }
+            Segments scalar, vectorized;
+            for_split<is_any_of<' ', ',', '\t'>>(samp.data(), samp.data() + samp.size(),
+                [&scalar](const char * beg, const char * end)
+                { scalar.emplace_back(beg, end); });
+            for_split_any_of<' ', ',', '\t'>(samp,
+                [&vectorized](const char * beg, const char * end)
+                { vectorized.emplace_back(beg, end); });
+            return test_that(scalar.size() > 10 && scalar == vectorized);
+        });
+        mark_it("handles segments spanning many blocks", [] {
+            std::string samp = std::string(70, ',') + std::string(100, 'x') + ",,y";
+            Segments segments;
+            for_split_any_of<','>(samp, [&segments](const char * beg, const char * end)
+                { segments.emplace_back(beg, end); });
+            return test_that(   segments.size() == 2 && segments[0].size() == 100
+                             && segments[1] == "y");
+        });
+        mark_it("responds to 'flow control signals'", [] {
+            int count = 0;
+            std::string samp = "a b c e f";
+            for_split_any_of<' '>(samp, [&count](const char *, const char *) {
+                ++count;
+                return (count == 3) ? fc_signal::k_break : fc_signal::k_continue;
+            });
+            return test_that(count == 3);
+        });
+        mark_it("does not call predicate once, with strings that are just "
+                "split characters", []
+        {
+            int count = 0;
+            std::string samp(40, ',');
+            for_split_any_of<','>(samp, [&count](const char *, const char *)
+                { ++count; });
+            return test_that(count == 0);
+        });
+    });
 }
 
 void add_string_to_number_tests() {
@@ -196,6 +240,87 @@ void add_string_to_number_tests() {
             bool res = string_to_number(samp, out);
             return test_that(res && out == 10);
         });
+        mark_it("converts decimal strings longer than eight digits", [] {
+            std::string samp = "-1234567890123";
+            int64_t out = 0;
+            bool res = string_to_number(samp, out);
+            return test_that(res && out == -1234567890123);
+        });
+        mark_it("converts long hexidecimal strings", [] {
+            std::string samp = "7fffFFFF";
+            int32_t out = 0;
+            bool res = string_to_number(samp, out, 16);
+            return test_that(res && out == 0x7FFFFFFF);
+        });
+        mark_it("rejects a decimal string one past the max integer", [] {
+            std::string samp = "2147483648";
+            int32_t out = 0;
+            return test_that(!string_to_number(samp, out));
+        });
+        mark_it("rejects a decimal string one past the max unsigned integer", [] {
+            const char * str = "4294967296";
+            uint32_t out = 0;
+            return test_that(!string_to_number(str, str + strlen(str), out));
+        });
+        mark_it("rejects a non-digit following eight valid digits", [] {
+            std::string samp = "12345678x";
+            int64_t out = 0;
+            return test_that(!string_to_number(samp, out));
+        });
+        mark_it("converts floating points with exponents", [] {
+            std::string samp = "-1.25e-3";
+            double out = 0.;
+            bool res = string_to_number(samp, out);
+            return test_that(res && out == -0.00125);
+        });
+        mark_it("converts u32 floating point strings with exponents", [] {
+            std::u32string wide = U"2.5E+3";
+            float out = 0.f;
+            bool res = string_to_number(wide, out);
+            return test_that(res && out == 2500.f);
+        });
+        mark_it("converts floating points exactly as the compiler does", [] {
+            std::string samp = "0.30000000000000004";
+            double out = 0.;
+            bool res = string_to_number(samp, out);
+            return test_that(res && out == 0.30000000000000004);
+        });
+        mark_it("converts the largest and smallest doubles", [] {
+            const char * large = "1.7976931348623157e308";
+            const char * small = "4.9406564584124654e-324";
+            double out_large = 0., out_small = 0.;
+            bool res =    string_to_number(large, large + strlen(large), out_large)
+                       && string_to_number(small, small + strlen(small), out_small);
+            return test_that(res && out_large == std::numeric_limits<double>::max()
+                             && out_small == std::numeric_limits<double>::denorm_min());
+        });
+        mark_it("rounds long strings of digits on the right side of halfway", [] {
+            // halfway between 2^53 and 2^53 + 2, with one more digit far away
+            std::string samp = "9007199254740993.00000000000000000000000001";
+            double out = 0.;
+            bool res = string_to_number(samp, out);
+            return test_that(res && out == 9007199254740994.);
+        });
+        mark_it("converts long strings of digits too small to be finite to zero", [] {
+            // just under half the smallest subnormal, so rounds to zero
+            std::string samp = "-2.47032822920623272088284396434110686182e-324";
+            double out = 1.;
+            bool res = string_to_number(samp, out);
+            return test_that(res && out == 0. && std::signbit(out));
+        });
+        mark_it("rounds long strings of digits just over half the smallest "
+                "subnormal up", []
+        {
+            std::string samp = "2.47032822920623272088284396434110686183e-324";
+            double out = 0.;
+            bool res = string_to_number(samp, out);
+            return test_that(res && out == std::numeric_limits<double>::denorm_min());
+        });
+        mark_it("fails to convert floating points too large to be finite", [] {
+            std::string samp = "1e309";
+            double out = 0.;
+            return test_that(!string_to_number(samp, out));
+        });
     });
     describe("string_to_number_multibase utility method")([] {
         mark_it("converts to octal numbers correctly", [] {
@@ -236,6 +361,40 @@ void add_string_to_number_tests() {
             return test_that(!res); // no prefix... strictly decimal
         });
     });
+    describe("parse_numbers helper")([] {
+        using cul::parse_numbers;
+        mark_it("converts every delimited number, trimming whitespace", [] {
+            std::string samp = " 1, -2 ,3\r\n4,\t5\n";
+            std::vector<int> out;
+            auto res = parse_numbers<int, ',', '\n'>(samp, std::back_inserter(out));
+            return test_that(   out == std::vector<int>{ 1, -2, 3, 4, 5 }
+                             && res.count == 5
+                             && res.error_position == samp.data() + samp.size());
+        });
+        mark_it("stops at and reports the first token failing conversion", [] {
+            const char * str = "1.5,2.5e1,x3,4";
+            std::vector<double> out;
+            auto res = parse_numbers<double, ','>
+                (str, str + strlen(str), std::back_inserter(out));
+            return test_that(   out == std::vector<double>{ 1.5, 25. }
+                             && res.count == 2 && res.error_position == str + 10);
+        });
+        mark_it("fails a token with whitespace inside of it", [] {
+            const char * str = "1 2,3";
+            std::vector<int> out;
+            auto res = parse_numbers<int, ','>
+                (str, str + strlen(str), std::back_inserter(out));
+            return test_that(res.count == 0 && res.error_position == str);
+        });
+        mark_it("writes no further than the end of a bounded output", [] {
+            const char * str = "7;8;9";
+            int row[2] = { 0, 0 };
+            auto res = parse_numbers<int, ';'>
+                (str, str + strlen(str), std::begin(row), std::end(row));
+            return test_that(   row[0] == 7 && row[1] == 8 && res.count == 2
+                             && res.error_position == str + 4);
+        });
+    });
 }
 
 void add_trim_tests() {
@@ -278,6 +437,31 @@ void add_trim_tests() {
             return test_that(end == beg);
         });
     });
+    describe("trim_any_of helper method")([] {
+        using cul::trim_any_of;
+        mark_it("trims the same as trim, for every length of padding", [] {
+            bool all_same = true;
+            for (int pad = 0; pad != 70; ++pad) {
+                std::string samp =   std::string(std::size_t(pad), ' ') + "a \t b"
+                                   + std::string(std::size_t(70 - pad), '\t');
+                const char * beg = samp.data();
+                const char * end = beg + samp.size();
+                auto expected_beg = beg;
+                auto expected_end = end;
+                trim<is_whitespace>(expected_beg, expected_end);
+                trim_any_of<' ', '\t', '\r', '\n'>(beg, end);
+                all_same = all_same && beg == expected_beg && end == expected_end;
+            }
+            return test_that(all_same);
+        });
+        mark_it("trims a string to empty if all characters match", [] {
+            std::string samp(50, ' ');
+            const char * beg = samp.data();
+            const char * end = beg + samp.size();
+            trim_any_of<' '>(beg, end);
+            return test_that(end == beg);
+        });
+    });
 }
 
 void add_wrap_tests() {
@@ -349,6 +533,52 @@ void add_wrap_tests() {
             return test_that(rv);
         });
     });
+    describe("IncrementalMonowidthWrapper")([] {
+        using Wrapper = cul::IncrementalMonowidthWrapper;
+        using Lines = std::vector<std::string>;
+        static auto lines_of = [](Wrapper & wrapper, Wrapper::Position from, int count) {
+            Lines lines;
+            wrapper.for_each_line(from, count, [&lines](const char * beg, const char * end)
+                { lines.emplace_back(beg, end); });
+            return lines;
+        };
+        mark_it("wraps each paragraph, from text appended in chunks", [] {
+            Wrapper wrapper{10};
+            wrapper.append("This is a sh");
+            wrapper.append("ort sentence.\n\nA");
+            wrapper.append(std::string{"nother."});
+            return test_that(   wrapper.paragraph_count() == 3
+                             && lines_of(wrapper, Wrapper::Position{}, 10)
+                                == Lines{ "This is a ", "short ", "sentence.", "", "Another." });
+        });
+        mark_it("rewraps visited paragraphs after a width change", [] {
+            Wrapper wrapper{8};
+            wrapper.append("0 1 2 3333 4 55 6 777 8\nabc def");
+            wrapper.set_max_chars(20);
+            return test_that(   lines_of(wrapper, Wrapper::Position{}, 3)
+                                == Lines{ "0 1 2 3333 4 55 6 ", "777 8", "abc def" }
+                             && wrapper.line_count_of(0) == 2);
+        });
+        mark_it("advances across paragraphs, staying within the text", [] {
+            Wrapper wrapper{5};
+            wrapper.append("aaaa bbbb\ncccc\ndddd eeee");
+            auto pos  = wrapper.advance(Wrapper::Position{}, 3);
+            auto last = wrapper.advance(pos, 100);
+            auto first = wrapper.advance(last, -100);
+            return test_that(   pos.paragraph == 2 && pos.line == 0
+                             && last.paragraph == 2 && last.line == 1
+                             && first.paragraph == 0 && first.line == 0);
+        });
+        mark_it("throws if the width is not positive", [] {
+            Wrapper wrapper{5};
+            try {
+                wrapper.set_max_chars(0);
+            } catch (std::invalid_argument &) {
+                return test_that(wrapper.max_chars() == 5);
+            }
+            return test_that(false);
+        });
+    });
 }
 
 } // end of <anonymous> namespace